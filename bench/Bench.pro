@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Recorder benchmark: synthetic camera and replayed triggers
+#
+#-------------------------------------------------
+
+QT       += core
+
+TARGET = RecorderBench
+CONFIG   += console
+CONFIG   -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+include(../recorder.pri)
+
+SOURCES += main.cpp \
+    syntheticframesource.cpp \
+    triggerplayer.cpp \
+    kernelbench.cpp \
+    serialbench.cpp \
+    ringconsumer.cpp
+
+HEADERS += \
+    syntheticframesource.h \
+    triggerplayer.h \
+    kernelbench.h \
+    serialbench.h \
+    ringconsumer.h
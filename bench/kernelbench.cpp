@@ -0,0 +1,146 @@
+#include <cstring>
+#include <opencv2/imgproc/imgproc.hpp>  // Colour conversion, resize
+#include "kernelbench.h"
+#include "framekernels.h"
+#include "monotonicclock.h"
+
+typedef void (*Kernel)(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, FrameKernels::Isa isa);
+
+//!
+//! \brief Kernel with matching OpenCV call.
+//!
+struct KernelCase
+{
+    const char *name;
+    Kernel kernel;
+    int srcType;
+    int dstType;
+    bool half;
+    int conversion;     //!< cvtColor code, -1 uses area resize
+};
+
+static const KernelCase Cases[] = {
+    { "yuyv>bgr", FrameKernels::yuyvToBgr, CV_8UC2, CV_8UC3, false, CV_YUV2BGR_YUYV },
+    { "yuyv>gray", FrameKernels::yuyvToGray, CV_8UC2, CV_8UC1, false, CV_YUV2GRAY_YUYV },
+    { "bgr>gray", FrameKernels::bgrToGray, CV_8UC3, CV_8UC1, false, CV_BGR2GRAY },
+    { "half bgr", FrameKernels::halfBgr, CV_8UC3, CV_8UC3, true, -1 },
+    { "half gray", FrameKernels::halfGray, CV_8UC1, CV_8UC1, true, -1 }
+};
+
+//!
+//! \brief Function fills frame with random bytes.
+//! \param frame Represents continuous frame.
+//!
+static void fillRandom(cv::Mat &frame)
+{
+    uchar *data = frame.data;
+    size_t bytes = frame.total() * frame.elemSize();
+    quint32 state = 12345;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        data[i] = uchar(state >> 24);
+    }
+}
+
+//!
+//! \brief Function compares pixels of two frames.
+//! \return Returns true if all bytes are equal.
+//!
+static bool samePixels(const cv::Mat &a, const cv::Mat &b)
+{
+    size_t rowBytes = size_t(a.cols) * a.elemSize();
+    for (int y = 0; y < a.rows; ++y)
+    {
+        if (memcmp(a.ptr(y), b.ptr(y), rowBytes) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//!
+//! \brief Function runs kernel once.
+//! \param test Represents kernel to run.
+//! \param mode Represents ScalarIsa or better instruction set, AutoIsa runs OpenCV call instead.
+//! \param src Represents source frame.
+//! \param dst Represents output frame of right size and type.
+//!
+static void runOnce(const KernelCase &test, FrameKernels::Isa mode, const cv::Mat &src, cv::Mat &dst)
+{
+    if (mode != FrameKernels::AutoIsa)
+    {
+        test.kernel(src.data, src.step, dst.data, dst.step, dst.cols, dst.rows, mode);
+    }
+    else if (test.conversion >= 0)
+    {
+        cv::cvtColor(src, dst, test.conversion);
+    }
+    else
+    {
+        cv::resize(src, dst, dst.size(), 0, 0, CV_INTER_AREA);
+    }
+}
+
+//!
+//! \brief Object constructor.
+//! \param iterations Represents number of runs averaged per measurement.
+//!
+KernelBench::KernelBench(int iterations) :
+    _iterations(qMax(iterations, 1))
+{
+}
+
+//!
+//! \brief Method measures all kernels and prints one line per kernel and size.
+//! \param sizes Represents source frame sizes.
+//! \param out Represents report stream.
+//! \return Returns false if vector output differs from scalar one.
+//!
+bool KernelBench::run(const QVector<cv::Size> &sizes, QTextStream &out) const
+{
+    FrameKernels::Isa best = FrameKernels::bestIsa();
+    out << QString("%1 %2 %3 %4 %5 %6 %7")
+           .arg("kernel", -10).arg("size", -10).arg("scalar ms", 10)
+           .arg(QString("%1 ms").arg(FrameKernels::isaName(best)), 10).arg("opencv ms", 10)
+           .arg("speedup", 8).arg("match", 6) << endl;
+
+    bool ok = true;
+    for (int s = 0; s < sizes.size(); ++s)
+    {
+        for (size_t k = 0; k < sizeof(Cases) / sizeof(Cases[0]); ++k)
+        {
+            const KernelCase &test = Cases[k];
+            cv::Size size = sizes[s];
+            cv::Size dstSize = test.half ? cv::Size(size.width / 2, size.height / 2) : size;
+
+            cv::Mat src(size, test.srcType);
+            fillRandom(src);
+            const FrameKernels::Isa modes[3] = { FrameKernels::ScalarIsa, best, FrameKernels::AutoIsa };
+            cv::Mat outputs[3];
+            double times[3];
+            for (int m = 0; m < 3; ++m)
+            {
+                outputs[m].create(dstSize, test.dstType);
+
+                // First run warms caches and is not measured.
+                runOnce(test, modes[m], src, outputs[m]);
+                qint64 start = monotonicNs();
+                for (int i = 0; i < this->_iterations; ++i)
+                {
+                    runOnce(test, modes[m], src, outputs[m]);
+                }
+                times[m] = double(monotonicNs() - start) / 1e6 / this->_iterations;
+            }
+
+            bool match = samePixels(outputs[0], outputs[1]);
+            ok = ok && match;
+            out << QString("%1 %2 %3 %4 %5 %6 %7")
+                   .arg(test.name, -10).arg(QString("%1x%2").arg(size.width).arg(size.height), -10)
+                   .arg(times[0], 10, 'f', 3).arg(times[1], 10, 'f', 3).arg(times[2], 10, 'f', 3)
+                   .arg(times[1] > 0.0 ? times[0] / times[1] : 0.0, 8, 'f', 1).arg(match ? "yes" : "NO", 6) << endl;
+        }
+    }
+    return ok;
+}
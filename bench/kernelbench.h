@@ -0,0 +1,24 @@
+#ifndef KERNELBENCH_H
+#define KERNELBENCH_H
+
+#include <QTextStream>
+#include <QVector>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+
+//!
+//! \brief Microbenchmark of frame processing kernels.
+//! Every kernel runs scalar, with the best instruction set of CPU and as
+//! generic OpenCV call on random frames; vector output is checked to be
+//! identical to scalar one.
+//!
+class KernelBench
+{
+public:
+    explicit KernelBench(int iterations = 50);
+    bool run(const QVector<cv::Size> &sizes, QTextStream &out) const;
+
+private:
+    int _iterations;
+};
+
+#endif // KERNELBENCH_H
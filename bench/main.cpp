@@ -0,0 +1,416 @@
+#include <QApplication>
+#include <QtCore>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "camerathread.h"
+#include "kernelbench.h"
+#include "serialbench.h"
+#include "monotonicclock.h"
+#include "ringconsumer.h"
+#include "syntheticframesource.h"
+#include "triggerplayer.h"
+
+//!
+//! \brief Settings shared by all benchmark runs.
+//!
+struct BenchOptions
+{
+    QString output;
+    int fps;
+    int queue;
+    EncoderThread::OverflowPolicy overflow;
+    QStringList images;
+    QString source;
+    int encoderThreads;
+    int writeBehind;
+    int adaptiveQuality;
+    QString process;
+    double skipThreshold;
+    int ringConsumerUs;             //!< -1 runs no shared memory consumer
+};
+
+//!
+//! \brief Result of one benchmark run.
+//!
+struct BenchResult
+{
+    cv::Size size;
+    quint64 triggers;
+    quint64 written;
+    quint64 dropped;
+    double triggerRate;
+    double sustainedRate;
+    double p50;
+    double p99;
+    double max;
+    RingConsumer::Counters ring;
+};
+
+//!
+//! \brief Method runs recorder with synthetic camera and replayed triggers.
+//! \param size Represents frame size, ignored when real source is given in options.
+//! \param codec Represents four character codec code.
+//! \param options Represents run settings shared by all runs.
+//! \param times Represents trigger times in ns from start.
+//! \param result Represents output values.
+//! \return Returns false if recorder could not start.
+//!
+static bool runBench(cv::Size size, const QString &codec, const BenchOptions &options,
+                     const QVector<qint64> &times, BenchResult &result)
+{
+    FrameSource *source = nullptr;
+    if (options.source.isEmpty())
+    {
+        source = new SyntheticFrameSource(size, options.fps, options.images);
+    }
+    else
+    {
+        source = FrameSource::create(options.source, options.fps);
+        if (source == nullptr)
+        {
+            return false;
+        }
+        size = source->frameSize();
+    }
+
+    QString videoName = QDir(options.output)
+            .filePath(QString("bench_%1_%2x%3.avi").arg(codec).arg(size.width).arg(size.height));
+    QByteArray code = codec.toLatin1();
+
+    qint64 start = 0;
+    quint64 sent = 0;
+    qint64 replayDuration = 0;
+    {
+        CameraThread camera;
+        camera.setSerialEnabled(false);
+        camera.setPreviewEnabled(false);
+        camera.setStats(true);
+        camera.setCodec(CV_FOURCC(code[0], code[1], code[2], code[3]));
+        camera.setEncoderQueue(options.queue, options.overflow);
+        camera.setEncoderThreads(options.encoderThreads);
+        camera.setWriteBehind(options.writeBehind);
+        camera.setAdaptiveQuality(options.adaptiveQuality > 0, options.adaptiveQuality, 1, 1.0);
+        camera.setProcessing(options.process, QString());
+        camera.setFrameSkipping(options.skipThreshold, cv::Rect(), false);
+        QString ringName = QString("recorder_bench_%1").arg(QCoreApplication::applicationPid());
+        if (options.ringConsumerUs >= 0)
+        {
+            camera.setSharedMemory(ringName, 8);
+        }
+        camera.init(source, options.fps, videoName);
+        camera.start();
+        if (!camera.isReady())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Recorder not started for" << codec << size.width << size.height;
+            return false;
+        }
+
+        // Let capture thread deliver first frames.
+        QThread::msleep(200);
+
+        // Consumer reads ring while recorder writes, like analysis process next to it.
+        RingConsumer consumer(ringName, options.ringConsumerUs);
+        if (options.ringConsumerUs >= 0)
+        {
+            consumer.start();
+        }
+
+        TriggerPlayer player(&camera, times);
+        QEventLoop loop;
+        QObject::connect(&player, SIGNAL(finished()), &loop, SLOT(quit()));
+        start = monotonicNs();
+        player.start();
+        loop.exec();
+
+        consumer.stop();
+        result.ring = consumer.counters();
+
+        sent = player.sent();
+        replayDuration = player.duration();
+    } // recorder writes queued frames and stats file before it is gone
+    qint64 drained = monotonicNs();
+
+    QFileInfo info(videoName);
+    QFile statsFile(QDir(info.path()).filePath(info.completeBaseName() + "_stats.json"));
+    if (!statsFile.open(QIODevice::ReadOnly))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Missing stats file:" << statsFile.fileName();
+        return false;
+    }
+
+    QJsonObject stats = QJsonDocument::fromJson(statsFile.readAll()).object();
+    QJsonObject counters = stats.value("counters").toObject();
+    QJsonObject latency = stats.value("stages_ns").toObject().value("trigger_to_disk").toObject();
+
+    result.size = size;
+    result.triggers = sent;
+    result.written = quint64(counters.value("written").toDouble());
+    result.dropped = quint64(counters.value("dropped_triggers").toDouble());
+    result.triggerRate = replayDuration > 0 ? double(sent) * 1e9 / double(replayDuration) : 0.0;
+    result.sustainedRate = drained > start ? double(result.written) * 1e9 / double(drained - start) : 0.0;
+    result.p50 = latency.value("p50").toDouble() / 1e6;
+    result.p99 = latency.value("p99").toDouble() / 1e6;
+    result.max = latency.value("max").toDouble() / 1e6;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc,argv);
+
+    QApplication::setApplicationName("RecorderBench");
+    QApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Recorder benchmark with synthetic camera and replayed triggers");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption triggersOption(QStringList() << "triggers",
+                                      QCoreApplication::translate("main", "Replay trigger times (ms, one per line) from <file>."),
+                                      QCoreApplication::translate("main", "file"));
+    parser.addOption(triggersOption);
+
+    QCommandLineOption rateOption(QStringList() << "rate",
+                                  QCoreApplication::translate("main", "Trigger <rate> per second when no trigger file is given."),
+                                  QCoreApplication::translate("main", "rate"),
+                                  QLatin1String("25"));
+    parser.addOption(rateOption);
+
+    QCommandLineOption durationOption(QStringList() << "duration",
+                                      QCoreApplication::translate("main", "Generated trigger stream length in <seconds>."),
+                                      QCoreApplication::translate("main", "seconds"),
+                                      QLatin1String("10"));
+    parser.addOption(durationOption);
+
+    QCommandLineOption imagesOption(QStringList() << "images",
+                                    QCoreApplication::translate("main", "Play images from <dir> instead of generated frames."),
+                                    QCoreApplication::translate("main", "dir"));
+    parser.addOption(imagesOption);
+
+    QCommandLineOption sourceOption(QStringList() << "source",
+                                    QCoreApplication::translate("main", "Capture from real <source> (id, v4l2:<device>, file:<dir> or video) instead of synthetic camera."),
+                                    QCoreApplication::translate("main", "source"));
+    parser.addOption(sourceOption);
+
+    QCommandLineOption sizesOption(QStringList() << "sizes",
+                                   QCoreApplication::translate("main", "Comma separated frame <sizes>."),
+                                   QCoreApplication::translate("main", "sizes"),
+                                   QLatin1String("640x480,1280x720,1920x1080"));
+    parser.addOption(sizesOption);
+
+    QCommandLineOption codecsOption(QStringList() << "codecs",
+                                    QCoreApplication::translate("main", "Comma separated four character <codecs>."),
+                                    QCoreApplication::translate("main", "codecs"),
+                                    QLatin1String("MJPG,XVID"));
+    parser.addOption(codecsOption);
+
+    QCommandLineOption fpsOption(QStringList() << "fps",
+                                 QCoreApplication::translate("main", "Synthetic camera and output <fps>."),
+                                 QCoreApplication::translate("main", "fps"),
+                                 QLatin1String("30"));
+    parser.addOption(fpsOption);
+
+    QCommandLineOption queueOption(QStringList() << "queue",
+                                   QCoreApplication::translate("main", "Set encoder queue length as <frames>."),
+                                   QCoreApplication::translate("main", "frames"),
+                                   QLatin1String("32"));
+    parser.addOption(queueOption);
+
+    QCommandLineOption threadsOption(QStringList() << "encode-threads",
+                                     QCoreApplication::translate("main", "Compress MJPG frames on <threads>."),
+                                     QCoreApplication::translate("main", "threads"),
+                                     QLatin1String("1"));
+    parser.addOption(threadsOption);
+
+    QCommandLineOption writeBehindOption(QStringList() << "write-behind",
+                                         QCoreApplication::translate("main", "Write MJPG files behind encoder in <megabytes> blocks."),
+                                         QCoreApplication::translate("main", "megabytes"),
+                                         QLatin1String("0"));
+    parser.addOption(writeBehindOption);
+
+    QCommandLineOption adaptiveOption(QStringList() << "adaptive",
+                                      QCoreApplication::translate("main", "Lower JPEG quality down to <quality> while encoder falls behind."),
+                                      QCoreApplication::translate("main", "quality"),
+                                      QLatin1String("0"));
+    parser.addOption(adaptiveOption);
+
+    QCommandLineOption processOption(QStringList() << "store-process",
+                                     QCoreApplication::translate("main", "Process stored frames by <steps> joined by '+': crop=x,y,w,h, half, gray."),
+                                     QCoreApplication::translate("main", "steps"));
+    parser.addOption(processOption);
+
+    QCommandLineOption skipOption(QStringList() << "skip-similar",
+                                  QCoreApplication::translate("main", "Skip frames differing from the last stored one by less than <difference> (0-255)."),
+                                  QCoreApplication::translate("main", "difference"),
+                                  QLatin1String("0"));
+    parser.addOption(skipOption);
+
+    QCommandLineOption kernelsOption(QStringList() << "kernels",
+                                     QCoreApplication::translate("main", "Measure processing kernels on frame sizes, scalar against vector, and exit."));
+    parser.addOption(kernelsOption);
+
+    QCommandLineOption serialOption(QStringList() << "serial",
+                                    QCoreApplication::translate("main", "Measure serial reader thread latency on pseudo terminal with <count> bytes and exit."),
+                                    QCoreApplication::translate("main", "count"));
+    parser.addOption(serialOption);
+
+    QCommandLineOption parserOption(QStringList() << "check-parser",
+                                    QCoreApplication::translate("main", "Check command parser recovery from noise and exit."));
+    parser.addOption(parserOption);
+
+    QCommandLineOption ringOption(QStringList() << "shm-consumer",
+                                  QCoreApplication::translate("main", "Read frames from shared memory ring during run, spending <us> on every frame."),
+                                  QCoreApplication::translate("main", "us"));
+    parser.addOption(ringOption);
+
+    QCommandLineOption overflowOption(QStringList() << "overflow",
+                                      QCoreApplication::translate("main", "Set full encoder queue policy as <policy> (block, drop-oldest, drop-newest)."),
+                                      QCoreApplication::translate("main", "policy"),
+                                      QLatin1String("drop-newest"));
+    parser.addOption(overflowOption);
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    QCoreApplication::translate("main", "Write videos to <dir>."),
+                                    QCoreApplication::translate("main", "dir"),
+                                    QDir::tempPath());
+    parser.addOption(outputOption);
+
+    parser.process(a);
+
+    if (parser.isSet(kernelsOption))
+    {
+        QVector<cv::Size> kernelSizes;
+        foreach (const QString &sizeText, parser.value(sizesOption).split(',', QString::SkipEmptyParts))
+        {
+            QStringList dims = sizeText.split('x');
+            if (dims.size() != 2 || dims.at(0).toInt() <= 0 || dims.at(1).toInt() <= 0)
+            {
+                qWarning() << __FILE__ << __LINE__ << "Bad size:" << sizeText;
+                continue;
+            }
+            kernelSizes << cv::Size(dims.at(0).toInt(), dims.at(1).toInt());
+        }
+
+        QTextStream out(stdout);
+        return KernelBench().run(kernelSizes, out) ? 0 : 1;
+    }
+
+    if (parser.isSet(serialOption))
+    {
+        QTextStream out(stdout);
+        return SerialBench(parser.value(serialOption).toInt()).run(out) ? 0 : 1;
+    }
+
+    if (parser.isSet(parserOption))
+    {
+        QTextStream out(stdout);
+        return SerialBench::checkParser(out) ? 0 : 1;
+    }
+
+    QVector<qint64> times;
+    if (parser.isSet(triggersOption))
+    {
+        if (!TriggerPlayer::load(parser.value(triggersOption), times))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        times = TriggerPlayer::uniform(parser.value(rateOption).toDouble(), parser.value(durationOption).toDouble());
+    }
+
+    if (times.isEmpty())
+    {
+        qWarning() << __FILE__ << __LINE__ << "No triggers to replay";
+        return 1;
+    }
+
+    QStringList images;
+    if (parser.isSet(imagesOption))
+    {
+        QDir dir(parser.value(imagesOption));
+        foreach (const QString &name, dir.entryList(QStringList() << "*.png" << "*.jpg" << "*.bmp", QDir::Files, QDir::Name))
+        {
+            images << dir.filePath(name);
+        }
+    }
+
+    EncoderThread::OverflowPolicy policy = EncoderThread::DropNewest;
+    if (!EncoderThread::policyFromString(parser.value(overflowOption), policy))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Bad overflow policy";
+        return 1;
+    }
+
+    BenchOptions options;
+    options.output = parser.value(outputOption);
+    options.fps = qMax(parser.value(fpsOption).toInt(), 1);
+    options.queue = qMax(parser.value(queueOption).toInt(), 1);
+    options.overflow = policy;
+    options.images = images;
+    options.source = parser.value(sourceOption);
+    options.encoderThreads = qMax(parser.value(threadsOption).toInt(), 1);
+    options.writeBehind = qMax(parser.value(writeBehindOption).toInt(), 0);
+    options.adaptiveQuality = qBound(0, parser.value(adaptiveOption).toInt(), 100);
+    options.process = parser.value(processOption);
+    options.skipThreshold = parser.value(skipOption).toDouble();
+    options.ringConsumerUs = parser.isSet(ringOption) ? qMax(parser.value(ringOption).toInt(), 0) : -1;
+
+    // Real source has its own size, so it is measured once per codec.
+    QStringList sizes = parser.value(sizesOption).split(',', QString::SkipEmptyParts);
+    if (!options.source.isEmpty())
+    {
+        sizes = QStringList() << options.source;
+    }
+
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+           .arg("codec", -6).arg("size", -10).arg("triggers", 9).arg("written", 8).arg("dropped", 8)
+           .arg("trig/s", 8).arg("sust/s", 8).arg("p50 ms", 8).arg("p99 ms", 8).arg("max ms", 8) << endl;
+
+    foreach (const QString &codec, parser.value(codecsOption).split(',', QString::SkipEmptyParts))
+    {
+        if (codec.size() != 4)
+        {
+            qWarning() << __FILE__ << __LINE__ << "Bad codec:" << codec;
+            continue;
+        }
+
+        foreach (const QString &sizeText, sizes)
+        {
+            QStringList dims = sizeText.split('x');
+            cv::Size size;
+            if (options.source.isEmpty())
+            {
+                if (dims.size() != 2 || dims.at(0).toInt() <= 0 || dims.at(1).toInt() <= 0)
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad size:" << sizeText;
+                    continue;
+                }
+                size = cv::Size(dims.at(0).toInt(), dims.at(1).toInt());
+            }
+
+            BenchResult result;
+            if (!runBench(size, codec, options, times, result))
+            {
+                continue;
+            }
+
+            out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+                   .arg(codec, -6).arg(QString("%1x%2").arg(result.size.width).arg(result.size.height), -10)
+                   .arg(result.triggers, 9).arg(result.written, 8).arg(result.dropped, 8)
+                   .arg(result.triggerRate, 8, 'f', 1).arg(result.sustainedRate, 8, 'f', 1)
+                   .arg(result.p50, 8, 'f', 2).arg(result.p99, 8, 'f', 2).arg(result.max, 8, 'f', 2) << endl;
+            if (options.ringConsumerUs >= 0)
+            {
+                // Torn frames were overwritten while used, they are counted as overrun too.
+                out << QString("  shm consumer: read %1 overrun %2 retries %3 torn %4")
+                       .arg(result.ring.read).arg(result.ring.overrun).arg(result.ring.retries).arg(result.ring.torn) << endl;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <QDebug>
+#include "ringconsumer.h"
+#include "sharedframering.h"
+
+//!
+//! \brief Object constructor.
+//! \param name Represents ring name given to recorder.
+//! \param workUs Represents time spent on every frame in us, longer than frame period makes consumer lag.
+//! \param parent Represents parent of object.
+//!
+RingConsumer::RingConsumer(const QString &name, int workUs, QObject *parent) :
+    QThread(parent),
+    _name(name),
+    _workUs(qMax(workUs, 0)),
+    _read(0),
+    _overrun(0),
+    _retries(0),
+    _torn(0),
+    _checksum(0)
+{
+}
+
+//!
+//! \brief Method stops consumer and waits for it.
+//!
+void RingConsumer::stop(void)
+{
+    this->requestInterruption();
+    this->wait();
+}
+
+//!
+//! \brief Getter for consumer counters.
+//! \return Returns counts since start.
+//!
+RingConsumer::Counters RingConsumer::counters(void) const
+{
+    Counters counters;
+    counters.read = this->_read.load();
+    counters.overrun = this->_overrun.load();
+    counters.retries = this->_retries.load();
+    counters.torn = this->_torn.load();
+    return counters;
+}
+
+//!
+//! \brief Consumer loop. Reads frames in publish order until stopped.
+//!
+void RingConsumer::run(void)
+{
+    SharedFrameReader reader;
+    if (!reader.open(this->_name))
+    {
+        return;
+    }
+
+    const quint64 slotCount = quint64(reader.slotCount());
+    quint64 next = reader.published();
+    while (!this->isInterruptionRequested())
+    {
+        quint64 published = reader.published();
+        if (next >= published)
+        {
+            QThread::usleep(100);
+            continue;
+        }
+
+        // Writer does not wait, frames older than ring length are gone.
+        if (published - next > slotCount)
+        {
+            this->_overrun += published - slotCount - next;
+            next = published - slotCount;
+        }
+
+        SharedFrameReader::Frame frame;
+        if (!reader.frame(next, frame))
+        {
+            // Slot is being rewritten; next pass reads it or counts it as overrun.
+            ++this->_retries;
+            continue;
+        }
+
+        quint64 sum = 0;
+        for (size_t i = 0; i < frame.bytes; i += 64)
+        {
+            sum += frame.data[i];
+        }
+        if (this->_workUs > 0)
+        {
+            QThread::usleep(this->_workUs);
+        }
+
+        if (!reader.isValid(frame))
+        {
+            // Data changed while used, result is thrown away.
+            ++this->_torn;
+            continue;
+        }
+        this->_checksum += sum;
+        ++this->_read;
+        ++next;
+    }
+}
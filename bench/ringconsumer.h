@@ -0,0 +1,44 @@
+#ifndef RINGCONSUMER_H
+#define RINGCONSUMER_H
+
+#include <QThread>
+#include <QString>
+#include <atomic>
+
+//!
+//! \brief Local consumer of shared frame ring used by benchmark.
+//! Follows every published frame, touches its payload and spends given
+//! time on it like a slow analysis process would. Counted are frames read,
+//! frames overwritten before they were reached, retries while writer was
+//! filling the slot and frames overwritten while they were being used.
+//!
+class RingConsumer : public QThread
+{
+    Q_OBJECT
+public:
+    struct Counters {
+        quint64 read;
+        quint64 overrun;
+        quint64 retries;
+        quint64 torn;
+    };
+
+public:
+    explicit RingConsumer(const QString &name, int workUs = 0, QObject *parent = 0);
+    void stop(void);
+    Counters counters(void) const;
+
+protected:
+    void run(void);
+
+private:
+    QString _name;
+    int _workUs;
+    std::atomic<quint64> _read;
+    std::atomic<quint64> _overrun;
+    std::atomic<quint64> _retries;
+    std::atomic<quint64> _torn;
+    std::atomic<quint64> _checksum;
+};
+
+#endif // RINGCONSUMER_H
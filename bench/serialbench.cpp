@@ -0,0 +1,148 @@
+#include <QDebug>
+#include <QThread>
+#include "serialbench.h"
+#include "commandparser.h"
+#include "monotonicclock.h"
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "serialthread.h"
+#endif
+
+//!
+//! \brief Object constructor.
+//! \param count Represents number of trigger bytes sent.
+//! \param intervalUs Represents pause between bytes in us.
+//! \param parent Represents parent of object.
+//!
+SerialBench::SerialBench(int count, int intervalUs, QObject *parent) :
+    QObject(parent),
+    _count(qMax(count, 1)),
+    _intervalUs(qMax(intervalUs, 0)),
+    _writeTimestamp(0)
+{
+}
+
+//!
+//! \brief Method sends bytes one by one and waits for each of them.
+//! \param out Represents stream for result table.
+//! \return Returns false if pseudo terminal could not be opened or bytes were lost.
+//!
+bool SerialBench::run(QTextStream &out)
+{
+#ifdef Q_OS_LINUX
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot create pseudo terminal";
+        if (master >= 0)
+        {
+            ::close(master);
+        }
+        return false;
+    }
+
+    SerialThread reader;
+    connect(&reader, SIGNAL(dataReceived(QByteArray,qint64)), this, SLOT(received(QByteArray,qint64)), Qt::DirectConnection);
+    if (!reader.open(QString::fromLocal8Bit(ptsname(master)), 115200, QSerialPort::Data8, QSerialPort::NoParity,
+                     QSerialPort::OneStop, QSerialPort::NoFlowControl))
+    {
+        ::close(master);
+        return false;
+    }
+    reader.start(QThread::TimeCriticalPriority);
+
+    this->_latency.reset();
+    int lost = 0;
+    for (int i = 0; i < this->_count; ++i)
+    {
+        this->_writeTimestamp.store(monotonicNs());
+        if (::write(master, "a", 1) != 1 || !this->_bytes.tryAcquire(1, 1000))
+        {
+            ++lost;
+        }
+        if (this->_intervalUs > 0)
+        {
+            QThread::usleep(this->_intervalUs);
+        }
+    }
+
+    reader.stop();
+    ::close(master);
+
+    out << QString("%1 %2 %3 %4 %5 %6")
+           .arg("serial", -24).arg("bytes", 8).arg("lost", 6).arg("p50 us", 8).arg("p99 us", 8).arg("max us", 8) << endl;
+    out << QString("%1 %2 %3 %4 %5 %6")
+           .arg(reader.description(), -24).arg(this->_count, 8).arg(lost, 6)
+           .arg(double(this->_latency.percentile(50.0)) / 1e3, 8, 'f', 1)
+           .arg(double(this->_latency.percentile(99.0)) / 1e3, 8, 'f', 1)
+           .arg(double(this->_latency.max()) / 1e3, 8, 'f', 1) << endl;
+    return lost == 0;
+#else
+    out << "Serial reader thread is not supported on this system" << endl;
+    return false;
+#endif
+}
+
+//!
+//! \brief Function feeds command parser with noisy byte sequences and checks its commands.
+//! Bytes follow each other by 1 ms, marked byte comes after frame timeout.
+//! \param out Represents stream for result table.
+//! \return Returns false if any sequence gives wrong command.
+//!
+bool SerialBench::checkParser(QTextStream &out)
+{
+    struct Case {
+        const char *name;
+        const char *bytes;
+        int size;
+        int gapBefore;                      // index of byte coming after timeout, -1 for none
+        CommandParser::Command expected;    // command of last byte, others give none
+    };
+    static const Case cases[] = {
+        { "trigger", "a", 1, -1, CommandParser::TriggerCommand },
+        { "burst", "b\x03\x00\xe8\x03\x00\x00", 7, -1, CommandParser::BurstCommand },
+        { "lone burst byte", "ba", 2, 1, CommandParser::TriggerCommand },
+        { "partial burst argument", "b\x03\x00" "a", 4, 3, CommandParser::TriggerCommand },
+        { "lone sync byte", "\xa5" "a", 2, 1, CommandParser::TriggerCommand },
+        { "sync before trigger", "\xa5" "a", 2, -1, CommandParser::TriggerCommand },
+        { "sync before quit", "\xa5\xff" "q", 3, -1, CommandParser::QuitCommand },
+        { "partial frame", "\xa5\x00\x07" "a", 4, 3, CommandParser::TriggerCommand }
+    };
+
+    const qint64 byteNs = 1000000;
+    const qint64 gapNs = qint64(CommandParser::FrameTimeoutMs) * 2 * byteNs;
+    int failed = 0;
+    out << QString("%1 %2").arg("parser check", -24).arg("result", 8) << endl;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        const Case &item = cases[i];
+        CommandParser parser;
+        qint64 timestamp = byteNs;
+        bool ok = true;
+        for (int j = 0; j < item.size; ++j)
+        {
+            timestamp += j == item.gapBefore ? gapNs : byteNs;
+            CommandParser::Command command = parser.feed(item.bytes[j], timestamp);
+            ok = ok && command == (j == item.size - 1 ? item.expected : CommandParser::NoCommand);
+        }
+        if (!ok)
+        {
+            ++failed;
+        }
+        out << QString("%1 %2").arg(item.name, -24).arg(ok ? "ok" : "FAILED", 8) << endl;
+    }
+    return failed == 0;
+}
+
+//!
+//! \brief Method records receive stamp of byte. Called on reader thread.
+//! \param data Represents received bytes.
+//! \param receiveTimestamp Represents monotonic time in ns stamped after read.
+//!
+void SerialBench::received(const QByteArray &data, qint64 receiveTimestamp)
+{
+    this->_latency.record(receiveTimestamp - this->_writeTimestamp.load());
+    this->_bytes.release(data.size());
+}
@@ -0,0 +1,34 @@
+#ifndef SERIALBENCH_H
+#define SERIALBENCH_H
+
+#include <QObject>
+#include <QSemaphore>
+#include <QTextStream>
+#include <atomic>
+#include "latencyhistogram.h"
+
+//!
+//! \brief Latency test of serial reader thread on pseudo terminal pair.
+//! Single trigger bytes are written to master side, reader thread opens
+//! slave side as serial port; measured is time from write to receive stamp.
+//!
+class SerialBench : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SerialBench(int count = 1000, int intervalUs = 1000, QObject *parent = 0);
+    bool run(QTextStream &out);
+    static bool checkParser(QTextStream &out);
+
+private slots:
+    void received(const QByteArray &data, qint64 receiveTimestamp);
+
+private:
+    int _count;
+    int _intervalUs;
+    QSemaphore _bytes;
+    std::atomic<qint64> _writeTimestamp;
+    LatencyHistogram _latency;
+};
+
+#endif // SERIALBENCH_H
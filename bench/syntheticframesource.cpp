@@ -0,0 +1,126 @@
+#include <QDebug>
+#include <cstring>
+#include <opencv2/highgui/highgui.hpp>  // Image read
+#include <opencv2/imgproc/imgproc.hpp>  // Resize
+#include "syntheticframesource.h"
+
+//!
+//! \brief Object constructor. Prepares all frames before capture starts.
+//! \param size Represents size of delivered frames.
+//! \param fps Represents frame rate of simulated camera.
+//! \param images Represents image files played in loop, generated pattern is used if empty.
+//!
+SyntheticFrameSource::SyntheticFrameSource(cv::Size size, double fps, const QStringList &images) :
+    _size(size),
+    _fps(fps > 0.0 ? fps : 30.0),
+    _nextFrame(0),
+    _index(0),
+    _opened(true)
+{
+    foreach (const QString &fileName, images)
+    {
+        cv::Mat image = cv::imread(fileName.toStdString(), CV_LOAD_IMAGE_COLOR);
+        if (image.empty())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Cannot read image:" << fileName;
+            continue;
+        }
+
+        cv::Mat resized;
+        cv::resize(image, resized, this->_size, 0, 0, CV_INTER_AREA);
+        this->_images.push_back(resized);
+    }
+
+    if (this->_images.empty())
+    {
+        // Gradient background, a moving bar is drawn over it per frame.
+        this->_pattern.create(this->_size, CV_8UC3);
+        for (int y = 0; y < this->_size.height; ++y)
+        {
+            uchar *row = this->_pattern.ptr(y);
+            for (int x = 0; x < this->_size.width; ++x)
+            {
+                row[3 * x + 0] = uchar(x * 255 / qMax(this->_size.width - 1, 1));
+                row[3 * x + 1] = uchar(y * 255 / qMax(this->_size.height - 1, 1));
+                row[3 * x + 2] = uchar((x ^ y) & 0xff);
+            }
+        }
+    }
+}
+
+//!
+//! \brief Object destructor.
+//!
+SyntheticFrameSource::~SyntheticFrameSource()
+{
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool SyntheticFrameSource::isOpened(void) const
+{
+    return this->_opened;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+void SyntheticFrameSource::release(void)
+{
+    this->_opened = false;
+}
+
+//!
+//! \brief Overloaded method. Blocks until next frame is due, like real camera.
+//!
+bool SyntheticFrameSource::read(cv::Mat &image)
+{
+    if (!this->_opened)
+    {
+        return false;
+    }
+
+    FrameSource::waitForNextFrame(this->_nextFrame, this->_fps);
+
+    if (!this->_images.empty())
+    {
+        this->_images[this->_index % this->_images.size()].copyTo(image);
+    }
+    else
+    {
+        this->_pattern.copyTo(image);
+        int barWidth = qMax(this->_size.width / 32, 1);
+        int barX = int((this->_index * 8) % quint64(qMax(this->_size.width - barWidth, 1)));
+        for (int y = 0; y < image.rows; ++y)
+        {
+            memset(image.ptr(y) + 3 * barX, 255, 3 * barWidth);
+        }
+    }
+    ++this->_index;
+    return true;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+cv::Size SyntheticFrameSource::frameSize(void) const
+{
+    return this->_size;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+double SyntheticFrameSource::fps(void) const
+{
+    return this->_fps;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString SyntheticFrameSource::description(void) const
+{
+    return QString("synthetic %1x%2 %3 images").arg(this->_size.width).arg(this->_size.height).arg(this->_images.size());
+}
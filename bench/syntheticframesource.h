@@ -0,0 +1,36 @@
+#ifndef SYNTHETICFRAMESOURCE_H
+#define SYNTHETICFRAMESOURCE_H
+
+#include <QStringList>
+#include <vector>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "framesource.h"
+
+//!
+//! \brief Camera stand-in delivering frames at fixed rate.
+//! Frames are generated or taken from image sequence, so recorder can be
+//! measured without hardware.
+//!
+class SyntheticFrameSource : public FrameSource
+{
+public:
+    SyntheticFrameSource(cv::Size size, double fps, const QStringList &images = QStringList());
+    virtual ~SyntheticFrameSource();
+    virtual bool isOpened(void) const;
+    virtual bool read(cv::Mat &image);
+    virtual cv::Size frameSize(void) const;
+    virtual double fps(void) const;
+    virtual void release(void);
+    virtual QString description(void) const;
+
+private:
+    cv::Size _size;
+    double _fps;
+    std::vector<cv::Mat> _images;
+    cv::Mat _pattern;
+    qint64 _nextFrame;
+    quint64 _index;
+    bool _opened;
+};
+
+#endif // SYNTHETICFRAMESOURCE_H
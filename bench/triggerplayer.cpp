@@ -0,0 +1,144 @@
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include "triggerplayer.h"
+#include "camerathread.h"
+#include "monotonicclock.h"
+
+//!
+//! \brief Object constructor.
+//! \param camera Represents recorder receiving triggers.
+//! \param times Represents trigger times in ns from start, ascending.
+//! \param parent Represents parent of object.
+//!
+TriggerPlayer::TriggerPlayer(CameraThread *camera, const QVector<qint64> &times, QObject *parent) :
+    QObject(parent),
+    _camera(camera),
+    _times(times),
+    _next(0),
+    _start(0),
+    _end(0)
+{
+    this->_timer.setSingleShot(true);
+    this->_timer.setTimerType(Qt::PreciseTimer);
+    connect(&this->_timer, SIGNAL(timeout()), this, SLOT(play()));
+}
+
+//!
+//! \brief Method starts replay.
+//!
+void TriggerPlayer::start(void)
+{
+    this->_next = 0;
+    this->_start = monotonicNs();
+    this->play();
+}
+
+//!
+//! \brief Getter for number of sent triggers.
+//! \return Returns number of triggers passed to recorder.
+//!
+quint64 TriggerPlayer::sent(void) const
+{
+    return quint64(this->_next);
+}
+
+//!
+//! \brief Getter for replay duration.
+//! \return Returns ns from start to last trigger.
+//!
+qint64 TriggerPlayer::duration(void) const
+{
+    return this->_end - this->_start;
+}
+
+//!
+//! \brief Method sends all due triggers in one chunk, like serial driver does, and schedules next call.
+//!
+void TriggerPlayer::play(void)
+{
+    qint64 now = monotonicNs();
+    int due = 0;
+    while (this->_next + due < this->_times.size() && this->_start + this->_times[this->_next + due] <= now)
+    {
+        ++due;
+    }
+
+    if (due > 0)
+    {
+        this->_camera->processRSData(QByteArray(due, 'a'), now);
+        this->_next += due;
+    }
+
+    if (this->_next >= this->_times.size())
+    {
+        this->_end = now;
+        emit finished();
+        return;
+    }
+
+    qint64 wait = this->_start + this->_times[this->_next] - monotonicNs();
+    this->_timer.start(int(qMax(wait / 1000000, qint64(0))));
+}
+
+//!
+//! \brief Method reads trigger timing file.
+//! \param fileName Represents file with one trigger time in ms from start per line, '#' starts comment.
+//! \param times Represents output times in ns.
+//! \return Returns false if file cannot be read.
+//!
+bool TriggerPlayer::load(const QString &fileName, QVector<qint64> &times)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot open trigger file:" << fileName;
+        return false;
+    }
+
+    times.clear();
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith("#"))
+        {
+            continue;
+        }
+
+        bool ok = false;
+        double ms = line.split(',').at(0).toDouble(&ok);
+        if (!ok)
+        {
+            qWarning() << __FILE__ << __LINE__ << "Bad trigger time:" << line;
+            continue;
+        }
+        times.append(qint64(ms * 1e6));
+    }
+
+    std::sort(times.begin(), times.end());
+    return true;
+}
+
+//!
+//! \brief Method builds evenly spaced trigger times.
+//! \param rate Represents triggers per second.
+//! \param seconds Represents replay length.
+//! \return Returns trigger times in ns.
+//!
+QVector<qint64> TriggerPlayer::uniform(double rate, double seconds)
+{
+    QVector<qint64> times;
+    if (rate <= 0.0)
+    {
+        return times;
+    }
+
+    int count = int(rate * seconds);
+    for (int i = 0; i < count; ++i)
+    {
+        times.append(qint64(double(i) * 1e9 / rate));
+    }
+    return times;
+}
@@ -0,0 +1,39 @@
+#ifndef TRIGGERPLAYER_H
+#define TRIGGERPLAYER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+class CameraThread;
+
+//!
+//! \brief In-process stand-in for serial port replaying recorded trigger times.
+//!
+class TriggerPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    TriggerPlayer(CameraThread *camera, const QVector<qint64> &times, QObject *parent = 0);
+    void start(void);
+    quint64 sent(void) const;
+    qint64 duration(void) const;
+    static bool load(const QString &fileName, QVector<qint64> &times);
+    static QVector<qint64> uniform(double rate, double seconds);
+
+signals:
+    void finished(void);
+
+private slots:
+    void play(void);
+
+private:
+    CameraThread *_camera;
+    QVector<qint64> _times;
+    QTimer _timer;
+    int _next;
+    qint64 _start;
+    qint64 _end;
+};
+
+#endif // TRIGGERPLAYER_H
@@ -0,0 +1,178 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+#include <utility>
+
+//!
+//! \brief Fixed capacity lock-free queue. Any thread may push or pop.
+//!
+//! Every cell carries sequence number telling whether it is free for the
+//! producer or filled for the consumer, so no locks are taken. Capacity is
+//! rounded up to power of two.
+//!
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int capacity);
+
+    bool tryPush(T &&item);
+    bool tryPop(T &item);
+    int capacity(void) const;
+    int size(void) const;
+    static int capacityFor(int capacity);
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+private:
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue &operator=(const BoundedQueue &);
+
+private:
+    std::vector<Cell> _cells;
+    size_t _mask;
+    std::atomic<size_t> _enqueuePos;
+    std::atomic<size_t> _dequeuePos;
+};
+
+//!
+//! \brief Object constructor. Allocates all cells.
+//! \param capacity Represents minimal number of items queue can hold.
+//!
+template <typename T>
+BoundedQueue<T>::BoundedQueue(int capacity) :
+    _mask(0),
+    _enqueuePos(0),
+    _dequeuePos(0)
+{
+    size_t size = size_t(capacityFor(capacity));
+    std::vector<Cell> cells(size);
+    this->_cells.swap(cells);
+    for (size_t i = 0; i < size; ++i)
+    {
+        this->_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    this->_mask = size - 1;
+}
+
+//!
+//! \brief Method puts item at the end of queue.
+//! \param item Represents item, moved into queue on success.
+//! \return Returns false if queue is full.
+//!
+template <typename T>
+bool BoundedQueue<T>::tryPush(T &&item)
+{
+    Cell *cell = nullptr;
+    size_t pos = this->_enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &this->_cells[pos & this->_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+        if (diff == 0)
+        {
+            if (this->_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = this->_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+//!
+//! \brief Method takes item from the front of queue.
+//! \param item Represents destination of taken item.
+//! \return Returns false if queue is empty.
+//!
+template <typename T>
+bool BoundedQueue<T>::tryPop(T &item)
+{
+    Cell *cell = nullptr;
+    size_t pos = this->_dequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &this->_cells[pos & this->_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+        if (diff == 0)
+        {
+            if (this->_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = this->_dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    item = std::move(cell->data);
+    cell->data = T();
+    cell->sequence.store(pos + this->_mask + 1, std::memory_order_release);
+    return true;
+}
+
+//!
+//! \brief Getter for capacity.
+//! \return Returns maximal number of items.
+//!
+template <typename T>
+int BoundedQueue<T>::capacity(void) const
+{
+    return int(this->_mask + 1);
+}
+
+//!
+//! \brief Method gives capacity of queue created for given number of items.
+//! \param capacity Represents minimal number of items queue can hold.
+//! \return Returns capacity rounded up to power of two.
+//!
+template <typename T>
+int BoundedQueue<T>::capacityFor(int capacity)
+{
+    int size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+//!
+//! \brief Method estimates number of queued items.
+//! \return Returns number of items, exact only when queue is not modified concurrently.
+//!
+template <typename T>
+int BoundedQueue<T>::size(void) const
+{
+    size_t enqueuePos = this->_enqueuePos.load(std::memory_order_relaxed);
+    size_t dequeuePos = this->_dequeuePos.load(std::memory_order_relaxed);
+    return enqueuePos > dequeuePos ? int(enqueuePos - dequeuePos) : 0;
+}
+
+#endif // BOUNDEDQUEUE_H
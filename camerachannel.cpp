@@ -0,0 +1,401 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include "camerachannel.h"
+#include "capturethread.h"
+#include "framepool.h"
+#include "frameprocessor.h"
+#include "changedetector.h"
+#include "framesource.h"
+#include "framesink.h"
+#include "mjpegavisink.h"
+#include "timestamplog.h"
+#include "pretriggerbuffer.h"
+#include "recorderstats.h"
+#include "sharedframepublisher.h"
+
+static const qint64 AviSegmentMargin = 16 * 1024 * 1024;    // room for last frame and index behind byte limit
+
+//!
+//! \brief Object constructor.
+//! \param index Represents camera position in recorder, used in names.
+//! \param source Represents capture backend, object takes ownership of it.
+//!
+CameraChannel::CameraChannel(int index, FrameSource *source) :
+    _index(index),
+    _source(source),
+    _pool(nullptr),
+    _outputPool(nullptr),
+    _processor(nullptr),
+    _capture(nullptr),
+    _sink(nullptr),
+    _encoder(nullptr),
+    _timestampLog(nullptr),
+    _changeDetector(nullptr),
+    _preTrigger(nullptr),
+    _publisher(nullptr),
+    _adjustableQuality(false)
+{
+}
+
+//!
+//! \brief Object destructor. Stops threads and finishes output file.
+//!
+CameraChannel::~CameraChannel()
+{
+    // Capture thread uses camera, so it has to end first.
+    delete this->_capture;
+    delete this->_publisher;
+
+    // Encoder writes queued frames before it ends.
+    if (this->_encoder != nullptr)
+    {
+        this->_encoder->stop();
+        EncoderThread::Counters counters = this->_encoder->counters();
+        qDebug() << __FILE__ << "camera" << this->_index << "frames enqueued:" << counters.enqueued
+                 << "written:" << counters.written << "dropped oldest:" << counters.droppedOldest
+                 << "dropped newest:" << counters.droppedNewest << "not written:" << counters.failed
+                 << "skipped similar:" << counters.skipped
+                 << "max queue depth:" << counters.maxDepth;
+        delete this->_encoder;
+    }
+    delete this->_timestampLog;
+    delete this->_changeDetector;
+    delete this->_preTrigger;
+
+    if (this->_sink != nullptr)
+    {
+        this->_sink->release();
+        delete this->_sink;
+    }
+
+    if (this->_source != nullptr)
+    {
+        this->_source->release();
+        delete this->_source;
+    }
+
+    // Every frame taken from pool is released together with threads above.
+    if (this->_pool != nullptr)
+    {
+        qDebug() << __FILE__ << "camera" << this->_index << "frame heap allocations:" << this->_pool->heapAllocations();
+        delete this->_pool;
+    }
+    delete this->_processor;
+    delete this->_outputPool;
+}
+
+//!
+//! \brief Method creates frame pool and capture thread only, used for preview without recording.
+//! \param queuedFrames Represents number of frames held by encoder the pool has to cover.
+//! \return Returns false if camera is not opened.
+//!
+bool CameraChannel::initCapture(int queuedFrames)
+{
+    if (this->_source == nullptr || !this->_source->isOpened())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot open camera" << this->_index
+                   << (this->_source != nullptr ? this->_source->description() : QString());
+        return false;
+    }
+
+    // Ring slots, queued frames, frame being written, copied on trigger and two held by preview.
+    const int ringFrames = 4;
+    cv::Size S = this->_source->frameSize();
+    this->_pool = new FramePool(size_t(S.width) * size_t(S.height) * 3, ringFrames + queuedFrames + 4);
+    this->_capture = new CaptureThread(this->_source, S, this->_pool, ringFrames);
+    this->_capture->setObjectName(QString("capture %1").arg(this->_index));
+    return true;
+}
+
+//!
+//! \brief Method creates whole recording path.
+//! \param settings Represents output and queue settings.
+//! \param stats Represents stats shared by all channels, nullptr disables measurements.
+//! \return Returns false if camera or output file could not be opened.
+//!
+bool CameraChannel::init(const Settings &settings, RecorderStats *stats)
+{
+    // Parallel encoder keeps two frames per thread besides the queue, full queue holds its rounded capacity.
+    int encoderFrames = settings.encoderThreads > 1 ? 2 * settings.encoderThreads : 0;
+    int queuedFrames = BoundedQueue<RecordedFrame>::capacityFor(settings.queueSize);
+    if (!this->initCapture(queuedFrames + encoderFrames))
+    {
+        return false;
+    }
+    this->_pool->setStats(stats);
+
+    cv::Size S = this->_source->frameSize();
+    cv::Size outputSize = S;
+    if (!settings.process.isEmpty())
+    {
+        if (this->_source->isCompressed())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Camera" << this->_index << "delivers JPEG, processing ignored:" << settings.process;
+        }
+        else
+        {
+            this->_processor = new FrameProcessor();
+            if (!this->_processor->parse(settings.process) || this->_processor->outputSize(S).area() == 0)
+            {
+                qWarning() << __FILE__ << __LINE__ << "Bad processing for camera" << this->_index << settings.process;
+                return false;
+            }
+
+            // Processed frame lives from processing until it is written, parallel encoder holds more.
+            outputSize = this->_processor->outputSize(S);
+            size_t outputBytes = size_t(outputSize.width) * size_t(outputSize.height) * CV_ELEM_SIZE(this->_processor->outputType());
+            this->_outputPool = new FramePool(outputBytes, encoderFrames + 2);
+            this->_outputPool->setStats(stats);
+        }
+    }
+
+    this->_videoName = settings.videoName;
+    SegmentedSink::Limits limits = settings.segmentLimits;
+    const qint64 aviLimit = qint64(MjpegAviSink::MaxFileSize) - AviSegmentMargin;
+    if (FrameSink::writesAvi(settings.codec, this->_source->isCompressed(), settings.encoderThreads, settings.writeBehindBuffer)
+            && (limits.bytes <= 0 || limits.bytes > aviLimit))
+    {
+        // AVI file stops accepting frames at 2 GB, long recording continues in next segment then
+        limits.bytes = aviLimit;
+    }
+    if (limits.frames > 0 || limits.seconds > 0.0 || limits.bytes > 0)
+    {
+        this->_sink = new SegmentedSink(this->_videoName, settings.codec, double(settings.fps), outputSize, this->_source->isCompressed(), limits,
+                                        settings.encoderThreads, settings.writeBehindBuffer);
+    }
+    else
+    {
+        this->_sink = FrameSink::create(this->_videoName, settings.codec, double(settings.fps), outputSize, this->_source->isCompressed(),
+                                        settings.encoderThreads, settings.writeBehindBuffer);
+    }
+
+    qDebug() << __FILE__ << "camera" << this->_index << this->_source->description() << outputSize.height << outputSize.width
+             << settings.fps << this->_sink->description()
+             << "processing:" << (this->_processor != nullptr ? this->_processor->description() : QString("none"));
+
+    if (!this->_sink->isOpened())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open the output video for write: " << this->_videoName;
+        return false;
+    }
+    if (!FrameSink::writesIndex(settings.codec, this->_source->isCompressed(), settings.encoderThreads, settings.writeBehindBuffer))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Camera" << this->_index << "output has no frame index for FrameExtract, use --raw or --codec MJPG with --encode-threads or --write-behind";
+    }
+
+    // Camera JPEG is not compressed again; sink is asked while encoder does not run yet.
+    this->_adjustableQuality = !this->_source->isCompressed() && this->_sink->setQuality(90);
+
+    this->_encoder = new EncoderThread(this->_sink, settings.queueSize, settings.overflowPolicy);
+    this->_encoder->setObjectName(QString("encode %1").arg(this->_index));
+    this->_capture->setStats(stats);
+    this->_capture->setEncoder(this->_encoder);
+    this->_encoder->setStats(stats);
+    this->_encoder->setProcessor(this->_processor, this->_outputPool);
+
+    this->_timestampLog = new TimestampLog();
+    if (this->_timestampLog->open(TimestampLog::fileNameForVideo(this->_videoName)))
+    {
+        this->_encoder->setTimestampLog(this->_timestampLog);
+    }
+
+    if (settings.skipThreshold > 0.0)
+    {
+        if (this->_source->isCompressed())
+        {
+            // JPEG bytes do not tell how much scene changed.
+            qWarning() << __FILE__ << __LINE__ << "Camera" << this->_index << "delivers JPEG, frame skipping ignored";
+        }
+        else
+        {
+            this->_changeDetector = new ChangeDetector(settings.skipThreshold, settings.skipRoi, 4, settings.skipMarkOnly);
+            this->_changeDetector->openLog(ChangeDetector::fileNameForVideo(this->_videoName));
+            this->_encoder->setChangeDetector(this->_changeDetector);
+            qDebug() << __FILE__ << "camera" << this->_index << "frame skipping:" << this->_changeDetector->description();
+        }
+    }
+
+    if (settings.preTriggerSeconds > 0.0)
+    {
+        double cameraFps = this->_source->fps();
+        if (cameraFps <= 0.0)
+        {
+            cameraFps = settings.fps;
+        }
+
+        this->_preTrigger = new PreTriggerBuffer(S, qRound(settings.preTriggerSeconds * cameraFps),
+                                                 qRound(settings.postTriggerSeconds * cameraFps),
+                                                 settings.preTriggerCompressed, 90, this->_source->isCompressed());
+        this->_capture->setPreTriggerBuffer(this->_preTrigger);
+        this->_encoder->setPreTriggerBuffer(this->_preTrigger);
+        QObject::connect(this->_capture, SIGNAL(preTriggerWindowFull()), this->_encoder, SLOT(wake()), Qt::DirectConnection);
+    }
+    return true;
+}
+
+//!
+//! \brief Method publishes every captured frame to shared memory ring for local consumers.
+//! Has to be called after initCapture() or init() and before start().
+//! \param name Represents ring name readers open.
+//! \param slotCount Represents number of frames kept in ring.
+//! \return Returns false if ring could not be created, recording works without it.
+//!
+bool CameraChannel::initSharedMemory(const QString &name, int slotCount)
+{
+    if (this->_capture == nullptr)
+    {
+        return false;
+    }
+
+    // Slot fits raw frame like pool buffers, JPEG frames of compressed source are smaller.
+    cv::Size S = this->_source->frameSize();
+    this->_publisher = new SharedFramePublisher(name, S, CV_8UC3, size_t(S.width) * size_t(S.height) * 3, slotCount,
+                                                this->_source->isCompressed());
+    qDebug() << __FILE__ << "camera" << this->_index << "shared memory:" << this->_publisher->description();
+    if (!this->_publisher->isOpened())
+    {
+        delete this->_publisher;
+        this->_publisher = nullptr;
+        return false;
+    }
+
+    this->_capture->setPublisher(this->_publisher);
+    return true;
+}
+
+//!
+//! \brief Setter for CPU affinity and scheduling of channel threads. Has to be called before start().
+//! \param capture Represents schedule of capture thread.
+//! \param encode Represents schedule of encoder thread, its workers inherit it.
+//!
+void CameraChannel::setSchedules(const ThreadSchedule &capture, const ThreadSchedule &encode)
+{
+    if (this->_capture != nullptr)
+    {
+        this->_capture->setSchedule(capture);
+    }
+    if (this->_encoder != nullptr)
+    {
+        this->_encoder->setSchedule(encode);
+    }
+}
+
+//!
+//! \brief Method starts capture and encoder threads.
+//!
+void CameraChannel::start(void)
+{
+    if (this->_capture != nullptr)
+    {
+        this->_capture->start(QThread::HighPriority);
+    }
+    if (this->_encoder != nullptr)
+    {
+        this->_encoder->start();
+    }
+}
+
+//!
+//! \brief Getter for camera position.
+//! \return Returns index given in constructor.
+//!
+int CameraChannel::index(void) const
+{
+    return this->_index;
+}
+
+//!
+//! \brief Getter for preview window name.
+//! \return Returns "frame" for first camera, "frame <index>" for others.
+//!
+QString CameraChannel::windowName(void) const
+{
+    return this->_index == 0 ? QString("frame") : QString("frame %1").arg(this->_index);
+}
+
+//!
+//! \brief Getter for output file name.
+//! \return Returns video file name, empty before init().
+//!
+QString CameraChannel::videoName(void) const
+{
+    return this->_videoName;
+}
+
+//!
+//! \brief Getter for capture backend.
+//! \return Returns source owned by channel.
+//!
+FrameSource *CameraChannel::source(void) const
+{
+    return this->_source;
+}
+
+//!
+//! \brief Getter for capture thread.
+//! \return Returns thread owned by channel or nullptr before init.
+//!
+CaptureThread *CameraChannel::capture(void) const
+{
+    return this->_capture;
+}
+
+//!
+//! \brief Getter for frame allocator.
+//! \return Returns pool owned by channel or nullptr before init.
+//!
+FramePool *CameraChannel::framePool(void) const
+{
+    return this->_pool;
+}
+
+//!
+//! \brief Getter for encoder thread.
+//! \return Returns thread owned by channel or nullptr when not recording.
+//!
+EncoderThread *CameraChannel::encoder(void) const
+{
+    return this->_encoder;
+}
+
+//!
+//! \brief Getter for pre-trigger buffer.
+//! \return Returns buffer owned by channel or nullptr when mode is disabled.
+//!
+PreTriggerBuffer *CameraChannel::preTrigger(void) const
+{
+    return this->_preTrigger;
+}
+
+//!
+//! \brief Getter for adjustable compression.
+//! \return Returns true if JPEG quality of stored frames can be changed by EncoderThread::setQuality().
+//!
+bool CameraChannel::hasAdjustableQuality(void) const
+{
+    return this->_adjustableQuality;
+}
+
+//!
+//! \brief Method builds output name of camera.
+//! \param fileName Represents name given by user.
+//! \param index Represents camera position.
+//! \param count Represents number of cameras.
+//! \return Returns fileName for single camera, otherwise "<base>_cam<index>.<suffix>".
+//!
+QString CameraChannel::videoNameForChannel(const QString &fileName, int index, int count)
+{
+    if (count <= 1)
+    {
+        return fileName;
+    }
+
+    QFileInfo info(fileName);
+    QString name = QString("%1_cam%2").arg(info.completeBaseName()).arg(index);
+    if (!info.suffix().isEmpty())
+    {
+        name += "." + info.suffix();
+    }
+    return QDir(info.path()).filePath(name);
+}
@@ -0,0 +1,84 @@
+#ifndef CAMERACHANNEL_H
+#define CAMERACHANNEL_H
+
+#include <QString>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "encoderthread.h"
+#include "segmentedsink.h"
+#include "threadschedule.h"
+
+class FrameSource;
+class FrameSink;
+class CaptureThread;
+class FramePool;
+class FrameProcessor;
+class ChangeDetector;
+class TimestampLog;
+class PreTriggerBuffer;
+class RecorderStats;
+class SharedFramePublisher;
+
+//!
+//! \brief Recording path of one camera: source, capture thread, output
+//! file, encoder and optional pre-trigger buffer. CameraThread owns one
+//! channel per camera and fires all of them from single trigger stream.
+//!
+class CameraChannel
+{
+public:
+    struct Settings {
+        QString videoName;
+        int codec;
+        int fps;
+        int queueSize;
+        EncoderThread::OverflowPolicy overflowPolicy;
+        double preTriggerSeconds;
+        double postTriggerSeconds;
+        bool preTriggerCompressed;
+        SegmentedSink::Limits segmentLimits;
+        int encoderThreads;
+        size_t writeBehindBuffer;   //!< 0 writes through QFile or OpenCV
+        QString process;
+        double skipThreshold;       //!< 0 stores every frame
+        cv::Rect skipRoi;
+        bool skipMarkOnly;
+    };
+
+public:
+    CameraChannel(int index, FrameSource *source);
+    ~CameraChannel();
+    bool initCapture(int queuedFrames = 0);
+    bool init(const Settings &settings, RecorderStats *stats);
+    bool initSharedMemory(const QString &name, int slotCount);
+    void setSchedules(const ThreadSchedule &capture, const ThreadSchedule &encode);
+    void start(void);
+    int index(void) const;
+    QString windowName(void) const;
+    QString videoName(void) const;
+    FrameSource *source(void) const;
+    CaptureThread *capture(void) const;
+    FramePool *framePool(void) const;
+    EncoderThread *encoder(void) const;
+    PreTriggerBuffer *preTrigger(void) const;
+    bool hasAdjustableQuality(void) const;
+
+    static QString videoNameForChannel(const QString &fileName, int index, int count);
+
+private:
+    int _index;
+    FrameSource *_source;
+    FramePool *_pool;
+    FramePool *_outputPool;
+    FrameProcessor *_processor;
+    CaptureThread *_capture;
+    FrameSink *_sink;
+    EncoderThread *_encoder;
+    TimestampLog *_timestampLog;
+    ChangeDetector *_changeDetector;
+    PreTriggerBuffer *_preTrigger;
+    SharedFramePublisher *_publisher;
+    QString _videoName;
+    bool _adjustableQuality;
+};
+
+#endif // CAMERACHANNEL_H
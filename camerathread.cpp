@@ -3,9 +3,24 @@
 #include <QFile>
 #include <QTime>
 #include <QDir>
+#include <QFileInfo>
 #include <QApplication>
+#include <QtEndian>
 #include <qxmlstream.h>
 #include "camerathread.h"
+#include "camerachannel.h"
+#include "capturethread.h"
+#include "opencvframesource.h"
+#include "previewthread.h"
+#include "monotonicclock.h"
+#include "pretriggerbuffer.h"
+#include "recorderstats.h"
+#include "sharedframepublisher.h"
+#include "qualitycontroller.h"
+#include "threadschedule.h"
+#ifdef Q_OS_LINUX
+#include "serialthread.h"
+#endif
 
 //!
 //! \brief Object constructor
@@ -13,13 +28,49 @@
 //!
 CameraThread::CameraThread(QWidget *parent) :
     QWidget(parent),
+    _preview(nullptr),
+    _previewFps(10),
+    _previewScale(0.5),
+    _preTriggerSeconds(0.0),
+    _postTriggerSeconds(0.0),
+    _preTriggerCompressed(false),
+    _stats(nullptr),
+    _statsEnabled(false),
+    _statsInterval(0),
+    _statsTimer(nullptr),
+    _codec(-1),
+    _segmentFrames(0),
+    _segmentSeconds(0.0),
+    _segmentBytes(0),
+    _encoderThreads(1),
+    _writeBehindMegabytes(0),
+    _skipThreshold(0.0),
+    _skipMarkOnly(false),
+    _sharedMemorySlots(8),
+    _serialEnabled(true),
+    _serialThreadEnabled(false),
+    _previewEnabled(true),
+    _adaptiveEnabled(false),
+    _adaptiveMinQuality(50),
+    _adaptiveMinPreviewFps(1),
+    _adaptiveMinPreviewScale(0.125),
+    _qualityController(nullptr),
+    _qualityTimer(nullptr),
+    _qualityTimestamp(0),
+    _schedules(ThreadSchedule::RoleCount),
+    _lockMemory(false),
+    _queueSize(32),
+    _overflowPolicy(EncoderThread::Block),
     _quit(false),
     _initialized(false),
     _ready(false),
     _save(false),
     _onlyCameraRun(false),
     _serial(nullptr),
-    _frameCount(0)
+    _serialThread(nullptr),
+    _triggersReceived(0),
+    _frameCount(0),
+    _lastCaptureTimestamp(0)
 {
     qRegisterMetaType<cv::Mat>("cv::Mat");
 
@@ -42,14 +93,40 @@ CameraThread::~CameraThread()
         delete this->_serial;
 
     }
-    this->_cap->release();
-    delete this->_cap;
-    delete this->_frame;
 
-    if (this->_outputVideo != nullptr)
+#ifdef Q_OS_LINUX
+    // Reader thread runs trigger path, it has to end before cameras and preview.
+    delete this->_serialThread;
+#endif
+
+    // Preview may hold capture threads and frames, it ends before cameras.
+    delete this->_preview;
+    delete this->_qualityController;
+
+    qDebug() << __FILE__ << "triggers received:" << this->_triggersReceived.load() << "frames saved:" << this->_frameCount.load()
+             << "unknown bytes:" << this->_parser.unknownBytes() << "frame errors:" << this->_parser.frameErrors();
+
+    // Every channel stops its capture, then writes queued frames; pooled frames go back first.
+    this->_pendingFrames.clear();
+    qDeleteAll(this->_channels);
+    this->_channels.clear();
+
+    if (this->_stats != nullptr)
     {
-        this->_outputVideo->release();
-        delete this->_outputVideo;
+        QByteArray json = this->_stats->toJson();
+        qDebug() << __FILE__ << "stats:" << json;
+
+        QFile statsFile(QDir(QFileInfo(this->_videoName).path()).filePath(QFileInfo(this->_videoName).completeBaseName() + "_stats.json"));
+        if (statsFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            statsFile.write(json);
+            statsFile.write("\n");
+        }
+        else
+        {
+            qWarning() << __FILE__ << __LINE__ << "Could not write stats file:" << statsFile.errorString();
+        }
+        delete this->_stats;
     }
 }
 
@@ -63,41 +140,130 @@ void CameraThread::init(int cameraID, int fps, QString fileName)
 {
     if (!this->_initialized)
     {
-        this->_cap = new cv::VideoCapture(cameraID);
+        this->init(new OpenCvFrameSource(cameraID), fps, fileName);
+    }
+    else
+    {
+        qWarning() << __FILE__ << __LINE__ << "Camera already initialized";
+    }
+}
 
-        if(!this->_cap->isOpened()) // check if we succeeded
-        {
-            qWarning() << __FILE__ << __LINE__ << "Cannot open camera file";
-            return;
-        }
+//!
+//! \brief Method inits all needed pointers and data for given frame source.
+//! \param source Represents capture backend, object takes ownership of it.
+//! \param fps Represetns new fps value.
+//! \param fileName Represents file name where data will be saved.
+//!
+void CameraThread::init(FrameSource *source, int fps, QString fileName)
+{
+    this->init(QList<FrameSource *>() << source, fps, fileName);
+}
 
+//!
+//! \brief Method inits recording of several cameras fired by the same triggers.
+//! \param sources Represents capture backends, object takes ownership of them.
+//! \param fps Represetns new fps value.
+//! \param fileName Represents file name, camera index is added to it when there are more cameras.
+//!
+void CameraThread::init(const QList<FrameSource *> &sources, int fps, QString fileName)
+{
+    if (!this->_initialized)
+    {
         this->wait(1);
 
-        cv::Size S = cv::Size((int) this->_cap->get(CV_CAP_PROP_FRAME_WIDTH),    // Acquire input size
-                         (int) this->_cap->get(CV_CAP_PROP_FRAME_HEIGHT));
-
-        this->_frame = new cv::Mat();
         this->_fps = fps;
         this->_videoName = fileName;
-        this->_outputVideo = new cv::VideoWriter(this->_videoName.toStdString(), -1 , double(fps), S, true);
 
-        qDebug() << __FILE__ << S.height << S.width << fps;
+        if (this->_statsEnabled)
+        {
+            // Shared by all cameras, histograms and counters are safe for concurrent use.
+            this->_stats = new RecorderStats();
+
+            if (this->_statsInterval > 0)
+            {
+                this->_statsTimer = new QTimer(this);
+                connect(this->_statsTimer, SIGNAL(timeout()), this, SLOT(printStats()));
+            }
+        }
+
+        CameraChannel::Settings settings;
+        settings.codec = this->_codec;
+        settings.fps = fps;
+        settings.queueSize = this->_queueSize;
+        settings.overflowPolicy = this->_overflowPolicy;
+        settings.preTriggerSeconds = this->_preTriggerSeconds;
+        settings.postTriggerSeconds = this->_postTriggerSeconds;
+        settings.preTriggerCompressed = this->_preTriggerCompressed;
+        settings.segmentLimits.frames = this->_segmentFrames;
+        settings.segmentLimits.seconds = this->_segmentSeconds;
+        settings.segmentLimits.bytes = this->_segmentBytes;
+        settings.encoderThreads = this->_encoderThreads;
+        settings.writeBehindBuffer = size_t(this->_writeBehindMegabytes) << 20;
+        settings.process = this->_storeProcess;
+        settings.skipThreshold = this->_skipThreshold;
+        settings.skipRoi = this->_skipRoi;
+        settings.skipMarkOnly = this->_skipMarkOnly;
 
-        if (!this->_outputVideo->isOpened())
+        bool ok = !sources.isEmpty();
+        for (int i = 0; i < sources.size(); ++i)
         {
-            qWarning() << __FILE__ << __LINE__ << "Could not open the output video for write: " << this->_videoName;
+            CameraChannel *channel = new CameraChannel(i, sources.at(i));
+            this->_channels.append(channel);
+
+            settings.videoName = CameraChannel::videoNameForChannel(fileName, i, sources.size());
+            ok = ok && channel->init(settings, this->_stats);
+            if (ok && !this->_sharedMemoryName.isEmpty())
+            {
+                channel->initSharedMemory(SharedFramePublisher::nameForChannel(this->_sharedMemoryName, i, sources.size()),
+                                          this->_sharedMemorySlots);
+            }
+        }
+
+        if (!ok)
+        {
+            qWarning() << __FILE__ << __LINE__ << "Recorder not initialized";
             return;
         }
 
-        this->_serial = new QSerialPort(this);
-        connect(this->_serial, SIGNAL(readyRead()), this, SLOT(readRSData()));
-        this->openRS();
+        this->_pendingFrames.resize(this->_channels.size());
+        this->_pendingSlots.resize(this->_channels.size());
+
+        // Burst frames are counted when captured, frame numbers follow the first camera.
+        this->_channels.first()->capture()->setFrameCounter(&this->_frameCount);
+
+        if (this->_previewEnabled)
+        {
+            this->createPreview(false);
+        }
+
+        if (this->_adaptiveEnabled)
+        {
+            this->createQualityController();
+        }
+
+        if (this->_serialEnabled && this->_serialThreadEnabled)
+        {
+            this->openRSThread();
+        }
+        else if (this->_serialEnabled)
+        {
+            this->_serial = new QSerialPort(this);
+            connect(this->_serial, SIGNAL(readyRead()), this, SLOT(readRSData()));
+            this->openRS();
+        }
+
+        // Frame pools and file buffers exist now, locking keeps them resident for whole recording.
+        if (this->_lockMemory)
+        {
+            qDebug() << "memory:" << ThreadSchedule::lockMemory();
+        }
 
         this->_initialized = true;
     }
     else
     {
         qWarning() << __FILE__ << __LINE__ << "Camera already initialized";
+        qDeleteAll(sources);
     }
 }
 
@@ -109,16 +275,44 @@ void CameraThread::initCamera(int cameraID)
 {
     if (!this->_initialized)
     {
-        this->_cap = new cv::VideoCapture(cameraID);
+        this->initCamera(QList<FrameSource *>() << new OpenCvFrameSource(cameraID));
+    }
+    else
+    {
+        qWarning() << __FILE__ << __LINE__ << "Camera already initialized";
+    }
+}
+
+//!
+//! \brief Method inits only cameras for preview, nothing is recorded.
+//! \param sources Represents capture backends, object takes ownership of them.
+//!
+void CameraThread::initCamera(const QList<FrameSource *> &sources)
+{
+    if (!this->_initialized)
+    {
+        bool ok = !sources.isEmpty();
+        for (int i = 0; i < sources.size(); ++i)
+        {
+            CameraChannel *channel = new CameraChannel(i, sources.at(i));
+            this->_channels.append(channel);
+            ok = ok && channel->initCapture();
+            if (ok && !this->_sharedMemoryName.isEmpty())
+            {
+                channel->initSharedMemory(SharedFramePublisher::nameForChannel(this->_sharedMemoryName, i, sources.size()),
+                                          this->_sharedMemorySlots);
+            }
+        }
 
-        if(!this->_cap->isOpened()) // check if we succeeded
+        if (!ok)
         {
-            qWarning() << __FILE__ << __LINE__ << "Cannot open camera file";
             return;
         }
-        this->_frame = new cv::Mat();
 
-        this->_outputVideo = nullptr;
+        // Test run shows cameras continuously, any key in window ends it.
+        this->createPreview(true);
+        connect(this->_preview, SIGNAL(keyPressed(int)), this, SLOT(stopThread()));
+
         this->_serial = nullptr;
         this->_fps = 25;
         this->_onlyCameraRun = true;
@@ -129,6 +323,7 @@ void CameraThread::initCamera(int cameraID)
     else
     {
         qWarning() << __FILE__ << __LINE__ << "Camera already initialized";
+        qDeleteAll(sources);
     }
 }
 
@@ -153,38 +348,38 @@ void CameraThread::start(void)
     }
 
     this->_ready = true;
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        channel->setSchedules(this->_schedules[ThreadSchedule::CaptureRole], this->_schedules[ThreadSchedule::EncodeRole]);
+        channel->start();
+    }
 
-    if (this->_onlyCameraRun)
+    if (this->_statsTimer != nullptr)
     {
-        int key = 0;
-        if (this->_cap == nullptr)
-        {
-            qWarning() << __FILE__ << __LINE__ << "Camera not initialize!";
-            return;
-        }
+        this->_statsTimer->start(this->_statsInterval * 1000);
+    }
 
-        if (this->_frame == nullptr)
+    if (this->_qualityTimer != nullptr)
+    {
+        for (int i = 0; i < this->_channels.size(); ++i)
         {
-            qWarning() << __FILE__ << __LINE__ << "Frame container not initalized!";
-            return;
+            this->_qualityCounters[i] = this->_channels[i]->encoder()->counters();
         }
+        this->_qualityTimestamp = monotonicNs();
+        this->_qualityTimer->start(500);
+    }
 
-        while (!this->_quit)
-        {
-            this->_cap->read(*(this->_frame)); // get a new frame from camera
-
-            if (!this->_frame->empty())
-            {
-                imshow("frame", *(this->_frame));
-            }
+    if (this->_preview != nullptr)
+    {
+        this->_preview->setSchedule(this->_schedules[ThreadSchedule::PreviewRole]);
+        this->_preview->start(QThread::LowPriority);
+    }
 
-            key = cv::waitKey(30);
-            if (key >= 0)
-            {
-                qDebug() << __FILE__ << "stop";
-                this->_quit = true;
-            }
-        }
+    // Without reader thread serial port is read by event loop, so it gets serial schedule. It is applied
+    // after every thread is started, threads inherit affinity and policy of thread which starts them.
+    if (this->_serial != nullptr && !this->_schedules[ThreadSchedule::SerialRole].isEmpty())
+    {
+        qDebug() << "serial event loop thread:" << this->_schedules[ThreadSchedule::SerialRole].apply();
     }
 }
 
@@ -198,15 +393,127 @@ void CameraThread::stopThread(void)
 }
 
 //!
-//! \brief Setter for save value. Sets it to true value to save actual frame.
+//! \brief Method passes newest captured frame of every camera to encoders.
+//! Frames are selected for all cameras first and copied afterwards, so they
+//! come from the same moment regardless of number of cameras.
+//! \param receiveTimestamp Represents monotonic time in ns when trigger was read, 0 means now.
+//! \return Returns false if frame of any camera was not queued.
 //!
-void CameraThread::saveActualFrame(void)
+bool CameraThread::saveActualFrame(qint64 receiveTimestamp)
 {
-    this->_cap->read(*(this->_frame)); // get a new frame from camera
-    this->_outputVideo->write(*(this->_frame));
-    imshow("frame", *(this->_frame));
-    qDebug() << __FILE__ << __LINE__ << "save frame:" << ++this->_frameCount << QTime::currentTime().toString("hh:mm:ss:zzz");
+    receiveTimestamp = receiveTimestamp != 0 ? receiveTimestamp : monotonicNs();
+    qint64 copyStart = this->_stats != nullptr ? monotonicNs() : 0;
+    bool queued = true;
+    this->_lastCaptureTimestamp = 0;
+
+    for (int i = 0; i < this->_channels.size(); ++i)
+    {
+        RecordedFrame &frame = this->_pendingFrames[i];
+        this->_pendingSlots[i] = this->_channels.at(i)->capture()->acquireLatest(&frame.captureTimestamp);
+    }
+
+    if (this->_pendingSlots.count(-1) < this->_pendingSlots.size())
+    {
+        ++this->_frameCount;
+    }
+    for (int i = 0; i < this->_channels.size(); ++i)
+    {
+        CameraChannel *channel = this->_channels.at(i);
+        RecordedFrame &frame = this->_pendingFrames[i];
+        int slot = this->_pendingSlots[i];
+        if (slot < 0) // newest frame grabbed by capture thread
+        {
+            qWarning() << __FILE__ << __LINE__ << "No frame captured yet, camera" << i;
+            if (this->_stats != nullptr)
+            {
+                this->_stats->increment(RecorderStats::DroppedTriggersCounter);
+            }
+            queued = false;
+            continue;
+        }
+
+        // Reply carries capture time of the first camera which delivered.
+        if (this->_lastCaptureTimestamp == 0)
+        {
+            this->_lastCaptureTimestamp = frame.captureTimestamp;
+        }
+
+        channel->capture()->copySlot(slot, frame.image);
+        channel->capture()->releaseSlot(slot);
+        frame.trigger = this->_triggersReceived;
+        frame.receiveTimestamp = receiveTimestamp;
+
+        if (this->_stats != nullptr)
+        {
+            qint64 copyEnd = monotonicNs();
+            this->_stats->record(RecorderStats::ConvertStage, copyEnd - copyStart);
+            copyStart = copyEnd;
+        }
+
+        // Preview only shares image, it is rendered later by preview thread.
+        if (this->_preview != nullptr)
+        {
+            this->_preview->post(i, frame.image);
+        }
+
+        // Encoding is done by encoder thread, trigger path only queues frame.
+        if (!channel->encoder()->enqueue(frame))
+        {
+            qWarning() << __FILE__ << __LINE__ << "Encoder queue full, frame dropped:" << this->_frameCount.load() << "camera" << i;
+            queued = false;
+        }
+        frame = RecordedFrame();
+    }
+
 //    this->_save = true;
+    return queued;
+}
+
+//!
+//! \brief Method creates preview thread with window for every camera.
+//! \param follow Represents true value to show captured frames instead of saved ones.
+//!
+void CameraThread::createPreview(bool follow)
+{
+    this->_preview = new PreviewThread(this->_previewFps, this->_previewScale);
+    this->_preview->setFollowCapture(follow);
+    this->_preview->setStats(this->_stats);
+    this->_preview->setProcess(this->_previewProcess);
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        this->_preview->addChannel(channel->capture(), channel->windowName(), channel->source()->isCompressed());
+    }
+}
+
+//!
+//! \brief Method creates controller of output quality and its sampling timer.
+//! Sinks are created with JPEG quality 90, preview with its configured rate and size.
+//!
+void CameraThread::createQualityController(void)
+{
+    bool adjustable = false;
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        adjustable = adjustable || channel->hasAdjustableQuality();
+    }
+
+    QualityController::Level nominal;
+    nominal.quality = adjustable ? 90 : 0;
+    nominal.previewFps = this->_preview != nullptr ? qMax(this->_previewFps, 1) : 0;
+    nominal.previewScale = this->_preview != nullptr && this->_previewScale > 0.0 && this->_previewScale <= 1.0 ? this->_previewScale : 1.0;
+
+    QualityController::Level minimum;
+    minimum.quality = adjustable ? this->_adaptiveMinQuality : 0;
+    minimum.previewFps = this->_preview != nullptr ? this->_adaptiveMinPreviewFps : 0;
+    minimum.previewScale = this->_preview != nullptr ? this->_adaptiveMinPreviewScale : 1.0;
+
+    this->_qualityController = new QualityController(nominal, minimum);
+    this->_qualityController->openLog(QualityController::fileNameForVideo(this->_videoName));
+    qDebug() << __FILE__ << "adaptive quality:" << this->_qualityController->description();
+
+    this->_qualityCounters.resize(this->_channels.size());
+    this->_qualityTimer = new QTimer(this);
+    connect(this->_qualityTimer, SIGNAL(timeout()), this, SLOT(adaptQuality()));
 }
 
 //!
@@ -221,20 +528,565 @@ void CameraThread::setFPS(int fps)
     }
 }
 
+//!
+//! \brief Setter for encoder queue. Has to be called before init().
+//! \param size Represents number of frames which can wait for encoding.
+//! \param policy Represents behaviour when queue is full.
+//!
+void CameraThread::setEncoderQueue(int size, EncoderThread::OverflowPolicy policy)
+{
+    if (this->_initialized)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Encoder already created";
+        return;
+    }
+
+    this->_queueSize = size;
+    this->_overflowPolicy = policy;
+}
+
+//!
+//! \brief Setter for pre-trigger recording mode. Has to be called before init().
+//! \param preSeconds Represents length of window kept before event, 0 disables mode.
+//! \param postSeconds Represents length of window recorded after event.
+//! \param compressed Represents true value to keep window as JPEG frames.
+//! \param command Represents UART byte which saves window.
+//!
+void CameraThread::setPreTrigger(double preSeconds, double postSeconds, bool compressed, char command)
+{
+    if (this->_initialized)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Pre-trigger buffer already created";
+        return;
+    }
+
+    this->_preTriggerSeconds = preSeconds;
+    this->_postTriggerSeconds = postSeconds;
+    this->_preTriggerCompressed = compressed;
+    this->_parser.setEventByte(preSeconds > 0.0 ? command : 0);
+}
+
+//!
+//! \brief Method saves pre-trigger window together with post-trigger frames of every camera.
+//! \param receiveTimestamp Represents monotonic time in ns when event was read.
+//! \return Returns false if window is disabled or previous one is not written yet.
+//!
+bool CameraThread::saveEventWindow(qint64 receiveTimestamp)
+{
+    bool accepted = true;
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        PreTriggerBuffer *buffer = channel->preTrigger();
+        if (buffer == nullptr)
+        {
+            return false;
+        }
+
+        if (!buffer->trigger(this->_triggersReceived, receiveTimestamp))
+        {
+            if (this->_stats != nullptr)
+            {
+                this->_stats->increment(RecorderStats::DroppedTriggersCounter);
+            }
+            qWarning() << __FILE__ << __LINE__ << "Previous event window not written yet, event ignored:" << this->_triggersReceived.load()
+                       << "camera" << channel->index();
+            accepted = false;
+        }
+    }
+    qDebug() << __FILE__ << __LINE__ << "event:" << this->_triggersReceived.load() << QTime::currentTime().toString("hh:mm:ss:zzz");
+    return accepted;
+}
+
+//!
+//! \brief Method starts burst of frames on every camera. Frames are selected and
+//! queued by capture threads, so burst runs at camera rate.
+//! \param count Represents number of frames recorded by every camera.
+//! \param interval Represents minimal distance of frames in ns, 0 takes every captured frame.
+//! \param receiveTimestamp Represents monotonic time in ns when command was read, 0 means now.
+//! \return Returns false if running burst was replaced.
+//!
+bool CameraThread::saveBurst(int count, qint64 interval, qint64 receiveTimestamp)
+{
+    receiveTimestamp = receiveTimestamp != 0 ? receiveTimestamp : monotonicNs();
+    bool idle = true;
+
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        if (channel->capture()->isBurstActive())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Previous burst not finished, replaced:" << this->_triggersReceived.load()
+                       << "camera" << channel->index();
+            idle = false;
+        }
+        channel->capture()->requestBurst(this->_triggersReceived, receiveTimestamp, count, interval);
+    }
+
+    qDebug() << __FILE__ << __LINE__ << "burst:" << this->_triggersReceived.load() << "frames:" << count << "interval us:" << interval / 1000
+             << QTime::currentTime().toString("hh:mm:ss:zzz");
+    return idle;
+}
+
+//!
+//! \brief Setter for instrumentation. Has to be called before init().
+//! \param enabled Represents true value to measure capture/encode path.
+//! \param intervalSeconds Represents period of stats line, 0 disables periodic line.
+//!
+void CameraThread::setStats(bool enabled, int intervalSeconds)
+{
+    if (this->_stats != nullptr)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Stats already created";
+        return;
+    }
+
+    this->_statsEnabled = enabled;
+    this->_statsInterval = qMax(intervalSeconds, 0);
+}
+
+//!
+//! \brief Setter for output codec. Has to be called before init().
+//! \param fourcc Represents codec four character code, -1 asks user to select codec.
+//!
+void CameraThread::setCodec(int fourcc)
+{
+    this->_codec = fourcc;
+}
+
+//!
+//! \brief Setter for output rollover. Has to be called before init().
+//! First reached limit closes file and continues in next one, 0 disables limit.
+//! \param frames Represents maximal number of frames in one file.
+//! \param seconds Represents maximal capture time span of one file.
+//! \param bytes Represents maximal size of one file.
+//!
+void CameraThread::setSegments(int frames, double seconds, qint64 bytes)
+{
+    this->_segmentFrames = qMax(frames, 0);
+    this->_segmentSeconds = qMax(seconds, 0.0);
+    this->_segmentBytes = qMax(bytes, qint64(0));
+}
+
+//!
+//! \brief Setter for number of threads compressing frames of every camera. Has to be called before init().
+//! \param threads Represents thread count, more than one needs MJPG codec.
+//!
+void CameraThread::setEncoderThreads(int threads)
+{
+    this->_encoderThreads = qMax(threads, 1);
+}
+
+//!
+//! \brief Setter for write-behind output. Has to be called before init().
+//! MJPEG files are then written in large blocks by writer thread (or io_uring), directly to storage where possible.
+//! \param megabytes Represents size of one block, 0 writes through page cache as before.
+//!
+void CameraThread::setWriteBehind(int megabytes)
+{
+    this->_writeBehindMegabytes = qMax(megabytes, 0);
+}
+
+//!
+//! \brief Setter for processing stage. Has to be called before init().
+//! \param storage Represents steps applied to frames before they are written, e.g. "half+gray"; empty keeps frames as captured.
+//! \param preview Represents steps applied to shown frames before preview scale.
+//!
+void CameraThread::setProcessing(const QString &storage, const QString &preview)
+{
+    this->_storeProcess = storage;
+    this->_previewProcess = preview;
+}
+
+//!
+//! \brief Setter for skipping of frames similar to the last stored one. Has to be called before init().
+//! Decision of every trigger is logged to "<video>_changes.csv".
+//! \param threshold Represents mean absolute byte difference (0-255) a frame needs to be stored, 0 stores every frame.
+//! \param roi Represents compared region, empty compares whole frame.
+//! \param markOnly Represents true value to store similar frames too and only mark them in log.
+//!
+void CameraThread::setFrameSkipping(double threshold, const cv::Rect &roi, bool markOnly)
+{
+    this->_skipThreshold = qMax(threshold, 0.0);
+    this->_skipRoi = roi;
+    this->_skipMarkOnly = markOnly;
+}
+
+//!
+//! \brief Setter for shared memory output. Has to be called before init().
+//! Every captured frame is published to POSIX shared memory ring "/<name>",
+//! "/<name>_cam<index>" with more cameras, see SharedFrameReader.
+//! \param name Represents ring name, empty disables publishing.
+//! \param slotCount Represents number of frames kept in ring.
+//!
+void CameraThread::setSharedMemory(const QString &name, int slotCount)
+{
+    this->_sharedMemoryName = name;
+    this->_sharedMemorySlots = qMax(slotCount, 2);
+}
+
+//!
+//! \brief Setter for serial port usage. Has to be called before init().
+//! \param enabled Represents false value when commands are passed by processRSData() only.
+//!
+void CameraThread::setSerialEnabled(bool enabled)
+{
+    this->_serialEnabled = enabled;
+}
+
+//!
+//! \brief Setter for serial backend. Has to be called before init().
+//! Reader thread executes commands itself, so trigger time does not depend on event loop.
+//! \param enabled Represents true value to read port on dedicated thread in raw low latency mode (Linux only).
+//!
+void CameraThread::setSerialThreadEnabled(bool enabled)
+{
+#ifdef Q_OS_LINUX
+    this->_serialThreadEnabled = enabled;
+#else
+    if (enabled)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Serial reader thread is not supported on this system, event loop is used";
+    }
+#endif
+}
+
+//!
+//! \brief Setter for preview window of saved frames. Has to be called before init().
+//! \param enabled Represents false value to run without any window.
+//!
+void CameraThread::setPreviewEnabled(bool enabled)
+{
+    this->_previewEnabled = enabled;
+}
+
+//!
+//! \brief Setter for preview rendering. Has to be called before init().
+//! \param fps Represents maximal display rate.
+//! \param scale Represents size factor applied before rendering, 1 keeps full size.
+//!
+void CameraThread::setPreviewOptions(int fps, double scale)
+{
+    this->_previewFps = fps;
+    this->_previewScale = scale;
+}
+
+//!
+//! \brief Setter for adaptive output quality. Has to be called before init().
+//! While encoders fall behind, preview rate, preview size and JPEG quality of
+//! stored frames are lowered step by step and restored when load drops.
+//! Changes are logged to "<video>_quality.csv".
+//! \param enabled Represents true value to watch encoder load.
+//! \param minQuality Represents lowest JPEG quality, camera JPEG is never changed.
+//! \param minPreviewFps Represents lowest preview rate.
+//! \param minPreviewScale Represents lowest preview size factor.
+//!
+void CameraThread::setAdaptiveQuality(bool enabled, int minQuality, int minPreviewFps, double minPreviewScale)
+{
+    this->_adaptiveEnabled = enabled;
+    this->_adaptiveMinQuality = qBound(1, minQuality, 100);
+    this->_adaptiveMinPreviewFps = qMax(minPreviewFps, 1);
+    this->_adaptiveMinPreviewScale = minPreviewScale > 0.0 && minPreviewScale <= 1.0 ? minPreviewScale : 1.0;
+}
+
+//!
+//! \brief Method prints periodic stats line.
+//!
+void CameraThread::printStats(void)
+{
+    if (this->_stats != nullptr)
+    {
+        qDebug() << __FILE__ << "stats:" << this->_stats->summaryLine();
+    }
+}
+
+//!
+//! \brief Method samples load of all encoders since previous call and applies new quality level.
+//!
+void CameraThread::adaptQuality(void)
+{
+    qint64 now = monotonicNs();
+    double elapsed = double(qMax(now - this->_qualityTimestamp, qint64(1)));
+    this->_qualityTimestamp = now;
+
+    QualityController::Load load;
+    load.fill = 0.0;
+    load.busy = 0.0;
+    load.dropped = 0;
+    for (int i = 0; i < this->_channels.size(); ++i)
+    {
+        EncoderThread::Counters counters = this->_channels[i]->encoder()->counters();
+        const EncoderThread::Counters &last = this->_qualityCounters[i];
+        load.fill = qMax(load.fill, double(counters.depth) / qMax(counters.capacity, 1));
+        load.busy = qMax(load.busy, double(counters.busyNs - last.busyNs) / elapsed);
+        load.dropped += counters.droppedOldest - last.droppedOldest + counters.droppedNewest - last.droppedNewest;
+        this->_qualityCounters[i] = counters;
+    }
+
+    if (this->_qualityController->update(load, this->_triggersReceived.load()) == QualityController::Unchanged)
+    {
+        return;
+    }
+
+    const QualityController::Level &level = this->_qualityController->level();
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        if (channel->hasAdjustableQuality())
+        {
+            channel->encoder()->setQuality(level.quality);
+        }
+    }
+    if (this->_preview != nullptr)
+    {
+        this->_preview->setRate(level.previewFps, level.previewScale);
+    }
+}
+
+//!
+//! \brief Method acknowledges framed command, single byte commands get no reply.
+//! Reply payload: status (uint8), frame index (uint32), timestamp in ns (int64)
+//! and encoder queue depth (uint16), all little endian.
+//! \param status Represents result of command.
+//! \param frameIndex Represents index of saved frame or trigger number.
+//! \param timestamp Represents monotonic capture or receive time in ns.
+//!
+void CameraThread::sendReply(CommandParser::ReplyStatus status, quint32 frameIndex, qint64 timestamp)
+{
+    if (!this->hasRS() || !this->_parser.isFramed())
+    {
+        return;
+    }
+
+    uchar payload[15];
+    payload[0] = uchar(status);
+    qToLittleEndian<quint32>(frameIndex, payload + 1);
+    qToLittleEndian<qint64>(timestamp, payload + 5);
+    qToLittleEndian<quint16>(quint16(qMin(this->queueDepth(), 0xFFFF)), payload + 13);
+
+    // Buffered by QSerialPort and written from event loop, capture threads never wait for it.
+    this->writeRS(CommandParser::frame(this->_parser.sequence(), this->_parser.frameCode() | CommandParser::ReplyFlag,
+                                       QByteArray(reinterpret_cast<const char *>(payload), sizeof(payload))));
+}
+
+//!
+//! \brief Method answers framed stats query with counters of all cameras.
+//! Reply payload: status (uint8), triggers, saved frames, written frames and
+//! dropped frames (uint32 each), queue depth and maximal queue depth (uint16 each).
+//!
+void CameraThread::sendStatsReply(void)
+{
+    if (!this->hasRS())
+    {
+        return;
+    }
+
+    quint64 written = 0;
+    quint64 dropped = 0;
+    int maxDepth = 0;
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        if (channel->encoder() != nullptr)
+        {
+            EncoderThread::Counters counters = channel->encoder()->counters();
+            written += counters.written;
+            dropped += counters.droppedOldest + counters.droppedNewest + counters.failed;
+            maxDepth = qMax(maxDepth, counters.maxDepth);
+        }
+    }
+
+    uchar payload[21];
+    payload[0] = uchar(CommandParser::StatusOk);
+    qToLittleEndian<quint32>(quint32(this->_triggersReceived), payload + 1);
+    qToLittleEndian<quint32>(quint32(this->_frameCount), payload + 5);
+    qToLittleEndian<quint32>(quint32(written), payload + 9);
+    qToLittleEndian<quint32>(quint32(dropped), payload + 13);
+    qToLittleEndian<quint16>(quint16(qMin(this->queueDepth(), 0xFFFF)), payload + 17);
+    qToLittleEndian<quint16>(quint16(qMin(maxDepth, 0xFFFF)), payload + 19);
+
+    this->writeRS(CommandParser::frame(this->_parser.sequence(), CommandParser::FrameStats | CommandParser::ReplyFlag,
+                                       QByteArray(reinterpret_cast<const char *>(payload), sizeof(payload))));
+}
+
+//!
+//! \brief Getter for command port.
+//! \return Returns true if replies can be sent.
+//!
+bool CameraThread::hasRS(void) const
+{
+    return this->_serial != nullptr || this->_serialThread != nullptr;
+}
+
+//!
+//! \brief Method sends reply to command port.
+//! \param data Represents bytes to send.
+//!
+void CameraThread::writeRS(const QByteArray &data)
+{
+#ifdef Q_OS_LINUX
+    if (this->_serialThread != nullptr)
+    {
+        // Written directly on calling thread, replies are short.
+        this->_serialThread->write(data);
+        return;
+    }
+#endif
+    if (this->_serial != nullptr)
+    {
+        this->_serial->write(data); // buffered by QSerialPort, written from event loop
+    }
+}
+
+//!
+//! \brief Getter for encoder backlog.
+//! \return Returns number of frames waiting in the fullest encoder queue.
+//!
+int CameraThread::queueDepth(void) const
+{
+    int depth = 0;
+    foreach (CameraChannel *channel, this->_channels)
+    {
+        if (channel->encoder() != nullptr)
+        {
+            depth = qMax(depth, channel->encoder()->counters().depth);
+        }
+    }
+    return depth;
+}
+
+//!
+//! \brief Method answers stats query with JSON line written to serial port.
+//!
+void CameraThread::sendStats(void)
+{
+    if (!this->hasRS())
+    {
+        return;
+    }
+
+    if (this->_stats == nullptr)
+    {
+        this->writeRS("{}\n");
+        return;
+    }
+
+    QByteArray json = this->_stats->toJson();
+    json.append('\n');
+    this->writeRS(json);
+    qDebug() << __FILE__ << "stats:" << json;
+}
+
 //!
 //! \brief Method called when new data from com arrives.
 //!
 void CameraThread::readRSData(void)
 {
-    QByteArray data = this->_serial->readAll();
-    QString text = QString(data);
-    if (text.contains('a'))
+    qint64 receiveTimestamp = monotonicNs();
+    this->processRSData(this->_serial->readAll(), receiveTimestamp);
+}
+
+//!
+//! \brief Method executes commands from received data. Runs on main thread,
+//! or on serial reader thread when it is enabled, never on both.
+//! \param data Represents bytes received from com.
+//! \param receiveTimestamp Represents monotonic time in ns when data was read.
+//!
+void CameraThread::processRSData(const QByteArray &data, qint64 receiveTimestamp)
+{
+    // Every byte is handled in order, one frame per trigger byte.
+    for (int i = 0; i < data.size(); ++i)
     {
-        this->saveActualFrame();
+        switch (this->_parser.feed(data.at(i), receiveTimestamp))
+        {
+            case CommandParser::TriggerCommand:
+            {
+                ++this->_triggersReceived;
+                if (this->_stats != nullptr)
+                {
+                    this->_stats->increment(RecorderStats::TriggersCounter);
+                }
+                bool queued = this->saveActualFrame(receiveTimestamp);
+                this->sendReply(queued ? CommandParser::StatusOk : CommandParser::StatusDropped,
+                                quint32(this->_frameCount), this->_lastCaptureTimestamp);
+            }
+            break;
+
+            case CommandParser::EventCommand:
+            {
+                ++this->_triggersReceived;
+                if (this->_stats != nullptr)
+                {
+                    this->_stats->increment(RecorderStats::TriggersCounter);
+                }
+                bool accepted = this->saveEventWindow(receiveTimestamp);
+                this->sendReply(accepted ? CommandParser::StatusOk : CommandParser::StatusBusy,
+                                quint32(this->_triggersReceived), receiveTimestamp);
+            }
+            break;
+
+            case CommandParser::BurstCommand:
+            {
+                ++this->_triggersReceived;
+                if (this->_stats != nullptr)
+                {
+                    this->_stats->increment(RecorderStats::TriggersCounter);
+                }
+                // Frames are captured later, reply gives index of the first one and command time.
+                quint32 firstFrame = quint32(this->_frameCount + 1);
+                bool idle = this->saveBurst(this->_parser.burstCount(), this->_parser.burstInterval(), receiveTimestamp);
+                this->sendReply(idle ? CommandParser::StatusOk : CommandParser::StatusBusy, firstFrame, receiveTimestamp);
+            }
+            break;
+
+            case CommandParser::StatsCommand:
+            {
+                if (this->_parser.isFramed())
+                {
+                    this->sendStatsReply();
+                }
+                else
+                {
+                    this->sendStats();
+                }
+            }
+            break;
+
+            case CommandParser::QuitCommand:
+            {
+                this->sendReply(CommandParser::StatusOk);
+                if (this->_parser.isFramed() && this->_serial != nullptr)
+                {
+                    this->_serial->waitForBytesWritten(100); // port is closed on quit
+                }
+
+                // Reader thread only asks main thread to quit, application ends there.
+                if (QThread::currentThread() != this->thread())
+                {
+                    QMetaObject::invokeMethod(this, "stopThread", Qt::QueuedConnection);
+                }
+                else
+                {
+                    this->stopThread();
+                }
+                return;
+            }
+            break;
+
+            case CommandParser::InvalidFrameCommand:
+            {
+                qWarning() << __FILE__ << __LINE__ << "Bad frame, code:" << this->_parser.frameCode()
+                           << "status:" << this->_parser.frameStatus();
+                this->sendReply(this->_parser.frameStatus());
+            }
+            break;
+
+            default:
+            {
+            }
+            break;
+        }
     }
-    else if (text.contains('q'))
+
+    if (this->_stats != nullptr)
     {
-        this->stopThread();
+        this->_stats->record(RecorderStats::SerialStage, monotonicNs() - receiveTimestamp);
     }
 }
 
@@ -261,6 +1113,34 @@ void CameraThread::openRS(void)
     }
 }
 
+//!
+//! \brief Method opens com on dedicated reader thread.
+//!
+void CameraThread::openRSThread(void)
+{
+#ifdef Q_OS_LINUX
+    this->_serialThread = new SerialThread();
+
+    // Commands run on reader thread right after read, trigger path is safe for it.
+    connect(this->_serialThread, SIGNAL(dataReceived(QByteArray,qint64)), this, SLOT(processRSData(QByteArray,qint64)),
+            Qt::DirectConnection);
+
+    if (this->_serialThread->open(this->_p.name, this->_p.baudRate, this->_p.dataBits, this->_p.parity, this->_p.stopBits,
+                                  this->_p.flowControl))
+    {
+        qDebug() << __FILE__ << __LINE__ << QString("Connected to %1 : %2, %3, %4, %5, %6")
+                                   .arg(this->_serialThread->description()).arg(this->_p.stringBaudRate).arg(this->_p.stringDataBits)
+                                   .arg(this->_p.stringParity).arg(this->_p.stringStopBits).arg(this->_p.stringFlowControl);
+        this->_serialThread->setSchedule(this->_schedules[ThreadSchedule::SerialRole]);
+        this->_serialThread->start(QThread::TimeCriticalPriority);
+    }
+    else
+    {
+        qWarning() << __FILE__ << __LINE__ << "Error opening" << this->_p.name << "for reader thread";
+    }
+#endif
+}
+
 //!
 //! \brief Setter for rs configuration data.
 //! \param configuration Represents reference to new settings.
@@ -311,6 +1191,10 @@ void CameraThread::readRSConfig(void)
     p.stopBits = QSerialPort::OneStop;
     p.flowControl = QSerialPort::NoFlowControl;
 
+    QVector<ThreadSchedule> schedules(ThreadSchedule::RoleCount);
+    bool lockMemory = false;
+    int threadRole = -1;
+
     QFile* file = new QFile(QDir::toNativeSeparators(QApplication::applicationDirPath() + QDir::separator() +  "comConfig.xml"));
     if (!file->open(QIODevice::ReadOnly | QIODevice::Text))
     {
@@ -331,14 +1215,78 @@ void CameraThread::readRSConfig(void)
             continue;
         }
 
+        // Settings after thread block belong to no thread.
+        if(token == QXmlStreamReader::EndElement && xml.name() == "thread")
+        {
+            threadRole = -1;
+            continue;
+        }
+
         // If token is StartElement, we'll see if we can read it.
         if(token == QXmlStreamReader::StartElement)
         {
             //If it's named persons, we'll go to the next/
-            if(xml.name() == "uart")
+            if(xml.name() == "uart" || xml.name() == "threads")
+            {
+                continue;
+            }
+            else if(xml.name() == "lockMemory")
+            {
+                xml.readNext();
+                QString elementName = xml.text().toString().trimmed();
+                lockMemory = elementName == "1" || elementName.compare("true", Qt::CaseInsensitive) == 0;
+            }
+            else if(xml.name() == "thread")
             {
+                // Following affinity, policy and priority belong to this thread.
+                ThreadSchedule::Role role;
+                QString elementName = xml.attributes().value("name").toString();
+                threadRole = ThreadSchedule::roleFromString(elementName, role) ? int(role) : -1;
+                if (threadRole < 0)
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Unknown thread in comConfig.xml:" << elementName;
+                }
+                // Empty thread element ends right away, its end must not be skipped below.
                 continue;
             }
+            else if((xml.name() == "affinity" || xml.name() == "policy" || xml.name() == "priority") && threadRole < 0)
+            {
+                qWarning() << __FILE__ << __LINE__ << "Setting outside of known thread in comConfig.xml ignored:" << xml.name().toString();
+            }
+            else if(xml.name() == "affinity" && threadRole >= 0)
+            {
+                xml.readNext();
+                QString elementName = xml.text().toString();
+                quint64 mask = 0;
+                if (ThreadSchedule::affinityFromString(elementName, mask))
+                {
+                    schedules[threadRole].setAffinity(mask);
+                }
+                else
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad affinity of" << ThreadSchedule::roleName(ThreadSchedule::Role(threadRole)) << "thread:" << elementName;
+                }
+            }
+            else if(xml.name() == "policy" && threadRole >= 0)
+            {
+                xml.readNext();
+                QString elementName = xml.text().toString();
+                ThreadSchedule::Policy policy;
+                if (ThreadSchedule::policyFromString(elementName, policy))
+                {
+                    schedules[threadRole].setPolicy(policy);
+                }
+                else
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad policy of" << ThreadSchedule::roleName(ThreadSchedule::Role(threadRole)) << "thread:" << elementName;
+                }
+            }
+            else if(xml.name() == "priority" && threadRole >= 0)
+            {
+                xml.readNext();
+                int elementName = xml.text().toInt();
+                schedules[threadRole].setPriority(elementName);
+            }
             else if(xml.name() == "portName")
             {
                 xml.readNext();
@@ -482,5 +1430,7 @@ void CameraThread::readRSConfig(void)
     }
 
     this->setRSConfiguration(p);
+    this->_schedules = schedules;
+    this->_lockMemory = lockMemory;
     xml.clear();
 }
@@ -5,8 +5,22 @@
 #include <QThread>
 #include <QSerialPort>
 #include <QMetaType>
+#include <QTimer>
+#include <QList>
+#include <QVector>
+#include <atomic>
 #include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
 #include <opencv2/highgui/highgui.hpp>  // Video write
+#include "encoderthread.h"
+#include "commandparser.h"
+#include "threadschedule.h"
+
+class CameraChannel;
+class PreviewThread;
+class FrameSource;
+class RecorderStats;
+class SerialThread;
+class QualityController;
 
 class CameraThread : public QWidget
 {
@@ -30,7 +44,10 @@ public:
     explicit CameraThread(QWidget *parent = 0);
     ~CameraThread();
     void init(int cameraID, int fps = 25, QString fileName = "movie.avi");
+    void init(FrameSource *source, int fps = 25, QString fileName = "movie.avi");
+    void init(const QList<FrameSource *> &sources, int fps = 25, QString fileName = "movie.avi");
     void initCamera(int cameraID);
+    void initCamera(const QList<FrameSource *> &sources);
     bool isReady(void);
     void start();
 
@@ -41,20 +58,87 @@ protected:
 
 public slots:
     void stopThread(void);
-    void saveActualFrame(void);
+    bool saveActualFrame(qint64 receiveTimestamp = 0);
+    bool saveBurst(int count, qint64 interval, qint64 receiveTimestamp = 0);
     void setFPS(int fps);
+    void setEncoderQueue(int size, EncoderThread::OverflowPolicy policy);
+    void setPreTrigger(double preSeconds, double postSeconds, bool compressed, char command);
+    void setStats(bool enabled, int intervalSeconds = 0);
+    void setCodec(int fourcc);
+    void setSegments(int frames, double seconds, qint64 bytes);
+    void setEncoderThreads(int threads);
+    void setWriteBehind(int megabytes);
+    void setProcessing(const QString &storage, const QString &preview);
+    void setFrameSkipping(double threshold, const cv::Rect &roi, bool markOnly);
+    void setSharedMemory(const QString &name, int slotCount);
+    void setSerialEnabled(bool enabled);
+    void setSerialThreadEnabled(bool enabled);
+    void setPreviewEnabled(bool enabled);
+    void setPreviewOptions(int fps, double scale);
+    void setAdaptiveQuality(bool enabled, int minQuality, int minPreviewFps, double minPreviewScale);
+    void processRSData(const QByteArray &data, qint64 receiveTimestamp);
     void readRSData(void);
     void openRS(void);
     void readRSConfig(void);
+    void printStats(void);
+    void adaptQuality(void);
 
 private:
+    bool saveEventWindow(qint64 receiveTimestamp);
+    void sendStats(void);
+    void sendReply(CommandParser::ReplyStatus status, quint32 frameIndex = 0, qint64 timestamp = 0);
+    void sendStatsReply(void);
+    bool hasRS(void) const;
+    void writeRS(const QByteArray &data);
+    void openRSThread(void);
+    int queueDepth(void) const;
+    void createPreview(bool follow);
+    void createQualityController(void);
     void setRSConfiguration(Settings &configuration);
     void wait(int ms);
 
 private:
-    cv::VideoCapture *_cap;
-    cv::Mat *_frame;
-    cv::VideoWriter *_outputVideo;
+    QList<CameraChannel *> _channels;
+    QVector<RecordedFrame> _pendingFrames;
+    QVector<int> _pendingSlots;
+    PreviewThread *_preview;
+    int _previewFps;
+    double _previewScale;
+    QString _previewProcess;
+    QString _storeProcess;
+    double _preTriggerSeconds;
+    double _postTriggerSeconds;
+    bool _preTriggerCompressed;
+    RecorderStats *_stats;
+    bool _statsEnabled;
+    int _statsInterval;
+    QTimer *_statsTimer;
+    int _codec;
+    int _segmentFrames;
+    double _segmentSeconds;
+    qint64 _segmentBytes;
+    int _encoderThreads;
+    int _writeBehindMegabytes;
+    double _skipThreshold;
+    cv::Rect _skipRoi;
+    bool _skipMarkOnly;
+    QString _sharedMemoryName;
+    int _sharedMemorySlots;
+    bool _serialEnabled;
+    bool _serialThreadEnabled;
+    bool _previewEnabled;
+    bool _adaptiveEnabled;
+    int _adaptiveMinQuality;
+    int _adaptiveMinPreviewFps;
+    double _adaptiveMinPreviewScale;
+    QualityController *_qualityController;
+    QTimer *_qualityTimer;
+    QVector<EncoderThread::Counters> _qualityCounters;
+    qint64 _qualityTimestamp;
+    QVector<ThreadSchedule> _schedules;
+    bool _lockMemory;
+    int _queueSize;
+    EncoderThread::OverflowPolicy _overflowPolicy;
     QString _videoName;
     int _fps;
     bool _quit;
@@ -63,8 +147,12 @@ private:
     bool _save;
     bool _onlyCameraRun;
     QSerialPort *_serial;
+    SerialThread *_serialThread;
     Settings _p;
-    int _frameCount;
+    CommandParser _parser;
+    std::atomic<quint64> _triggersReceived;     //!< written by serial reader thread, read by quality timer
+    std::atomic<int> _frameCount;               //!< burst frames are counted by capture thread
+    qint64 _lastCaptureTimestamp;
 };
 
 #endif // CAMERATHREAD_H
@@ -0,0 +1,361 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include "capturethread.h"
+#include "encoderthread.h"
+#include "framepool.h"
+#include "framesource.h"
+#include "monotonicclock.h"
+#include "pretriggerbuffer.h"
+#include "recorderstats.h"
+#include "sharedframepublisher.h"
+
+//!
+//! \brief Object constructor. Preallocates all frame buffers.
+//! \param source Represents opened camera, owned by caller but used only by this thread after start.
+//! \param frameSize Represents size of frames delivered by camera.
+//! \param pool Represents allocator of ring and copied frames, owned by caller; nullptr uses heap.
+//! \param bufferCount Represents number of frames kept in ring.
+//! \param parent Represents parent of object.
+//!
+CaptureThread::CaptureThread(FrameSource *source, cv::Size frameSize, FramePool *pool, int bufferCount, QObject *parent) :
+    QThread(parent),
+    _source(source),
+    _pool(pool),
+    _encoder(nullptr),
+    _preTrigger(nullptr),
+    _stats(nullptr),
+    _publisher(nullptr),
+    _frameCounter(nullptr),
+    _latest(-1),
+    _sequence(0)
+{
+    // Two readers (trigger and preview) may hold slots, one slot is written and one is latest.
+    bufferCount = qMax(bufferCount, 4);
+
+    // Compressed source sizes its JPEG rows itself on first read.
+    bool preallocate = source != nullptr && !source->isCompressed();
+
+    this->_slots.resize(bufferCount);
+    for (int i = 0; i < this->_slots.size(); ++i)
+    {
+        this->_slots[i].frame.allocator = pool;
+        if (preallocate)
+        {
+            this->_slots[i].frame.create(frameSize, CV_8UC3);
+        }
+        this->_slots[i].timestamp = 0;
+        this->_slots[i].sequence = 0;
+        this->_slots[i].readers = 0;
+    }
+
+    this->_burst.trigger = 0;
+    this->_burst.receiveTimestamp = 0;
+    this->_burst.due = 0;
+    this->_burst.interval = 0;
+    this->_burst.remaining = 0;
+}
+
+//!
+//! \brief Object destructor. Stops capture loop.
+//!
+CaptureThread::~CaptureThread()
+{
+    this->stop();
+}
+
+//!
+//! \brief Method stops capture loop and waits for thread end.
+//!
+void CaptureThread::stop(void)
+{
+    this->requestInterruption();
+    this->wait();
+}
+
+//!
+//! \brief Method copies newest captured frame.
+//! \param frame Represents destination, reused when it has the same size and type.
+//! \param timestamp Represents optional output for monotonic capture time in ns.
+//! \param sequence Represents optional output for capture sequence number.
+//! \return Returns true if any frame was captured, otherwise false.
+//!
+bool CaptureThread::latestFrame(cv::Mat &frame, qint64 *timestamp, quint64 *sequence)
+{
+    int index = this->acquireLatest(timestamp, sequence);
+    if (index < 0)
+    {
+        return false;
+    }
+
+    this->copySlot(index, frame);
+    this->releaseSlot(index);
+    return true;
+}
+
+//!
+//! \brief Method holds newest captured frame, so it is not overwritten until releaseSlot().
+//! Lets caller pick frames of several cameras first and copy them afterwards.
+//! \param timestamp Represents optional output for monotonic capture time in ns.
+//! \param sequence Represents optional output for capture sequence number.
+//! \return Returns slot index or -1 if no frame was captured yet.
+//!
+int CaptureThread::acquireLatest(qint64 *timestamp, quint64 *sequence)
+{
+    QMutexLocker locker(&this->_mutex);
+    if (this->_latest < 0)
+    {
+        return -1;
+    }
+
+    int index = this->_latest;
+    ++this->_slots[index].readers;
+    if (timestamp != nullptr)
+    {
+        *timestamp = this->_slots[index].timestamp;
+    }
+    if (sequence != nullptr)
+    {
+        *sequence = this->_slots[index].sequence;
+    }
+    return index;
+}
+
+//!
+//! \brief Method copies held frame.
+//! \param index Represents slot returned by acquireLatest().
+//! \param frame Represents destination, reused when it has the same size and type, otherwise taken from pool.
+//!
+void CaptureThread::copySlot(int index, cv::Mat &frame)
+{
+    if (frame.empty() && this->_pool != nullptr)
+    {
+        frame.allocator = this->_pool;
+    }
+
+    // Slot with readers is never chosen for write, so copy can be done without lock.
+    this->_slots[index].frame.copyTo(frame);
+}
+
+//!
+//! \brief Method lets capture loop reuse held slot.
+//! \param index Represents slot returned by acquireLatest().
+//!
+void CaptureThread::releaseSlot(int index)
+{
+    QMutexLocker locker(&this->_mutex);
+    --this->_slots[index].readers;
+}
+
+//!
+//! \brief Getter for number of captured frames.
+//! \return Returns number of frames read from camera since start.
+//!
+quint64 CaptureThread::framesCaptured(void)
+{
+    QMutexLocker locker(&this->_mutex);
+    return this->_sequence;
+}
+
+//!
+//! \brief Method starts burst recorded by capture loop itself, so frames follow
+//! camera rate instead of serial command rate. Running burst is replaced.
+//! \param trigger Represents trigger number assigned to burst frames.
+//! \param receiveTimestamp Represents monotonic time in ns when command was read, first frame is captured after it.
+//! \param count Represents number of frames to record.
+//! \param interval Represents minimal distance of frames in ns, 0 takes every captured frame.
+//!
+void CaptureThread::requestBurst(quint64 trigger, qint64 receiveTimestamp, int count, qint64 interval)
+{
+    QMutexLocker locker(&this->_mutex);
+    this->_burst.trigger = trigger;
+    this->_burst.receiveTimestamp = receiveTimestamp;
+    this->_burst.due = receiveTimestamp;
+    this->_burst.interval = qMax(interval, qint64(0));
+    this->_burst.remaining = qMax(count, 0);
+}
+
+//!
+//! \brief Getter for burst state.
+//! \return Returns true if burst frames are still being recorded.
+//!
+bool CaptureThread::isBurstActive(void)
+{
+    QMutexLocker locker(&this->_mutex);
+    return this->_burst.remaining > 0;
+}
+
+//!
+//! \brief Setter for burst destination. Has to be called before start.
+//! \param encoder Represents encoder owned by caller, nullptr disables bursts.
+//!
+void CaptureThread::setEncoder(EncoderThread *encoder)
+{
+    this->_encoder = encoder;
+}
+
+//!
+//! \brief Setter for pre-trigger buffer. Has to be called before start.
+//! \param buffer Represents buffer owned by caller, every captured frame is pushed into it.
+//!
+void CaptureThread::setPreTriggerBuffer(PreTriggerBuffer *buffer)
+{
+    this->_preTrigger = buffer;
+}
+
+//!
+//! \brief Setter for instrumentation. Has to be called before start.
+//! \param stats Represents stats owned by caller, nullptr disables measurements.
+//!
+void CaptureThread::setStats(RecorderStats *stats)
+{
+    this->_stats = stats;
+}
+
+//!
+//! \brief Setter for CPU affinity and scheduling policy. Has to be called before start.
+//! \param schedule Represents schedule applied when thread starts, empty keeps inherited one.
+//!
+void CaptureThread::setSchedule(const ThreadSchedule &schedule)
+{
+    this->_schedule = schedule;
+}
+
+//!
+//! \brief Setter for shared memory output. Has to be called before start.
+//! \param publisher Represents ring owned by caller, every captured frame is copied into it.
+//!
+void CaptureThread::setPublisher(SharedFramePublisher *publisher)
+{
+    this->_publisher = publisher;
+}
+
+//!
+//! \brief Setter for counter of saved frames. Has to be called before start.
+//! \param counter Represents counter owned by caller, incremented for every burst frame; nullptr counts nothing.
+//!
+void CaptureThread::setFrameCounter(std::atomic<int> *counter)
+{
+    this->_frameCounter = counter;
+}
+
+//!
+//! \brief Method selects slot which is neither the latest one nor being read.
+//! \return Returns index of slot to fill.
+//!
+int CaptureThread::nextWriteSlot(void)
+{
+    QMutexLocker locker(&this->_mutex);
+    int index = this->_latest;
+    do
+    {
+        index = (index + 1) % this->_slots.size();
+    }
+    while (index == this->_latest || this->_slots[index].readers > 0);
+
+    return index;
+}
+
+//!
+//! \brief Method passes copy of captured frame to encoder. Called only from capture thread.
+//! \param slot Represents slot filled by this loop iteration.
+//! \param burst Represents burst the frame belongs to.
+//!
+void CaptureThread::saveBurstFrame(const Slot &slot, const Burst &burst)
+{
+    qint64 copyStart = this->_stats != nullptr ? monotonicNs() : 0;
+
+    RecordedFrame frame;
+    frame.image.allocator = this->_pool;
+    slot.frame.copyTo(frame.image);
+    frame.trigger = burst.trigger;
+    frame.receiveTimestamp = burst.receiveTimestamp;
+    frame.captureTimestamp = slot.timestamp;
+
+    if (this->_frameCounter != nullptr)
+    {
+        ++*this->_frameCounter;
+    }
+    if (this->_stats != nullptr)
+    {
+        this->_stats->record(RecorderStats::ConvertStage, monotonicNs() - copyStart);
+    }
+
+    // Block policy stalls capture here, so queue should be longer than the longest burst.
+    if (!this->_encoder->enqueue(frame))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Encoder queue full, burst frame dropped:" << slot.sequence;
+    }
+}
+
+//!
+//! \brief Capture loop. Grabs frames continuously into ring.
+//!
+void CaptureThread::run(void)
+{
+    if (this->_source == nullptr || !this->_source->isOpened())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Camera not opened, capture not started";
+        return;
+    }
+    qDebug() << this->objectName() << "thread:" << this->_schedule.apply();
+
+    while (!this->isInterruptionRequested())
+    {
+        int index = this->nextWriteSlot();
+        Slot &slot = this->_slots[index];
+        qint64 readStart = this->_stats != nullptr ? monotonicNs() : 0;
+
+        if (!this->_source->read(slot.frame) || slot.frame.empty())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Cannot read frame from camera";
+            QThread::msleep(10);
+            continue;
+        }
+        qint64 timestamp = monotonicNs();
+
+        if (this->_stats != nullptr)
+        {
+            this->_stats->record(RecorderStats::CaptureStage, timestamp - readStart);
+            this->_stats->increment(RecorderStats::CapturedCounter);
+        }
+
+        Burst burst;
+        burst.remaining = 0;
+        {
+            QMutexLocker locker(&this->_mutex);
+            slot.timestamp = timestamp;
+            slot.sequence = ++this->_sequence;
+            this->_latest = index;
+
+            // Due times are kept on fixed grid, so late frames do not shift the rest of burst.
+            if (this->_burst.remaining > 0 && timestamp >= this->_burst.due)
+            {
+                burst = this->_burst;
+                --this->_burst.remaining;
+                this->_burst.due += this->_burst.interval;
+            }
+        }
+
+        if (burst.remaining > 0 && this->_encoder != nullptr)
+        {
+            this->saveBurstFrame(slot, burst);
+        }
+
+        // Published slot is only read by others and rewritten only by this thread.
+        if (this->_preTrigger != nullptr && this->_preTrigger->push(slot.frame, timestamp))
+        {
+            emit preTriggerWindowFull();
+        }
+
+        // Ring never waits for its readers, so it costs one copy per frame.
+        if (this->_publisher != nullptr)
+        {
+            qint64 publishStart = this->_stats != nullptr ? monotonicNs() : 0;
+            this->_publisher->publish(slot.frame, timestamp, slot.sequence);
+            if (this->_stats != nullptr)
+            {
+                this->_stats->record(RecorderStats::PublishStage, monotonicNs() - publishStart);
+            }
+        }
+    }
+}
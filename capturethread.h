@@ -0,0 +1,81 @@
+#ifndef CAPTURETHREAD_H
+#define CAPTURETHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "threadschedule.h"
+
+class FrameSource;
+class FramePool;
+class EncoderThread;
+class PreTriggerBuffer;
+class RecorderStats;
+class SharedFramePublisher;
+
+class CaptureThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit CaptureThread(FrameSource *source, cv::Size frameSize, FramePool *pool = nullptr, int bufferCount = 4, QObject *parent = 0);
+    ~CaptureThread();
+    void stop(void);
+    bool latestFrame(cv::Mat &frame, qint64 *timestamp = nullptr, quint64 *sequence = nullptr);
+    int acquireLatest(qint64 *timestamp = nullptr, quint64 *sequence = nullptr);
+    void copySlot(int index, cv::Mat &frame);
+    void releaseSlot(int index);
+    quint64 framesCaptured(void);
+    void requestBurst(quint64 trigger, qint64 receiveTimestamp, int count, qint64 interval);
+    bool isBurstActive(void);
+    void setEncoder(EncoderThread *encoder);
+    void setPreTriggerBuffer(PreTriggerBuffer *buffer);
+    void setStats(RecorderStats *stats);
+    void setSchedule(const ThreadSchedule &schedule);
+    void setPublisher(SharedFramePublisher *publisher);
+    void setFrameCounter(std::atomic<int> *counter);
+
+signals:
+    void preTriggerWindowFull(void);
+
+protected:
+    void run(void);
+
+private:
+    struct Slot {
+        cv::Mat frame;
+        qint64 timestamp;
+        quint64 sequence;
+        int readers;
+    };
+
+    struct Burst {
+        quint64 trigger;
+        qint64 receiveTimestamp;
+        qint64 due;
+        qint64 interval;
+        int remaining;
+    };
+
+private:
+    int nextWriteSlot(void);
+    void saveBurstFrame(const Slot &slot, const Burst &burst);
+
+private:
+    FrameSource *_source;
+    FramePool *_pool;
+    EncoderThread *_encoder;
+    PreTriggerBuffer *_preTrigger;
+    RecorderStats *_stats;
+    ThreadSchedule _schedule;
+    SharedFramePublisher *_publisher;
+    std::atomic<int> *_frameCounter;
+    QVector<Slot> _slots;
+    Burst _burst;
+    QMutex _mutex;
+    int _latest;
+    quint64 _sequence;
+};
+
+#endif // CAPTURETHREAD_H
@@ -0,0 +1,218 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+#include <cstdio>
+#include <cstring>
+#include "changedetector.h"
+#include "framekernels.h"
+
+//!
+//! \brief Object constructor.
+//! \param threshold Represents mean absolute byte difference (0-255) a frame needs to be stored.
+//! \param roi Represents compared region in frame pixels, empty or outside of frame compares whole frame.
+//! \param rowStep Represents distance of sampled rows.
+//! \param markOnly Represents true value to store similar frames too and only mark them in log.
+//!
+ChangeDetector::ChangeDetector(double threshold, const cv::Rect &roi, int rowStep, bool markOnly) :
+    _threshold(threshold),
+    _roi(roi),
+    _rowStep(qMax(rowStep, 1)),
+    _markOnly(markOnly)
+{
+    this->_buffer.reserve(64 * 1024 + 256);
+}
+
+//!
+//! \brief Object destructor. Writes rest of log.
+//!
+ChangeDetector::~ChangeDetector()
+{
+    this->flush();
+}
+
+//!
+//! \brief Method creates decision log and writes header line.
+//! \param fileName Represents path of csv file.
+//! \return Returns true if file was opened.
+//!
+bool ChangeDetector::openLog(const QString &fileName)
+{
+    this->_file.setFileName(fileName);
+    if (!this->_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open change log:" << fileName << this->_file.errorString();
+        return false;
+    }
+
+    this->_buffer.resize(0);
+    this->_buffer.append("trigger,capture_ns,difference,decision\n");
+    return true;
+}
+
+//!
+//! \brief Method compares frame with the last stored one. Called only from encoder thread.
+//! \param frame Represents frame about to be written.
+//! \return Returns Skipped if frame should not be written, Stored or Marked otherwise.
+//!
+ChangeDetector::Decision ChangeDetector::check(const RecordedFrame &frame)
+{
+    if (frame.image.empty())
+    {
+        return Stored;
+    }
+
+    cv::Mat roi = this->region(frame.image);
+    size_t rowBytes = size_t(roi.cols) * roi.elemSize();
+    int rows = (roi.rows + this->_rowStep - 1) / this->_rowStep;
+    if (this->_reference.rows != rows || size_t(this->_reference.cols) != rowBytes)
+    {
+        // First frame or frame size changed, nothing to compare with.
+        this->keep(roi);
+        this->log(frame, -1.0, "stored");
+        return Stored;
+    }
+
+    quint64 sum = FrameKernels::sad(roi.data, roi.step * this->_rowStep, this->_reference.data, this->_reference.step,
+                                    int(rowBytes), rows);
+    double difference = double(sum) / (double(rowBytes) * rows);
+    if (difference >= this->_threshold)
+    {
+        this->keep(roi);
+        this->log(frame, difference, "stored");
+        return Stored;
+    }
+    if (this->_markOnly)
+    {
+        this->keep(roi);
+        this->log(frame, difference, "marked");
+        return Marked;
+    }
+
+    this->log(frame, difference, "skipped");
+    return Skipped;
+}
+
+//!
+//! \brief Method writes collected log lines to file.
+//!
+void ChangeDetector::flush(void)
+{
+    if (this->_file.isOpen() && !this->_buffer.isEmpty())
+    {
+        if (this->_file.write(this->_buffer) != this->_buffer.size())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Change log write failed:" << this->_file.errorString();
+        }
+        this->_buffer.resize(0); // keeps capacity
+    }
+}
+
+//!
+//! \brief Method describes settings for logs.
+//! \return Returns threshold, region and mode.
+//!
+QString ChangeDetector::description(void) const
+{
+    QString region = this->_roi.area() > 0
+            ? QString("%1,%2,%3,%4").arg(this->_roi.x).arg(this->_roi.y).arg(this->_roi.width).arg(this->_roi.height)
+            : QString("frame");
+    return QString("%1 difference %2 in %3, every %4 rows (%5)").arg(this->_markOnly ? "mark below" : "skip below")
+            .arg(this->_threshold).arg(region).arg(this->_rowStep).arg(FrameKernels::isaName(FrameKernels::AutoIsa));
+}
+
+//!
+//! \brief Method reads region of interest.
+//! \param text Represents "x,y,width,height".
+//! \param roi Represents output value.
+//! \return Returns false if text is not valid.
+//!
+bool ChangeDetector::parseRoi(const QString &text, cv::Rect &roi)
+{
+    QStringList values = text.split(',');
+    if (values.size() != 4)
+    {
+        return false;
+    }
+
+    int numbers[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        bool ok = false;
+        numbers[i] = values[i].trimmed().toInt(&ok);
+        if (!ok || numbers[i] < 0)
+        {
+            return false;
+        }
+    }
+    if (numbers[2] == 0 || numbers[3] == 0)
+    {
+        return false;
+    }
+    roi = cv::Rect(numbers[0], numbers[1], numbers[2], numbers[3]);
+    return true;
+}
+
+//!
+//! \brief Method builds log name for video.
+//! \param videoName Represents video file name.
+//! \return Returns "<name>_changes.csv" in video directory.
+//!
+QString ChangeDetector::fileNameForVideo(const QString &videoName)
+{
+    QFileInfo info(videoName);
+    return QDir(info.path()).filePath(info.completeBaseName() + "_changes.csv");
+}
+
+//!
+//! \brief Method selects compared part of frame.
+//! \param image Represents frame.
+//! \return Returns view of region of interest, whole frame when region is not set or outside of frame.
+//!
+cv::Mat ChangeDetector::region(const cv::Mat &image) const
+{
+    cv::Rect roi = this->_roi & cv::Rect(0, 0, image.cols, image.rows);
+    return roi.area() > 0 ? image(roi) : image;
+}
+
+//!
+//! \brief Method keeps sampled rows of stored frame as reference.
+//! \param region Represents compared part of stored frame.
+//!
+void ChangeDetector::keep(const cv::Mat &region)
+{
+    size_t rowBytes = size_t(region.cols) * region.elemSize();
+    int rows = (region.rows + this->_rowStep - 1) / this->_rowStep;
+    this->_reference.create(rows, int(rowBytes), CV_8UC1);
+    for (int y = 0; y < rows; ++y)
+    {
+        memcpy(this->_reference.ptr(y), region.ptr(y * this->_rowStep), rowBytes);
+    }
+}
+
+//!
+//! \brief Method adds decision line.
+//! \param frame Represents checked frame.
+//! \param difference Represents measured difference, negative when frame had nothing to compare with.
+//! \param decision Represents decision name.
+//!
+void ChangeDetector::log(const RecordedFrame &frame, double difference, const char *decision)
+{
+    if (!this->_file.isOpen())
+    {
+        return;
+    }
+
+    char line[128];
+    int length = difference >= 0.0
+            ? snprintf(line, sizeof(line), "%llu,%lld,%.3f,%s\n", (unsigned long long) frame.trigger,
+                       (long long) frame.captureTimestamp, difference, decision)
+            : snprintf(line, sizeof(line), "%llu,%lld,,%s\n", (unsigned long long) frame.trigger,
+                       (long long) frame.captureTimestamp, decision);
+    this->_buffer.append(line, length);
+
+    if (this->_buffer.size() >= 64 * 1024)
+    {
+        this->flush();
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef CHANGEDETECTOR_H
+#define CHANGEDETECTOR_H
+
+#include <QFile>
+#include <QByteArray>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "recordedframe.h"
+
+//!
+//! \brief Decides whether frame differs enough from the last stored one.
+//!
+//! Difference is mean absolute difference of bytes of region of interest,
+//! sampled every few rows with vector SAD kernel, so it costs a fraction of
+//! encoding. Only sampled rows of the last stored frame are kept. Decision
+//! of every frame is appended to CSV log in blocks, like timestamps.
+//!
+class ChangeDetector
+{
+public:
+    enum Decision {
+        Stored,
+        Skipped,
+        Marked
+    };
+
+public:
+    ChangeDetector(double threshold, const cv::Rect &roi = cv::Rect(), int rowStep = 4, bool markOnly = false);
+    ~ChangeDetector();
+    bool openLog(const QString &fileName);
+    Decision check(const RecordedFrame &frame);
+    void flush(void);
+    QString description(void) const;
+    static bool parseRoi(const QString &text, cv::Rect &roi);
+    static QString fileNameForVideo(const QString &videoName);
+
+private:
+    cv::Mat region(const cv::Mat &image) const;
+    void keep(const cv::Mat &region);
+    void log(const RecordedFrame &frame, double difference, const char *decision);
+
+private:
+    double _threshold;
+    cv::Rect _roi;
+    int _rowStep;
+    bool _markOnly;
+    cv::Mat _reference;
+    QFile _file;
+    QByteArray _buffer;
+};
+
+#endif // CHANGEDETECTOR_H
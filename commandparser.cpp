@@ -0,0 +1,441 @@
+#include <QtEndian>
+#include "commandparser.h"
+
+//!
+//! \brief Object constructor.
+//!
+CommandParser::CommandParser() :
+    _unknownBytes(0),
+    _frameErrors(0),
+    _eventByte(0),
+    _argumentBytes(-1),
+    _burstCount(0),
+    _burstInterval(0),
+    _frameState(IdleState),
+    _crcBytes(0),
+    _lastTimestamp(0),
+    _framed(false),
+    _sequence(0),
+    _frameCode(0),
+    _frameStatus(StatusOk)
+{
+    this->_frame.reserve(MaxPayload + 5);
+}
+
+//!
+//! \brief Method processes next received byte.
+//! \param byte Represents byte read from serial port.
+//! \param receiveTimestamp Represents monotonic time in ns when chunk with byte was read, 0 disables frame timeout.
+//! \return Returns command completed by this byte or NoCommand.
+//!
+CommandParser::Command CommandParser::feed(char byte, qint64 receiveTimestamp)
+{
+    // Frame is sent at once, gap means sync byte was noise or rest of frame was lost.
+    bool gap = receiveTimestamp != 0 && this->_lastTimestamp != 0
+            && receiveTimestamp - this->_lastTimestamp > qint64(FrameTimeoutMs) * 1000000;
+    if (receiveTimestamp != 0)
+    {
+        this->_lastTimestamp = receiveTimestamp;
+    }
+    if (gap && this->_frameState != IdleState)
+    {
+        ++this->_frameErrors;
+        this->_frameState = IdleState;
+    }
+    if (gap && this->_argumentBytes >= 0)
+    {
+        // Burst argument follows its command at once, so lone 'b' was noise too.
+        ++this->_unknownBytes;
+        this->_argumentBytes = -1;
+    }
+
+    if (this->_frameState == LengthState && uchar(byte) > MaxPayload)
+    {
+        // Sync byte was noise, this byte is not part of frame and may be a command itself.
+        ++this->_frameErrors;
+        this->_frameState = IdleState;
+    }
+
+    if (this->_frameState != IdleState)
+    {
+        return this->feedFramed(uchar(byte));
+    }
+
+    // Arguments of burst command are binary, so they may look like any command.
+    if (this->_argumentBytes >= 0)
+    {
+        this->_argument[this->_argumentBytes++] = uchar(byte);
+        if (this->_argumentBytes < BurstArgumentSize)
+        {
+            return NoCommand;
+        }
+
+        this->_argumentBytes = -1;
+        this->_framed = false;
+        this->setBurst(this->_argument);
+        return BurstCommand;
+    }
+
+    if (uchar(byte) == SyncByte)
+    {
+        this->_frame.resize(0); // keeps capacity
+        this->_frameState = LengthState;
+        return NoCommand;
+    }
+
+    // Single byte commands are not acknowledged.
+    this->_framed = false;
+    if (byte != 0 && byte == this->_eventByte)
+    {
+        return EventCommand;
+    }
+
+    switch (byte)
+    {
+        case 'a':
+        {
+            return TriggerCommand;
+        }
+        break;
+
+        case 'q':
+        {
+            return QuitCommand;
+        }
+        break;
+
+        case 's':
+        {
+            return StatsCommand;
+        }
+        break;
+
+        case 'b':
+        {
+            this->_argumentBytes = 0;
+        }
+        break;
+
+        case '\r':
+        case '\n':
+        {
+            // Terminal line endings are not commands.
+        }
+        break;
+
+        default:
+        {
+            ++this->_unknownBytes;
+        }
+        break;
+    }
+
+    return NoCommand;
+}
+
+//!
+//! \brief Method collects bytes of framed command.
+//! \param byte Represents byte following sync byte.
+//! \return Returns command when frame is complete, otherwise NoCommand.
+//!
+CommandParser::Command CommandParser::feedFramed(uchar byte)
+{
+    this->_frame.append(char(byte));
+
+    switch (this->_frameState)
+    {
+        case LengthState:
+        {
+            if (byte > MaxPayload)
+            {
+                // Only bytes collected by resync() get here, feed() handles new ones.
+                // Without valid length sequence is not known either, so nothing can be replied.
+                ++this->_frameErrors;
+                this->_frameState = IdleState;
+                return NoCommand;
+            }
+            this->_frameState = SequenceState;
+        }
+        break;
+
+        case SequenceState:
+        {
+            this->_frameState = CodeState;
+        }
+        break;
+
+        case CodeState:
+        case PayloadState:
+        {
+            // Length, sequence and code precede payload.
+            if (this->_frame.size() == 3 + uchar(this->_frame.at(0)))
+            {
+                this->_crcBytes = 0;
+                this->_frameState = CrcState;
+            }
+            else
+            {
+                this->_frameState = PayloadState;
+            }
+        }
+        break;
+
+        case CrcState:
+        {
+            if (++this->_crcBytes == 2)
+            {
+                this->_frameState = IdleState;
+                return this->frameCommand();
+            }
+        }
+        break;
+
+        case IdleState:
+        default:
+        {
+        }
+        break;
+    }
+
+    return NoCommand;
+}
+
+//!
+//! \brief Method checks complete frame and decodes its command.
+//! \return Returns decoded command or InvalidFrameCommand, which has to be replied with frameStatus().
+//!
+CommandParser::Command CommandParser::frameCommand(void)
+{
+    const uchar *data = reinterpret_cast<const uchar *>(this->_frame.constData());
+    int length = data[0];
+
+    this->_framed = true;
+    this->_sequence = data[1];
+    this->_frameCode = data[2];
+    this->_frameStatus = StatusOk;
+
+    if (crc16(data, 3 + length) != qFromLittleEndian<quint16>(data + 3 + length))
+    {
+        ++this->_frameErrors;
+        // Sync byte inside means frame start was probably noise, real frame may start there.
+        if (this->_frame.indexOf(char(SyncByte)) >= 0)
+        {
+            return this->resync();
+        }
+        this->_frameStatus = StatusBadCrc;
+        return InvalidFrameCommand;
+    }
+
+    switch (this->_frameCode)
+    {
+        case FrameTrigger:
+        {
+            return TriggerCommand;
+        }
+        break;
+
+        case FrameEvent:
+        {
+            return EventCommand;
+        }
+        break;
+
+        case FrameStats:
+        {
+            return StatsCommand;
+        }
+        break;
+
+        case FrameQuit:
+        {
+            return QuitCommand;
+        }
+        break;
+
+        case FrameBurst:
+        {
+            if (length != BurstArgumentSize)
+            {
+                ++this->_frameErrors;
+                this->_frameStatus = StatusBadLength;
+                return InvalidFrameCommand;
+            }
+            this->setBurst(data + 3);
+            return BurstCommand;
+        }
+        break;
+
+        default:
+        {
+            ++this->_frameErrors;
+            this->_frameStatus = StatusUnknownCommand;
+        }
+        break;
+    }
+
+    return InvalidFrameCommand;
+}
+
+//!
+//! \brief Method restarts frame at next sync byte among collected bytes after CRC error.
+//! Declared length of corrupt frame was received whole, so no later byte belongs to it.
+//! \return Returns command if collected bytes complete frame, otherwise NoCommand.
+//!
+CommandParser::Command CommandParser::resync(void)
+{
+    int next = this->_frame.indexOf(char(SyncByte));
+    if (next < 0)
+    {
+        this->_frameState = IdleState;
+        return NoCommand;
+    }
+
+    QByteArray collected = this->_frame.mid(next + 1);
+    this->_frame.resize(0); // keeps capacity
+    this->_frameState = LengthState;
+    for (int i = 0; i < collected.size(); ++i)
+    {
+        Command command = this->feedFramed(uchar(collected.at(i)));
+        if (command != NoCommand || this->_frameState == IdleState)
+        {
+            // Bytes after frame found inside, or after its bad length, are dropped, they were received before end of corrupt one.
+            this->_unknownBytes += quint64(collected.size() - i - 1);
+            return command;
+        }
+    }
+    return NoCommand;
+}
+
+//!
+//! \brief Method decodes burst arguments.
+//! \param argument Represents frame count (uint16) and interval in us (uint32), little endian.
+//!
+void CommandParser::setBurst(const uchar *argument)
+{
+    this->_burstCount = qFromLittleEndian<quint16>(argument);
+    this->_burstInterval = qint64(qFromLittleEndian<quint32>(argument + 2)) * 1000;
+}
+
+//!
+//! \brief Setter for pre-trigger event command.
+//! \param byte Represents byte which flushes pre-trigger window, 0 disables command.
+//!
+void CommandParser::setEventByte(char byte)
+{
+    this->_eventByte = byte;
+}
+
+//!
+//! \brief Getter for number of ignored bytes.
+//! \return Returns number of bytes which were not part of any command.
+//!
+quint64 CommandParser::unknownBytes(void) const
+{
+    return this->_unknownBytes;
+}
+
+//!
+//! \brief Getter for length of last burst.
+//! \return Returns number of frames requested by last BurstCommand.
+//!
+int CommandParser::burstCount(void) const
+{
+    return this->_burstCount;
+}
+
+//!
+//! \brief Getter for frame interval of last burst.
+//! \return Returns interval in ns, 0 means every captured frame.
+//!
+qint64 CommandParser::burstInterval(void) const
+{
+    return this->_burstInterval;
+}
+
+//!
+//! \brief Getter for number of rejected frames.
+//! \return Returns number of framed commands with bad length, CRC or command code.
+//!
+quint64 CommandParser::frameErrors(void) const
+{
+    return this->_frameErrors;
+}
+
+//!
+//! \brief Getter for origin of last command.
+//! \return Returns true if last command came in frame and expects reply.
+//!
+bool CommandParser::isFramed(void) const
+{
+    return this->_framed;
+}
+
+//!
+//! \brief Getter for sequence of last framed command.
+//! \return Returns sequence number which has to be echoed in reply.
+//!
+quint8 CommandParser::sequence(void) const
+{
+    return this->_sequence;
+}
+
+//!
+//! \brief Getter for command code of last framed command.
+//! \return Returns raw code, also for unknown commands.
+//!
+quint8 CommandParser::frameCode(void) const
+{
+    return this->_frameCode;
+}
+
+//!
+//! \brief Getter for result of last frame check.
+//! \return Returns StatusOk or reason why InvalidFrameCommand was returned.
+//!
+CommandParser::ReplyStatus CommandParser::frameStatus(void) const
+{
+    return this->_frameStatus;
+}
+
+//!
+//! \brief Method computes CRC-16/CCITT (polynomial 0x1021).
+//! \param data Represents checked bytes.
+//! \param size Represents number of bytes.
+//! \param crc Represents initial value.
+//! \return Returns checksum.
+//!
+quint16 CommandParser::crc16(const uchar *data, int size, quint16 crc)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        crc ^= quint16(data[i]) << 8;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? quint16((crc << 1) ^ 0x1021) : quint16(crc << 1);
+        }
+    }
+    return crc;
+}
+
+//!
+//! \brief Method builds framed message.
+//! \param sequence Represents sequence number.
+//! \param code Represents command or reply code.
+//! \param payload Represents message data, at most MaxPayload bytes.
+//! \return Returns bytes ready to be written to serial port.
+//!
+QByteArray CommandParser::frame(quint8 sequence, quint8 code, const QByteArray &payload)
+{
+    QByteArray message;
+    message.reserve(payload.size() + 6);
+    message.append(char(SyncByte));
+    message.append(char(payload.size()));
+    message.append(char(sequence));
+    message.append(char(code));
+    message.append(payload);
+
+    uchar crc[2];
+    qToLittleEndian<quint16>(crc16(reinterpret_cast<const uchar *>(message.constData()) + 1, message.size() - 1), crc);
+    message.append(reinterpret_cast<const char *>(crc), 2);
+    return message;
+}
@@ -0,0 +1,122 @@
+#ifndef COMMANDPARSER_H
+#define COMMANDPARSER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+//!
+//! \brief Streaming parser of commands received over UART.
+//! Bytes are fed one by one in order of arrival, so commands sent in one
+//! chunk are neither merged nor reordered.
+//!
+//! Burst command is binary: 'b', frame count (uint16) and interval in us
+//! (uint32), both little endian. Interval 0 takes every captured frame,
+//! count 0 cancels running burst. Argument has to follow 'b' within
+//! FrameTimeoutMs, otherwise 'b' is taken as noise.
+//!
+//! Framed commands start with sync byte and are acknowledged by recorder:
+//! sync, payload length, sequence, command, payload, CRC-16/CCITT (little
+//! endian, over everything after sync). Reply uses the same layout with
+//! command code or-ed with ReplyFlag and echoed sequence. Frame bytes
+//! have to follow each other within FrameTimeoutMs, partial frame is
+//! dropped after longer gap, so noise byte equal to sync does not swallow
+//! later single byte commands. Byte after sync which is not valid length
+//! ends frame and is handled as single byte command, all of them are
+//! above MaxPayload. After bad CRC parser restarts at next sync byte among
+//! collected bytes, nothing else is dropped.
+//!
+//! Callers stamp whole chunk when it is read, not single bytes, so two
+//! halves of one frame are stamped as far apart as event loop or reader
+//! thread was late. FrameTimeoutMs is therefore well above worst-case
+//! event loop latency, not just above byte time at 1200 Bd and USB
+//! adapter latency, and a real frame is never dropped as timed out.
+//!
+class CommandParser
+{
+public:
+    enum Command {
+        NoCommand,
+        TriggerCommand,
+        EventCommand,
+        StatsCommand,
+        BurstCommand,
+        QuitCommand,
+        InvalidFrameCommand
+    };
+
+    enum FrameCode {
+        FrameTrigger = 0x01,
+        FrameBurst = 0x02,
+        FrameStats = 0x03,
+        FrameQuit = 0x04,
+        FrameEvent = 0x05
+    };
+
+    enum ReplyStatus {
+        StatusOk = 0,
+        StatusDropped = 1,
+        StatusBusy = 2,
+        StatusBadCrc = 3,
+        StatusUnknownCommand = 4,
+        StatusBadLength = 5
+    };
+
+    enum {
+        SyncByte = 0xA5,
+        ReplyFlag = 0x80,
+        MaxPayload = 64,
+        BurstArgumentSize = 6,
+        FrameTimeoutMs = 250        //!< see class description
+    };
+
+public:
+    CommandParser();
+    Command feed(char byte, qint64 receiveTimestamp = 0);
+    void setEventByte(char byte);
+    quint64 unknownBytes(void) const;
+    quint64 frameErrors(void) const;
+    int burstCount(void) const;
+    qint64 burstInterval(void) const;
+    bool isFramed(void) const;
+    quint8 sequence(void) const;
+    quint8 frameCode(void) const;
+    ReplyStatus frameStatus(void) const;
+
+    static quint16 crc16(const uchar *data, int size, quint16 crc = 0xFFFF);
+    static QByteArray frame(quint8 sequence, quint8 code, const QByteArray &payload);
+
+private:
+    enum FrameState {
+        IdleState,
+        LengthState,
+        SequenceState,
+        CodeState,
+        PayloadState,
+        CrcState
+    };
+
+private:
+    Command feedFramed(uchar byte);
+    Command frameCommand(void);
+    Command resync(void);
+    void setBurst(const uchar *argument);
+
+private:
+    quint64 _unknownBytes;
+    quint64 _frameErrors;
+    char _eventByte;
+    int _argumentBytes;
+    uchar _argument[BurstArgumentSize];
+    int _burstCount;
+    qint64 _burstInterval;
+    FrameState _frameState;
+    QByteArray _frame;
+    int _crcBytes;
+    qint64 _lastTimestamp;
+    bool _framed;
+    quint8 _sequence;
+    quint8 _frameCode;
+    ReplyStatus _frameStatus;
+};
+
+#endif // COMMANDPARSER_H
@@ -0,0 +1,419 @@
+#include <QDebug>
+#include "encoderthread.h"
+#include "framesink.h"
+#include "frameprocessor.h"
+#include "changedetector.h"
+#include "timestamplog.h"
+#include "monotonicclock.h"
+#include "pretriggerbuffer.h"
+#include "recorderstats.h"
+
+//!
+//! \brief Object constructor.
+//! \param sink Represents opened video output, owned by caller but used only by this thread after start.
+//! Encoder listens to sink for stored frames until it is destroyed.
+//! \param queueSize Represents number of frames which can wait for encoding.
+//! \param policy Represents behaviour when queue is full.
+//! \param parent Represents parent of object.
+//!
+EncoderThread::EncoderThread(FrameSink *sink, int queueSize, OverflowPolicy policy, QObject *parent) :
+    QThread(parent),
+    _sink(sink),
+    _processor(nullptr),
+    _outputAllocator(nullptr),
+    _changeDetector(nullptr),
+    _timestampLog(nullptr),
+    _preTrigger(nullptr),
+    _stats(nullptr),
+    _queue(queueSize),
+    _policy(policy),
+    _enqueued(0),
+    _written(0),
+    _droppedOldest(0),
+    _droppedNewest(0),
+    _failed(0),
+    _skipped(0),
+    _busyNs(0),
+    _maxDepth(0),
+    _quality(0),
+    _appliedQuality(0)
+{
+    this->_sink->setListener(this);
+}
+
+//!
+//! \brief Object destructor. Writes all queued frames before return.
+//!
+EncoderThread::~EncoderThread()
+{
+    this->stop();
+    this->_sink->setListener(nullptr);
+}
+
+//!
+//! \brief Method passes frame to encoder. Called from trigger path.
+//! Queue is lock-free, only Block policy sleeps until encoder takes a frame.
+//! \param frame Represents frame, moved into queue when accepted.
+//! \return Returns true if frame was queued, false if it was dropped.
+//!
+bool EncoderThread::enqueue(RecordedFrame &frame)
+{
+    frame.enqueueTimestamp = monotonicNs();
+    while (!this->_queue.tryPush(std::move(frame)))
+    {
+        switch (this->_policy)
+        {
+            case Block:
+            {
+                // Encoder wakes producers after every frame it takes, timeout only bounds a missed wake-up.
+                this->_space.wait([this]() { return this->_queue.size() < this->_queue.capacity(); }, 10);
+            }
+            break;
+
+            case DropOldest:
+            {
+                RecordedFrame oldest;
+                if (this->_queue.tryPop(oldest))
+                {
+                    // Slot of dropped frame is reused for the new one.
+                    ++this->_droppedOldest;
+                    if (this->_stats != nullptr)
+                    {
+                        this->_stats->increment(RecorderStats::DroppedTriggersCounter);
+                    }
+                }
+                // Otherwise encoder has just taken the oldest frame and its slot is free.
+            }
+            break;
+
+            case DropNewest:
+            default:
+            {
+                ++this->_droppedNewest;
+                if (this->_stats != nullptr)
+                {
+                    this->_stats->increment(RecorderStats::DroppedTriggersCounter);
+                }
+                return false;
+            }
+            break;
+        }
+    }
+    ++this->_enqueued;
+    this->_idle.wake();
+
+    int depth = this->_queue.size();
+    int maxDepth = this->_maxDepth.load();
+    while (depth > maxDepth && !this->_maxDepth.compare_exchange_weak(maxDepth, depth))
+    {
+    }
+    return true;
+}
+
+//!
+//! \brief Method stops encoder after queued frames are written.
+//!
+void EncoderThread::stop(void)
+{
+    if (this->isRunning())
+    {
+        this->requestInterruption();
+        this->_idle.wake();
+        this->wait();
+    }
+}
+
+//!
+//! \brief Setter for timestamp sidecar. Has to be called before start.
+//! \param log Represents log owned by caller, written only by encoder thread.
+//!
+void EncoderThread::setTimestampLog(TimestampLog *log)
+{
+    this->_timestampLog = log;
+}
+
+//!
+//! \brief Setter for pre-trigger buffer. Has to be called before start.
+//! \param buffer Represents buffer owned by caller, its full windows are written by encoder thread.
+//!
+void EncoderThread::setPreTriggerBuffer(PreTriggerBuffer *buffer)
+{
+    this->_preTrigger = buffer;
+}
+
+//!
+//! \brief Setter for instrumentation. Has to be called before start.
+//! \param stats Represents stats owned by caller, nullptr disables measurements.
+//!
+void EncoderThread::setStats(RecorderStats *stats)
+{
+    this->_stats = stats;
+}
+
+//!
+//! \brief Setter for CPU affinity and scheduling policy. Has to be called before start.
+//! \param schedule Represents schedule applied when thread starts, empty keeps inherited one.
+//!
+void EncoderThread::setSchedule(const ThreadSchedule &schedule)
+{
+    this->_schedule = schedule;
+}
+
+//!
+//! \brief Setter for processing stage. Has to be called before start.
+//! \param processor Represents chain owned by caller, used only by encoder thread; nullptr stores frames as captured.
+//! \param allocator Represents allocator of processed frames, nullptr uses heap.
+//!
+void EncoderThread::setProcessor(FrameProcessor *processor, cv::MatAllocator *allocator)
+{
+    this->_processor = processor;
+    this->_outputAllocator = allocator;
+}
+
+//!
+//! \brief Setter for skipping of frames similar to the last stored one. Has to be called before start.
+//! \param detector Represents detector owned by caller, used only by encoder thread; nullptr stores every frame.
+//! Pre-trigger windows are always stored whole.
+//!
+void EncoderThread::setChangeDetector(ChangeDetector *detector)
+{
+    this->_changeDetector = detector;
+}
+
+//!
+//! \brief Setter for compression quality. May be called from any thread while encoder runs.
+//! Sink gets new value before the next frame is written.
+//! \param quality Represents JPEG quality 1-100.
+//!
+void EncoderThread::setQuality(int quality)
+{
+    this->_quality = quality;
+}
+
+//!
+//! \brief Method wakes encoder without queueing frame, e.g. when pre-trigger window is full.
+//!
+void EncoderThread::wake(void)
+{
+    this->_idle.wake();
+}
+
+//!
+//! \brief Getter for queue counters.
+//! \return Returns snapshot of counters.
+//!
+EncoderThread::Counters EncoderThread::counters(void) const
+{
+    Counters counters;
+    counters.enqueued = this->_enqueued.load();
+    counters.written = this->_written.load();
+    counters.droppedOldest = this->_droppedOldest.load();
+    counters.droppedNewest = this->_droppedNewest.load();
+    counters.failed = this->_failed.load();
+    counters.skipped = this->_skipped.load();
+    counters.busyNs = this->_busyNs.load();
+    counters.depth = this->_queue.size();
+    counters.maxDepth = this->_maxDepth.load();
+    counters.capacity = this->_queue.capacity();
+    return counters;
+}
+
+//!
+//! \brief Method converts policy name into value.
+//! \param text Represents one of "block", "drop-oldest", "drop-newest".
+//! \param policy Represents output value.
+//! \return Returns false if name is unknown.
+//!
+bool EncoderThread::policyFromString(const QString &text, OverflowPolicy &policy)
+{
+    if (text == "block")
+    {
+        policy = Block;
+    }
+    else if (text == "drop-oldest")
+    {
+        policy = DropOldest;
+    }
+    else if (text == "drop-newest")
+    {
+        policy = DropNewest;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Method passes single frame to sink, its timestamps are logged once sink stores it.
+//! \param frame Represents frame to write, its image is released afterwards.
+//!
+void EncoderThread::write(RecordedFrame &frame)
+{
+    qint64 start = monotonicNs();
+    int quality = this->_quality.load();
+    if (quality != this->_appliedQuality)
+    {
+        this->_sink->setQuality(quality);
+        this->_appliedQuality = quality;
+    }
+
+    if (this->_processor != nullptr && !frame.image.empty())
+    {
+        cv::Mat processed;
+        processed.allocator = this->_outputAllocator;
+        if (this->_processor->process(frame.image, processed))
+        {
+            frame.image = processed; // captured frame goes back to pool here
+        }
+        else
+        {
+            qWarning() << __FILE__ << __LINE__ << "Frame not processed, trigger:" << frame.trigger;
+        }
+
+        if (this->_stats != nullptr)
+        {
+            this->_stats->record(RecorderStats::ProcessStage, monotonicNs() - start);
+        }
+    }
+
+    qint64 writeStart = this->_stats != nullptr ? monotonicNs() : 0;
+    bool accepted = this->_sink->writeFrame(frame);
+    qint64 end = monotonicNs();
+    frame.image.release();
+    this->_busyNs += quint64(end - start);
+
+    if (!accepted)
+    {
+        this->frameLost(frame);
+        return;
+    }
+
+    if (this->_stats != nullptr)
+    {
+        this->_stats->record(RecorderStats::EncodeStage, end - writeStart);
+    }
+}
+
+//!
+//! \brief Overloaded method. Frame is in file, its encode time and number are known only now.
+//!
+void EncoderThread::frameStored(const RecordedFrame &frame)
+{
+    qint64 encodeTimestamp = monotonicNs();
+    if (this->_stats != nullptr)
+    {
+        this->_stats->record(RecorderStats::TriggerToDiskStage, encodeTimestamp - frame.receiveTimestamp);
+        this->_stats->increment(RecorderStats::WrittenCounter);
+    }
+
+    if (this->_timestampLog != nullptr)
+    {
+        RecordedFrame stored = frame;
+        stored.encodeTimestamp = encodeTimestamp;
+        this->_timestampLog->append(this->_written.load(), stored);
+    }
+    ++this->_written;
+}
+
+//!
+//! \brief Overloaded method. Lost frame must not appear in timestamp log or as written.
+//!
+void EncoderThread::frameLost(const RecordedFrame &frame)
+{
+    qWarning() << __FILE__ << __LINE__ << "Frame not written, dropped trigger:" << frame.trigger;
+    ++this->_failed;
+    if (this->_stats != nullptr)
+    {
+        this->_stats->increment(RecorderStats::DroppedTriggersCounter);
+    }
+}
+
+//!
+//! \brief Method writes complete pre-trigger window and arms buffer again.
+//!
+void EncoderThread::writePreTriggerWindow(void)
+{
+    this->_preTrigger->waitForFrames();
+    int count = this->_preTrigger->frameCount();
+    qint64 enqueueTimestamp = monotonicNs();
+    RecordedFrame frame;
+    for (int i = 0; i < count; ++i)
+    {
+        if (this->_preTrigger->frame(i, frame))
+        {
+            frame.enqueueTimestamp = enqueueTimestamp;
+            this->write(frame);
+        }
+    }
+    qDebug() << __FILE__ << __LINE__ << "pre-trigger window written:" << count << "frames, trigger:" << frame.trigger
+             << "not compressed in time:" << this->_preTrigger->droppedFrames();
+
+    // Window frames share slot memory, sink must be done with them before capture reuses slots.
+    this->_sink->flush();
+    this->_preTrigger->rearm();
+}
+
+//!
+//! \brief Method checks if encoder has anything to do. Called by encoder before it sleeps.
+//! \return Returns true if frame is queued, pre-trigger window is full or stop was requested.
+//!
+bool EncoderThread::hasWork(void) const
+{
+    return this->_queue.size() > 0 || this->isInterruptionRequested()
+            || (this->_preTrigger != nullptr && this->_preTrigger->isFull());
+}
+
+//!
+//! \brief Encoder loop. Drains queue into video output.
+//!
+void EncoderThread::run(void)
+{
+    qDebug() << this->objectName() << "thread:" << this->_schedule.apply();
+    RecordedFrame frame;
+    for (;;)
+    {
+        if (this->_preTrigger != nullptr && this->_preTrigger->isFull())
+        {
+            this->writePreTriggerWindow();
+        }
+
+        if (!this->_queue.tryPop(frame))
+        {
+            // Queue is drained, only then stop request ends the loop.
+            if (this->isInterruptionRequested())
+            {
+                break;
+            }
+            this->_idle.wait([this]() { return this->hasWork(); }, 100);
+            continue;
+        }
+        this->_space.wake();
+
+        // Similar frame is dropped before any processing or encoding is spent on it.
+        if (this->_changeDetector != nullptr && this->_changeDetector->check(frame) == ChangeDetector::Skipped)
+        {
+            frame.image.release();
+            ++this->_skipped;
+            if (this->_stats != nullptr)
+            {
+                this->_stats->increment(RecorderStats::SkippedCounter);
+            }
+            continue;
+        }
+
+        this->write(frame);
+    }
+
+    // Frames still compressed by sink are reported before logs are finished.
+    this->_sink->flush();
+    if (this->_timestampLog != nullptr)
+    {
+        this->_timestampLog->flush();
+    }
+    if (this->_changeDetector != nullptr)
+    {
+        this->_changeDetector->flush();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef ENCODERTHREAD_H
+#define ENCODERTHREAD_H
+
+#include <QThread>
+#include <atomic>
+#include "boundedqueue.h"
+#include "framesink.h"
+#include "idlewaiter.h"
+#include "recordedframe.h"
+#include "threadschedule.h"
+
+class FrameProcessor;
+class ChangeDetector;
+class TimestampLog;
+class PreTriggerBuffer;
+class RecorderStats;
+
+class EncoderThread : public QThread, public FrameSink::Listener
+{
+    Q_OBJECT
+public:
+    enum OverflowPolicy {
+        Block,
+        DropOldest,
+        DropNewest
+    };
+
+    struct Counters {
+        quint64 enqueued;
+        quint64 written;
+        quint64 droppedOldest;
+        quint64 droppedNewest;
+        quint64 failed;     //!< frames refused by sink
+        quint64 skipped;
+        quint64 busyNs;     //!< time spent processing and writing frames
+        int depth;
+        int maxDepth;
+        int capacity;
+    };
+
+public:
+    explicit EncoderThread(FrameSink *sink, int queueSize = 32, OverflowPolicy policy = Block, QObject *parent = 0);
+    ~EncoderThread();
+    bool enqueue(RecordedFrame &frame);
+    void stop(void);
+    void setTimestampLog(TimestampLog *log);
+    void setPreTriggerBuffer(PreTriggerBuffer *buffer);
+    void setStats(RecorderStats *stats);
+    void setSchedule(const ThreadSchedule &schedule);
+    void setProcessor(FrameProcessor *processor, cv::MatAllocator *allocator);
+    void setChangeDetector(ChangeDetector *detector);
+    void setQuality(int quality);
+    Counters counters(void) const;
+    static bool policyFromString(const QString &text, OverflowPolicy &policy);
+
+public slots:
+    void wake(void);
+
+protected:
+    void run(void);
+    void frameStored(const RecordedFrame &frame);
+    void frameLost(const RecordedFrame &frame);
+
+private:
+    void write(RecordedFrame &frame);
+    void writePreTriggerWindow(void);
+    bool hasWork(void) const;
+
+private:
+    FrameSink *_sink;
+    FrameProcessor *_processor;
+    cv::MatAllocator *_outputAllocator;
+    ChangeDetector *_changeDetector;
+    TimestampLog *_timestampLog;
+    PreTriggerBuffer *_preTrigger;
+    RecorderStats *_stats;
+    ThreadSchedule _schedule;
+    BoundedQueue<RecordedFrame> _queue;
+    IdleWaiter _idle;           //!< encoder waits for frames
+    IdleWaiter _space;          //!< Block policy waits for free slot
+    OverflowPolicy _policy;
+    std::atomic<quint64> _enqueued;
+    std::atomic<quint64> _written;
+    std::atomic<quint64> _droppedOldest;
+    std::atomic<quint64> _droppedNewest;
+    std::atomic<quint64> _failed;
+    std::atomic<quint64> _skipped;
+    std::atomic<quint64> _busyNs;
+    std::atomic<int> _maxDepth;
+    std::atomic<int> _quality;
+    int _appliedQuality;
+};
+
+#endif // ENCODERTHREAD_H
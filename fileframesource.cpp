@@ -0,0 +1,102 @@
+#include <QDebug>
+#include <QDir>
+#include <opencv2/highgui/highgui.hpp>  // Image read
+#include <opencv2/imgproc/imgproc.hpp>  // Resize
+#include "fileframesource.h"
+
+//!
+//! \brief Object constructor. Lists images of directory.
+//! \param directory Represents directory with *.png, *.jpg or *.bmp files, played in name order.
+//! \param fps Represents frame rate of delivered frames.
+//!
+FileFrameSource::FileFrameSource(const QString &directory, double fps) :
+    _directory(directory),
+    _fps(fps > 0.0 ? fps : 25.0),
+    _index(0),
+    _nextFrame(0)
+{
+    QDir dir(directory);
+    foreach (const QString &name, dir.entryList(QStringList() << "*.png" << "*.jpg" << "*.bmp", QDir::Files, QDir::Name))
+    {
+        this->_files << dir.filePath(name);
+    }
+
+    if (this->_files.isEmpty())
+    {
+        qWarning() << __FILE__ << __LINE__ << "No images in:" << directory;
+        return;
+    }
+
+    cv::Mat first = cv::imread(this->_files.first().toStdString(), CV_LOAD_IMAGE_COLOR);
+    this->_size = first.size();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool FileFrameSource::isOpened(void) const
+{
+    return !this->_files.isEmpty() && this->_size.area() > 0;
+}
+
+//!
+//! \brief Overloaded method. Blocks until next frame is due.
+//!
+bool FileFrameSource::read(cv::Mat &frame)
+{
+    if (!this->isOpened())
+    {
+        return false;
+    }
+
+    waitForNextFrame(this->_nextFrame, this->_fps);
+
+    cv::Mat image = cv::imread(this->_files.at(this->_index).toStdString(), CV_LOAD_IMAGE_COLOR);
+    this->_index = (this->_index + 1) % this->_files.size();
+    if (image.empty())
+    {
+        return false;
+    }
+
+    if (image.size() != this->_size)
+    {
+        cv::resize(image, frame, this->_size, 0, 0, CV_INTER_AREA);
+    }
+    else
+    {
+        image.copyTo(frame);
+    }
+    return true;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+cv::Size FileFrameSource::frameSize(void) const
+{
+    return this->_size;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+double FileFrameSource::fps(void) const
+{
+    return this->_fps;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+void FileFrameSource::release(void)
+{
+    this->_files.clear();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString FileFrameSource::description(void) const
+{
+    return QString("images %1 (%2 files)").arg(this->_directory).arg(this->_files.size());
+}
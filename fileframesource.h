@@ -0,0 +1,32 @@
+#ifndef FILEFRAMESOURCE_H
+#define FILEFRAMESOURCE_H
+
+#include <QStringList>
+#include "framesource.h"
+
+//!
+//! \brief Frame source playing image sequence from directory in loop.
+//! Frames are delivered at given rate like from camera, used for tests and
+//! benchmarks without hardware.
+//!
+class FileFrameSource : public FrameSource
+{
+public:
+    FileFrameSource(const QString &directory, double fps);
+    bool isOpened(void) const;
+    bool read(cv::Mat &frame);
+    cv::Size frameSize(void) const;
+    double fps(void) const;
+    void release(void);
+    QString description(void) const;
+
+private:
+    QString _directory;
+    QStringList _files;
+    cv::Size _size;
+    double _fps;
+    int _index;
+    qint64 _nextFrame;
+};
+
+#endif // FILEFRAMESOURCE_H
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Frame extractor: random access to recordings by trigger number
+#
+#-------------------------------------------------
+
+QT       += core
+
+TARGET = FrameExtract
+CONFIG   += console
+CONFIG   -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+include(../recorder.pri)
+
+SOURCES += main.cpp \
+    extractjob.cpp
+
+HEADERS += \
+    extractjob.h
@@ -0,0 +1,102 @@
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <opencv2/highgui/highgui.hpp>  // Image write
+#include "extractjob.h"
+#include "frameindex.h"
+#include "jpegutils.h"
+
+//!
+//! \brief Object constructor.
+//! \param video Represents MJPEG AVI or raw recording with frame index next to it.
+//! \param frames Represents extracted frame numbers.
+//! \param options Represents output settings.
+//! \param failures Represents counter incremented for every frame not extracted.
+//!
+ExtractJob::ExtractJob(const QString &video, const QVector<int> &frames, const Options &options, QAtomicInt *failures) :
+    _video(video),
+    _frames(frames),
+    _options(options),
+    _failures(failures)
+{
+}
+
+//!
+//! \brief Method builds output file name.
+//! \param frame Represents frame number in video.
+//! \param trigger Represents trigger number of frame.
+//! \return Returns name in output directory with video base name, trigger and frame number.
+//!
+QString ExtractJob::outputName(int frame, quint64 trigger) const
+{
+    QFileInfo info(this->_video);
+    QString dir = this->_options.outputDir.isEmpty() ? info.path() : this->_options.outputDir;
+    QString name = QString("%1_trigger%2_frame%3").arg(info.completeBaseName()).arg(trigger).arg(frame, 6, 10, QChar('0'));
+    return QDir(dir).filePath(name + "." + this->_options.suffix);
+}
+
+//!
+//! \brief Method extracts frames. Called by thread pool.
+//!
+void ExtractJob::run(void)
+{
+    FrameIndexReader index;
+    QFile video(this->_video);
+    if (!index.open(FrameIndexFile::fileNameForVideo(this->_video)) || !video.open(QIODevice::ReadOnly))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open recording:" << this->_video << video.errorString();
+        this->_failures->fetchAndAddRelaxed(this->_frames.size());
+        return;
+    }
+
+    // Camera JPEG is copied as is when output is JPEG too, anything else is decoded once.
+    QString suffix = this->_options.suffix.toLower();
+    bool copyJpeg = index.isJpeg() && (suffix == "jpg" || suffix == "jpeg");
+    QByteArray data;
+    int written = 0;
+    foreach (int frame, this->_frames)
+    {
+        const FrameIndexFile::Record &record = index.record(frame);
+        QString output = this->outputName(frame, record.trigger);
+
+        data.resize(int(record.size));
+        if (!video.seek(qint64(record.offset)) || video.read(data.data(), data.size()) != data.size())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Frame data missing:" << frame << this->_video;
+            this->_failures->ref();
+            continue;
+        }
+
+        bool ok = false;
+        if (copyJpeg)
+        {
+            QFile file(output);
+            ok = file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size();
+        }
+        else
+        {
+            cv::Size size = index.frameSize();
+            cv::Mat image;
+            if (index.isJpeg())
+            {
+                image = decodeJpeg(cv::Mat(1, data.size(), CV_8UC1, data.data()));
+            }
+            else if (qint64(data.size()) >= qint64(size.area()) * CV_ELEM_SIZE(index.type()))
+            {
+                image = cv::Mat(size, index.type(), data.data());
+            }
+            ok = !image.empty() && cv::imwrite(output.toStdString(), image);
+        }
+
+        if (!ok)
+        {
+            qWarning() << __FILE__ << __LINE__ << "Frame not extracted:" << frame << output;
+            this->_failures->ref();
+            continue;
+        }
+        ++written;
+    }
+
+    qDebug() << "extracted" << this->_video << written << "of" << this->_frames.size() << "frames";
+}
@@ -0,0 +1,35 @@
+#ifndef EXTRACTJOB_H
+#define EXTRACTJOB_H
+
+#include <QRunnable>
+#include <QString>
+#include <QVector>
+#include <QAtomicInt>
+
+//!
+//! \brief Extraction of selected frames of one recording into image files.
+//! Every job maps index and opens video on its own, so jobs run in
+//! parallel without locks. Frame data are read at offsets from index,
+//! nothing before them is decoded.
+//!
+class ExtractJob : public QRunnable
+{
+public:
+    struct Options {
+        QString suffix;
+        QString outputDir;
+    };
+
+public:
+    ExtractJob(const QString &video, const QVector<int> &frames, const Options &options, QAtomicInt *failures);
+    void run(void);
+    QString outputName(int frame, quint64 trigger) const;
+
+private:
+    QString _video;
+    QVector<int> _frames;
+    Options _options;
+    QAtomicInt *_failures;
+};
+
+#endif // EXTRACTJOB_H
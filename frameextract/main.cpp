@@ -0,0 +1,167 @@
+#include <QCoreApplication>
+#include <QtCore>
+#include "extractjob.h"
+#include "frameindex.h"
+
+//!
+//! \brief Function reads list of numbers and ranges.
+//! \param text Represents e.g. "48213" or "100-200,305".
+//! \param ranges Represents output pairs of first and last number.
+//! \return Returns false if text is not valid.
+//!
+static bool parseRanges(const QString &text, QVector<QPair<quint64, quint64> > &ranges)
+{
+    foreach (const QString &item, text.split(',', QString::SkipEmptyParts))
+    {
+        QStringList bounds = item.trimmed().split('-');
+        bool firstOk = false;
+        bool lastOk = false;
+        quint64 first = bounds.at(0).trimmed().toULongLong(&firstOk);
+        quint64 last = bounds.size() == 2 ? bounds.at(1).trimmed().toULongLong(&lastOk) : first;
+        if (!firstOk || (bounds.size() == 2 && !lastOk) || bounds.size() > 2 || last < first)
+        {
+            return false;
+        }
+        ranges.append(qMakePair(first, last));
+    }
+    return !ranges.isEmpty();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName("FrameExtract");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Extracts frames of MJPEG AVI or raw recordings by trigger number using frame index");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("files", QCoreApplication::translate("main", "Recordings, e.g. all segments of one run."));
+
+    // An option with a value
+    QCommandLineOption triggerOption(QStringList() << "t" << "trigger",
+                                     QCoreApplication::translate("main", "Extract frames of <triggers>, e.g. 48213 or 100-200,305."),
+                                     QCoreApplication::translate("main", "triggers"));
+    parser.addOption(triggerOption);
+
+    // An option with a value
+    QCommandLineOption frameOption(QStringList() << "frame",
+                                   QCoreApplication::translate("main", "Extract <frames> by position in every file, e.g. 0-99."),
+                                   QCoreApplication::translate("main", "frames"));
+    parser.addOption(frameOption);
+
+    // An option with a value
+    QCommandLineOption suffixOption(QStringList() << "format",
+                                    QCoreApplication::translate("main", "Set image format as file <suffix>, jpg copies camera JPEG without decoding."),
+                                    QCoreApplication::translate("main", "suffix"),
+                                    QLatin1String("jpg"));
+    parser.addOption(suffixOption);
+
+    // An option with a value
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    QCoreApplication::translate("main", "Write images to <dir>, default is input directory."),
+                                    QCoreApplication::translate("main", "dir"));
+    parser.addOption(outputOption);
+
+    // An option with a value
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  QCoreApplication::translate("main", "Run <count> extractions in parallel."),
+                                  QCoreApplication::translate("main", "count"),
+                                  QString::number(QThread::idealThreadCount()));
+    parser.addOption(jobsOption);
+
+    // A boolean option
+    QCommandLineOption listOption(QStringList() << "l" << "list", QCoreApplication::translate("main", "Print selected frames instead of extracting them"));
+    parser.addOption(listOption);
+
+    parser.process(a);
+
+    QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Missing input file";
+        return 1;
+    }
+
+    bool byTrigger = parser.isSet(triggerOption);
+    if (byTrigger == parser.isSet(frameOption))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Select frames either by --trigger or by --frame";
+        return 1;
+    }
+
+    QVector<QPair<quint64, quint64> > ranges;
+    if (!parseRanges(parser.value(byTrigger ? triggerOption : frameOption), ranges))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Bad selection:" << parser.value(byTrigger ? triggerOption : frameOption);
+        return 1;
+    }
+
+    ExtractJob::Options options;
+    options.suffix = parser.value(suffixOption);
+    options.outputDir = parser.value(outputOption);
+
+    int jobs = qMax(parser.value(jobsOption).toInt(), 1);
+    bool list = parser.isSet(listOption);
+    QTextStream out(stdout);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+    QAtomicInt failures(0);
+    int selected = 0;
+
+    foreach (const QString &input, inputs)
+    {
+        QVector<int> frames;
+        {
+            FrameIndexReader index;
+            if (!index.open(FrameIndexFile::fileNameForVideo(input)))
+            {
+                failures.ref();
+                continue;
+            }
+
+            for (int i = 0; i < ranges.size(); ++i)
+            {
+                if (byTrigger)
+                {
+                    frames += index.find(ranges[i].first, ranges[i].second);
+                    continue;
+                }
+                for (quint64 frame = ranges[i].first; frame <= ranges[i].second && frame < quint64(index.count()); ++frame)
+                {
+                    frames.append(int(frame));
+                }
+            }
+
+            if (list)
+            {
+                foreach (int frame, frames)
+                {
+                    const FrameIndexFile::Record &record = index.record(frame);
+                    out << input << " frame " << frame << " trigger " << record.trigger << " offset " << record.offset
+                        << " bytes " << record.size << " capture_ns " << record.captureTimestamp << endl;
+                }
+                frames.clear();
+            }
+        }
+        selected += frames.size();
+
+        // Frames are independent, so selection of one file is split between jobs too.
+        int perJob = (frames.size() + jobs - 1) / jobs;
+        for (int first = 0; first < frames.size(); first += perJob)
+        {
+            pool.start(new ExtractJob(input, frames.mid(first, perJob), options, &failures));
+        }
+    }
+
+    pool.waitForDone();
+    if (!list && selected == 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "No frame matches selection";
+        return 1;
+    }
+    return failures.load() == 0 ? 0 : 1;
+}
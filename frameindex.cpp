@@ -0,0 +1,322 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include "frameindex.h"
+
+const char FrameIndexFile::Magic[8] = { 'C', 'A', 'M', 'I', 'D', 'X', 0, 0 };
+
+//!
+//! \brief Function builds index name for video.
+//! \param videoName Represents video file name.
+//! \return Returns "<name>_index.bin" in video directory.
+//!
+QString FrameIndexFile::fileNameForVideo(const QString &videoName)
+{
+    QFileInfo info(videoName);
+    return QDir(info.path()).filePath(info.completeBaseName() + "_index.bin");
+}
+
+//!
+//! \brief Object constructor.
+//! \param bufferSize Represents number of bytes collected before write to file.
+//!
+FrameIndexWriter::FrameIndexWriter(int bufferSize) :
+    _bufferSize(qMax(bufferSize, 4096)),
+    _lastTrigger(0),
+    _sorted(true)
+{
+    memset(&this->_header, 0, sizeof(this->_header));
+    this->_buffer.reserve(this->_bufferSize + int(sizeof(FrameIndexFile::FileHeader) + sizeof(FrameIndexFile::Record)));
+}
+
+//!
+//! \brief Object destructor. Writes rest of buffer and counts.
+//!
+FrameIndexWriter::~FrameIndexWriter()
+{
+    this->close();
+}
+
+//!
+//! \brief Method creates index file. Header is written with the first record, when image format is known.
+//! \param fileName Represents path of index file.
+//! \param jpeg Represents true value when frame data in video are JPEG bytes.
+//! \return Returns true if file was opened.
+//!
+bool FrameIndexWriter::open(const QString &fileName, bool jpeg)
+{
+    this->_file.setFileName(fileName);
+    if (!this->_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open frame index:" << fileName << this->_file.errorString();
+        return false;
+    }
+
+    memset(&this->_header, 0, sizeof(this->_header));
+    memcpy(this->_header.magic, FrameIndexFile::Magic, sizeof(FrameIndexFile::Magic));
+    this->_header.version = FrameIndexFile::Version;
+    this->_header.headerSize = sizeof(FrameIndexFile::FileHeader);
+    this->_header.recordSize = sizeof(FrameIndexFile::Record);
+    this->_header.flags = jpeg ? quint32(FrameIndexFile::JpegFlag) : 0;
+    this->_buffer.resize(0); // keeps capacity
+    this->_lastTrigger = 0;
+    this->_sorted = true;
+    return true;
+}
+
+//!
+//! \brief Method adds record of frame just written to video.
+//! \param frame Represents written frame; image gives format of image payload.
+//! \param offset Represents first byte of frame data in video file.
+//! \param size Represents bytes of frame data.
+//!
+void FrameIndexWriter::append(const RecordedFrame &frame, qint64 offset, qint64 size)
+{
+    if (!this->_file.isOpen())
+    {
+        return;
+    }
+
+    if (this->_header.records == 0)
+    {
+        if ((this->_header.flags & FrameIndexFile::JpegFlag) == 0)
+        {
+            this->_header.width = frame.image.cols;
+            this->_header.height = frame.image.rows;
+            this->_header.type = frame.image.type();
+        }
+        this->_buffer.append(reinterpret_cast<const char *>(&this->_header), sizeof(this->_header));
+    }
+
+    FrameIndexFile::Record record;
+    record.trigger = frame.trigger;
+    record.offset = quint64(offset);
+    record.size = quint32(size);
+    record.flags = FrameIndexFile::KeyframeFlag;     // MJPEG and raw frames stand alone
+    record.captureTimestamp = frame.captureTimestamp;
+    this->_buffer.append(reinterpret_cast<const char *>(&record), sizeof(record));
+
+    this->_sorted = this->_sorted && frame.trigger >= this->_lastTrigger;
+    this->_lastTrigger = frame.trigger;
+    ++this->_header.records;
+
+    if (this->_buffer.size() >= this->_bufferSize)
+    {
+        this->flush();
+    }
+}
+
+//!
+//! \brief Method writes collected records to file.
+//!
+void FrameIndexWriter::flush(void)
+{
+    if (this->_file.isOpen() && !this->_buffer.isEmpty())
+    {
+        if (this->_file.write(this->_buffer) != this->_buffer.size())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Frame index write failed:" << this->_file.errorString();
+        }
+        this->_buffer.resize(0); // keeps capacity
+    }
+}
+
+//!
+//! \brief Method writes rest of records, then counts and order into header, and closes file.
+//!
+void FrameIndexWriter::close(void)
+{
+    if (!this->_file.isOpen())
+    {
+        return;
+    }
+
+    if (this->_header.records == 0)
+    {
+        this->_buffer.append(reinterpret_cast<const char *>(&this->_header), sizeof(this->_header));
+    }
+    this->flush();
+
+    if (this->_sorted)
+    {
+        this->_header.flags |= FrameIndexFile::SortedFlag;
+    }
+    this->_file.seek(0);
+    this->_file.write(reinterpret_cast<const char *>(&this->_header), sizeof(this->_header));
+    this->_file.close();
+}
+
+//!
+//! \brief Object constructor.
+//!
+FrameIndexReader::FrameIndexReader() :
+    _data(nullptr),
+    _records(nullptr),
+    _count(0)
+{
+    memset(&this->_header, 0, sizeof(this->_header));
+}
+
+//!
+//! \brief Object destructor. Unmaps file.
+//!
+FrameIndexReader::~FrameIndexReader()
+{
+    this->close();
+}
+
+//!
+//! \brief Method maps index file.
+//! \param fileName Represents index file.
+//! \return Returns false if file is missing or is not frame index.
+//!
+bool FrameIndexReader::open(const QString &fileName)
+{
+    this->close();
+
+    this->_file.setFileName(fileName);
+    if (!this->_file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open frame index:" << fileName << this->_file.errorString();
+        return false;
+    }
+
+    qint64 size = this->_file.size();
+    this->_data = size >= qint64(sizeof(FrameIndexFile::FileHeader)) ? this->_file.map(0, size) : nullptr;
+    if (this->_data == nullptr)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not map frame index:" << fileName;
+        this->close();
+        return false;
+    }
+
+    memcpy(&this->_header, this->_data, sizeof(this->_header));
+    if (memcmp(this->_header.magic, FrameIndexFile::Magic, sizeof(FrameIndexFile::Magic)) != 0
+            || this->_header.version != FrameIndexFile::Version
+            || this->_header.recordSize != sizeof(FrameIndexFile::Record)
+            || this->_header.headerSize < sizeof(FrameIndexFile::FileHeader) || qint64(this->_header.headerSize) > size)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Not a frame index:" << fileName;
+        this->close();
+        return false;
+    }
+
+    // Count is missing after crash, only complete records are used then.
+    quint64 available = quint64(size - this->_header.headerSize) / sizeof(FrameIndexFile::Record);
+    quint64 records = this->_header.records > 0 ? qMin(this->_header.records, available) : available;
+    if (this->_header.records > 0 && this->_header.records != available)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Frame index record count mismatch:" << available << this->_header.records;
+    }
+
+    this->_records = reinterpret_cast<const FrameIndexFile::Record *>(this->_data + this->_header.headerSize);
+    this->_count = int(qMin(records, quint64(INT_MAX)));
+    return true;
+}
+
+//!
+//! \brief Method unmaps and closes file.
+//!
+void FrameIndexReader::close(void)
+{
+    if (this->_data != nullptr)
+    {
+        this->_file.unmap(this->_data);
+        this->_data = nullptr;
+    }
+    this->_file.close();
+    this->_records = nullptr;
+    this->_count = 0;
+}
+
+//!
+//! \brief Getter for number of frames.
+//! \return Returns number of indexed frames.
+//!
+int FrameIndexReader::count(void) const
+{
+    return this->_count;
+}
+
+//!
+//! \brief Method gives record of frame.
+//! \param frame Represents frame number in video, has to be below count().
+//! \return Returns record in mapped file, valid until close().
+//!
+const FrameIndexFile::Record &FrameIndexReader::record(int frame) const
+{
+    return this->_records[frame];
+}
+
+//!
+//! \brief Method finds frames stored for range of triggers, e.g. all frames of burst.
+//! \param firstTrigger Represents first trigger number.
+//! \param lastTrigger Represents last trigger number, included.
+//! \return Returns frame numbers in file order, empty if no frame belongs to range.
+//!
+QVector<int> FrameIndexReader::find(quint64 firstTrigger, quint64 lastTrigger) const
+{
+    QVector<int> frames;
+    const FrameIndexFile::Record *end = this->_records + this->_count;
+    if (this->isSorted())
+    {
+        const FrameIndexFile::Record *found = std::lower_bound(this->_records, end, firstTrigger,
+                                                               [](const FrameIndexFile::Record &record, quint64 value) {
+            return record.trigger < value;
+        });
+        for (; found != end && found->trigger <= lastTrigger; ++found)
+        {
+            frames.append(int(found - this->_records));
+        }
+        return frames;
+    }
+
+    // Index of interrupted recording has no order flag, it is scanned.
+    for (const FrameIndexFile::Record *record = this->_records; record != end; ++record)
+    {
+        if (record->trigger >= firstTrigger && record->trigger <= lastTrigger)
+        {
+            frames.append(int(record - this->_records));
+        }
+    }
+    return frames;
+}
+
+//!
+//! \brief Getter for frame data kind.
+//! \return Returns true if frame data are JPEG bytes.
+//!
+bool FrameIndexReader::isJpeg(void) const
+{
+    return (this->_header.flags & FrameIndexFile::JpegFlag) != 0;
+}
+
+//!
+//! \brief Getter for record order.
+//! \return Returns true if trigger numbers never decrease.
+//!
+bool FrameIndexReader::isSorted(void) const
+{
+    return (this->_header.flags & FrameIndexFile::SortedFlag) != 0;
+}
+
+//!
+//! \brief Getter for image size.
+//! \return Returns size of image payload, empty for JPEG data.
+//!
+cv::Size FrameIndexReader::frameSize(void) const
+{
+    return cv::Size(this->_header.width, this->_header.height);
+}
+
+//!
+//! \brief Getter for image type.
+//! \return Returns OpenCV type of image payload.
+//!
+int FrameIndexReader::type(void) const
+{
+    return this->_header.type;
+}
@@ -0,0 +1,108 @@
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include "recordedframe.h"
+
+//!
+//! \brief Layout of binary frame index written next to video file.
+//!
+//! File starts with FileHeader followed by one Record per frame stored in
+//! video, in file order, so record number is frame number. Record gives
+//! trigger number, capture time and place of frame data in video: JPEG
+//! bytes of MJPEG AVI chunk, or image payload of raw recording. Values
+//! are stored in host byte order. Counts and SortedFlag are written on
+//! close; after crash reader counts records from file size.
+//!
+namespace FrameIndexFile
+{
+    enum {
+        Version = 1,
+        JpegFlag = 0x1,             //!< frame data are JPEG bytes, image of width, height and type otherwise
+        SortedFlag = 0x2            //!< trigger numbers never decrease
+    };
+
+    enum {
+        KeyframeFlag = 0x1          //!< record flag, frame decodes without previous frames
+    };
+
+    struct FileHeader {
+        char magic[8];              //!< "CAMIDX\0\0"
+        quint32 version;
+        quint32 headerSize;
+        quint32 recordSize;
+        quint32 flags;
+        qint32 width;               //!< image payload only
+        qint32 height;
+        qint32 type;                //!< OpenCV type of image payload
+        quint32 reserved0;
+        quint64 records;            //!< written on close, 0 after crash
+        quint64 reserved[2];
+    };
+
+    struct Record {
+        quint64 trigger;
+        quint64 offset;             //!< first byte of frame data in video file
+        quint32 size;               //!< bytes of frame data
+        quint32 flags;
+        qint64 captureTimestamp;
+    };
+
+    extern const char Magic[8];
+    QString fileNameForVideo(const QString &videoName);
+}
+
+//!
+//! \brief Writer of frame index. Records are collected in memory and
+//! written in large blocks like timestamps, so frame costs no system call.
+//!
+class FrameIndexWriter
+{
+public:
+    explicit FrameIndexWriter(int bufferSize = 64 * 1024);
+    ~FrameIndexWriter();
+    bool open(const QString &fileName, bool jpeg);
+    void append(const RecordedFrame &frame, qint64 offset, qint64 size);
+    void flush(void);
+    void close(void);
+
+private:
+    QFile _file;
+    QByteArray _buffer;
+    FrameIndexFile::FileHeader _header;
+    int _bufferSize;
+    quint64 _lastTrigger;
+    bool _sorted;
+};
+
+//!
+//! \brief Reader of frame index. File is mapped, so any frame is found
+//! without reading whole index; trigger lookup is binary search when
+//! triggers are sorted.
+//!
+class FrameIndexReader
+{
+public:
+    FrameIndexReader();
+    ~FrameIndexReader();
+    bool open(const QString &fileName);
+    void close(void);
+    int count(void) const;
+    const FrameIndexFile::Record &record(int frame) const;
+    QVector<int> find(quint64 firstTrigger, quint64 lastTrigger) const;
+    bool isJpeg(void) const;
+    bool isSorted(void) const;
+    cv::Size frameSize(void) const;
+    int type(void) const;
+
+private:
+    QFile _file;
+    uchar *_data;
+    const FrameIndexFile::Record *_records;
+    FrameIndexFile::FileHeader _header;
+    int _count;
+};
+
+#endif // FRAMEINDEX_H
@@ -0,0 +1,745 @@
+#include "framekernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRAMEKERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled for target attribute and chosen only when CPU has it,
+// so build keeps running on any x86-64 machine.
+#if defined(FRAMEKERNELS_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FRAMEKERNELS_AVX2
+#include <immintrin.h>
+#define FRAMEKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FRAMEKERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace FrameKernels
+{
+
+// Fixed point BT.601 limited range coefficients scaled by 64, small enough for
+// saturating 16-bit vector math to give the same result as scalar code.
+enum {
+    YScale = 75,    // 1.164
+    UToB = 129,     // 2.018
+    UToG = 25,      // 0.391
+    VToG = 52,      // 0.813
+    VToR = 102      // 1.596
+};
+
+// Gray weights scaled by 256, they sum to 256.
+enum {
+    GrayB = 29,
+    GrayG = 150,
+    GrayR = 77
+};
+
+static inline uchar clampByte(int value)
+{
+    return uchar(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+static inline uchar average(int a, int b)
+{
+    return uchar((a + b + 1) >> 1);
+}
+
+// Scalar rows, they also finish what vector rows leave at row end.
+
+static void yuyvToBgrRowScalar(const uchar *src, uchar *dst, int from, int width)
+{
+    for (int x = from & ~1; x + 1 < width; x += 2)
+    {
+        const uchar *pair = src + 2 * x;
+        int u = pair[1] - 128;
+        int v = pair[3] - 128;
+        int b = u * UToB + 32;
+        int g = -u * UToG - v * VToG + 32;
+        int r = v * VToR + 32;
+        for (int i = 0; i < 2; ++i)
+        {
+            int y = (pair[2 * i] - 16) * YScale;
+            uchar *pixel = dst + 3 * (x + i);
+            pixel[0] = clampByte((y + b) >> 6);
+            pixel[1] = clampByte((y + g) >> 6);
+            pixel[2] = clampByte((y + r) >> 6);
+        }
+    }
+}
+
+static void yuyvToGrayRowScalar(const uchar *src, uchar *dst, int from, int width)
+{
+    for (int x = from; x < width; ++x)
+    {
+        dst[x] = src[2 * x];
+    }
+}
+
+static void bgrToGrayRowScalar(const uchar *src, uchar *dst, int from, int width)
+{
+    for (int x = from; x < width; ++x)
+    {
+        const uchar *pixel = src + 3 * x;
+        dst[x] = uchar((pixel[0] * GrayB + pixel[1] * GrayG + pixel[2] * GrayR + 128) >> 8);
+    }
+}
+
+static void halfBgrRowScalar(const uchar *row0, const uchar *row1, uchar *dst, int from, int width)
+{
+    for (int x = from; x < width; ++x)
+    {
+        const uchar *a = row0 + 6 * x;
+        const uchar *b = row1 + 6 * x;
+        for (int c = 0; c < 3; ++c)
+        {
+            dst[3 * x + c] = average(average(a[c], b[c]), average(a[c + 3], b[c + 3]));
+        }
+    }
+}
+
+static void halfGrayRowScalar(const uchar *row0, const uchar *row1, uchar *dst, int from, int width)
+{
+    for (int x = from; x < width; ++x)
+    {
+        dst[x] = average(average(row0[2 * x], row1[2 * x]), average(row0[2 * x + 1], row1[2 * x + 1]));
+    }
+}
+
+static int sadRowScalar(const uchar *a, const uchar *b, int from, int width, quint64 &sum)
+{
+    unsigned int rowSum = 0;
+    for (int x = from; x < width; ++x)
+    {
+        rowSum += a[x] > b[x] ? a[x] - b[x] : b[x] - a[x];
+    }
+    sum += rowSum;
+    return width;
+}
+
+#ifdef FRAMEKERNELS_SSE2
+
+// One unpack layer; applied five times it turns 32 interleaved BGR pixels in
+// six registers into planes B0 B1 G0 G1 R0 R1 of 16 pixels each.
+static inline void deinterleaveLayer(__m128i c[6])
+{
+    __m128i t0 = _mm_unpacklo_epi8(c[0], c[3]);
+    __m128i t1 = _mm_unpackhi_epi8(c[0], c[3]);
+    __m128i t2 = _mm_unpacklo_epi8(c[1], c[4]);
+    __m128i t3 = _mm_unpackhi_epi8(c[1], c[4]);
+    __m128i t4 = _mm_unpacklo_epi8(c[2], c[5]);
+    __m128i t5 = _mm_unpackhi_epi8(c[2], c[5]);
+    c[0] = t0;
+    c[1] = t1;
+    c[2] = t2;
+    c[3] = t3;
+    c[4] = t4;
+    c[5] = t5;
+}
+
+static inline __m128i evenBytes(__m128i a, __m128i b)
+{
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    return _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+}
+
+static inline __m128i oddBytes(__m128i a, __m128i b)
+{
+    return _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+// Inverse of deinterleaveLayer(), five times it turns planes back into BGR.
+static inline void interleaveLayer(__m128i c[6])
+{
+    __m128i t0 = evenBytes(c[0], c[1]);
+    __m128i t3 = oddBytes(c[0], c[1]);
+    __m128i t1 = evenBytes(c[2], c[3]);
+    __m128i t4 = oddBytes(c[2], c[3]);
+    __m128i t2 = evenBytes(c[4], c[5]);
+    __m128i t5 = oddBytes(c[4], c[5]);
+    c[0] = t0;
+    c[1] = t1;
+    c[2] = t2;
+    c[3] = t3;
+    c[4] = t4;
+    c[5] = t5;
+}
+
+static inline void loadBgr32(const uchar *src, __m128i c[6])
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        c[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16 * i));
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        deinterleaveLayer(c);
+    }
+}
+
+static inline void storeBgr32(uchar *dst, __m128i c[6])
+{
+    for (int i = 0; i < 5; ++i)
+    {
+        interleaveLayer(c);
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16 * i), c[i]);
+    }
+}
+
+// Converts 8 YUYV pixels to 16-bit B, G and R before final shift.
+static inline void yuyvToBgr8Sse2(__m128i yuyv, __m128i &b, __m128i &g, __m128i &r)
+{
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    const __m128i half = _mm_set1_epi16(32);
+    __m128i y = _mm_mullo_epi16(_mm_sub_epi16(_mm_and_si128(yuyv, mask), _mm_set1_epi16(16)), _mm_set1_epi16(YScale));
+    __m128i uv = _mm_sub_epi16(_mm_srli_epi16(yuyv, 8), _mm_set1_epi16(128));
+    __m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    __m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+
+    b = _mm_adds_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(u, _mm_set1_epi16(UToB))), half);
+    g = _mm_subs_epi16(_mm_subs_epi16(_mm_adds_epi16(y, half), _mm_mullo_epi16(u, _mm_set1_epi16(UToG))),
+                       _mm_mullo_epi16(v, _mm_set1_epi16(VToG)));
+    r = _mm_adds_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(v, _mm_set1_epi16(VToR))), half);
+    b = _mm_srai_epi16(b, 6);
+    g = _mm_srai_epi16(g, 6);
+    r = _mm_srai_epi16(r, 6);
+}
+
+static int yuyvToBgrRowSse2(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m128i b[4], g[4], r[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            __m128i yuyv = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * x + 16 * i));
+            yuyvToBgr8Sse2(yuyv, b[i], g[i], r[i]);
+        }
+        __m128i planes[6] = {
+            _mm_packus_epi16(b[0], b[1]), _mm_packus_epi16(b[2], b[3]),
+            _mm_packus_epi16(g[0], g[1]), _mm_packus_epi16(g[2], g[3]),
+            _mm_packus_epi16(r[0], r[1]), _mm_packus_epi16(r[2], r[3])
+        };
+        storeBgr32(dst + 3 * x, planes);
+    }
+    return x;
+}
+
+static int yuyvToGrayRowSse2(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * x + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), evenBytes(a, b));
+    }
+    return x;
+}
+
+// Gray of 8 pixels given as 16-bit channels.
+static inline __m128i gray8Sse2(__m128i b, __m128i g, __m128i r)
+{
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(GrayB)), _mm_mullo_epi16(g, _mm_set1_epi16(GrayG)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(r, _mm_set1_epi16(GrayR)));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+static inline __m128i gray16Sse2(__m128i b, __m128i g, __m128i r)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i low = gray8Sse2(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(r, zero));
+    __m128i high = gray8Sse2(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(r, zero));
+    return _mm_packus_epi16(low, high);
+}
+
+static int bgrToGrayRowSse2(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m128i c[6];
+        loadBgr32(src + 3 * x, c);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), gray16Sse2(c[0], c[2], c[4]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 16), gray16Sse2(c[1], c[3], c[5]));
+    }
+    return x;
+}
+
+// Horizontal pair average of 32 bytes of one plane into 16 bytes.
+static inline __m128i halfPairSse2(__m128i a, __m128i b)
+{
+    return _mm_avg_epu8(evenBytes(a, b), oddBytes(a, b));
+}
+
+static inline __m128i loadAverage(const uchar *row0, const uchar *row1)
+{
+    return _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row0)),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1)));
+}
+
+static int halfBgrRowSse2(const uchar *row0, const uchar *row1, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m128i out[6];
+        for (int part = 0; part < 2; ++part)
+        {
+            __m128i c[6];
+            for (int i = 0; i < 6; ++i)
+            {
+                size_t offset = 6 * size_t(x) + 96 * part + 16 * i;
+                c[i] = loadAverage(row0 + offset, row1 + offset);
+            }
+            for (int i = 0; i < 5; ++i)
+            {
+                deinterleaveLayer(c);
+            }
+            out[part] = halfPairSse2(c[0], c[1]);
+            out[2 + part] = halfPairSse2(c[2], c[3]);
+            out[4 + part] = halfPairSse2(c[4], c[5]);
+        }
+        storeBgr32(dst + 3 * x, out);
+    }
+    return x;
+}
+
+static int halfGrayRowSse2(const uchar *row0, const uchar *row1, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = loadAverage(row0 + 2 * x, row1 + 2 * x);
+        __m128i b = loadAverage(row0 + 2 * x + 16, row1 + 2 * x + 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), halfPairSse2(a, b));
+    }
+    return x;
+}
+
+static int sadRowSse2(const uchar *a, const uchar *b, int width, quint64 &sum)
+{
+    __m128i total = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i sad = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x)));
+        total = _mm_add_epi64(total, sad);
+    }
+    sum += quint64(_mm_cvtsi128_si32(total)) + quint64(_mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+    return x;
+}
+
+#endif // FRAMEKERNELS_SSE2
+
+#ifdef FRAMEKERNELS_AVX2
+
+// AVX2 packs work per 128-bit lane, qword permute restores pixel order. Kernels
+// with 3-channel shuffles stay on SSE2, lane crossing would eat the gain.
+
+FRAMEKERNELS_TARGET_AVX2
+static inline __m256i evenBytesAvx2(__m256i a, __m256i b)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00ff);
+    return _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+}
+
+FRAMEKERNELS_TARGET_AVX2
+static inline __m256i oddBytesAvx2(__m256i a, __m256i b)
+{
+    return _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+}
+
+FRAMEKERNELS_TARGET_AVX2
+static int yuyvToGrayRowAvx2(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 2 * x));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 2 * x + 32));
+        __m256i gray = _mm256_permute4x64_epi64(evenBytesAvx2(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), gray);
+    }
+    return x;
+}
+
+FRAMEKERNELS_TARGET_AVX2
+static int halfGrayRowAvx2(const uchar *row0, const uchar *row1, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i a = _mm256_avg_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * x)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * x)));
+        __m256i b = _mm256_avg_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * x + 32)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * x + 32)));
+        __m256i half = _mm256_avg_epu8(evenBytesAvx2(a, b), oddBytesAvx2(a, b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), _mm256_permute4x64_epi64(half, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    return x;
+}
+
+FRAMEKERNELS_TARGET_AVX2
+static int sadRowAvx2(const uchar *a, const uchar *b, int width, quint64 &sum)
+{
+    __m256i total = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i sad = _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x)),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + x)));
+        total = _mm256_add_epi64(total, sad);
+    }
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+    sum += quint64(_mm_cvtsi128_si32(half)) + quint64(_mm_cvtsi128_si32(_mm_srli_si128(half, 8)));
+    return x;
+}
+
+#endif // FRAMEKERNELS_AVX2
+
+#ifdef FRAMEKERNELS_NEON
+
+static int yuyvToBgrRowNeon(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        // Lanes: Y0, U, Y1, V of 8 pixel pairs.
+        uint8x8x4_t yuyv = vld4_u8(src + 2 * x);
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[1])), vdupq_n_s16(128));
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[3])), vdupq_n_s16(128));
+        int16x8_t b = vaddq_s16(vmulq_n_s16(u, UToB), vdupq_n_s16(32));
+        int16x8_t g = vsubq_s16(vsubq_s16(vdupq_n_s16(32), vmulq_n_s16(u, UToG)), vmulq_n_s16(v, VToG));
+        int16x8_t r = vaddq_s16(vmulq_n_s16(v, VToR), vdupq_n_s16(32));
+
+        uint8x8x3_t even, odd;
+        for (int i = 0; i < 2; ++i)
+        {
+            int16x8_t y = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[2 * i])), vdupq_n_s16(16)), YScale);
+            uint8x8x3_t &out = i == 0 ? even : odd;
+            out.val[0] = vqshrun_n_s16(vqaddq_s16(y, b), 6);
+            out.val[1] = vqshrun_n_s16(vqaddq_s16(y, g), 6);
+            out.val[2] = vqshrun_n_s16(vqaddq_s16(y, r), 6);
+        }
+
+        uint8x16x3_t bgr;
+        for (int c = 0; c < 3; ++c)
+        {
+            uint8x8x2_t zipped = vzip_u8(even.val[c], odd.val[c]);
+            bgr.val[c] = vcombine_u8(zipped.val[0], zipped.val[1]);
+        }
+        vst3q_u8(dst + 3 * x, bgr);
+    }
+    return x;
+}
+
+static int yuyvToGrayRowNeon(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        vst1q_u8(dst + x, vld2q_u8(src + 2 * x).val[0]);
+    }
+    return x;
+}
+
+static int bgrToGrayRowNeon(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        uint8x8x3_t bgr = vld3_u8(src + 3 * x);
+        uint16x8_t sum = vmull_u8(bgr.val[0], vdup_n_u8(GrayB));
+        sum = vmlal_u8(sum, bgr.val[1], vdup_n_u8(GrayG));
+        sum = vmlal_u8(sum, bgr.val[2], vdup_n_u8(GrayR));
+        vst1_u8(dst + x, vrshrn_n_u16(sum, 8));
+    }
+    return x;
+}
+
+static int halfBgrRowNeon(const uchar *row0, const uchar *row1, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        // Even and odd source pixels land in separate registers.
+        uint8x8x3_t a0 = vld3_u8(row0 + 6 * x);
+        uint8x8x3_t a1 = vld3_u8(row0 + 6 * x + 24);
+        uint8x8x3_t b0 = vld3_u8(row1 + 6 * x);
+        uint8x8x3_t b1 = vld3_u8(row1 + 6 * x + 24);
+        uint8x8x3_t out;
+        for (int c = 0; c < 3; ++c)
+        {
+            uint8x16_t top = vcombine_u8(a0.val[c], a1.val[c]);
+            uint8x16_t bottom = vcombine_u8(b0.val[c], b1.val[c]);
+            uint8x16_t vertical = vrhaddq_u8(top, bottom);
+            uint8x8x2_t pairs = vuzp_u8(vget_low_u8(vertical), vget_high_u8(vertical));
+            out.val[c] = vrhadd_u8(pairs.val[0], pairs.val[1]);
+        }
+        vst3_u8(dst + 3 * x, out);
+    }
+    return x;
+}
+
+static int halfGrayRowNeon(const uchar *row0, const uchar *row1, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16x2_t a = vld2q_u8(row0 + 2 * x);
+        uint8x16x2_t b = vld2q_u8(row1 + 2 * x);
+        uint8x16_t even = vrhaddq_u8(a.val[0], b.val[0]);
+        uint8x16_t odd = vrhaddq_u8(a.val[1], b.val[1]);
+        vst1q_u8(dst + x, vrhaddq_u8(even, odd));
+    }
+    return x;
+}
+
+static int sadRowNeon(const uchar *a, const uchar *b, int width, quint64 &sum)
+{
+    uint32x4_t total = vdupq_n_u32(0);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t difference = vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x));
+        total = vpadalq_u16(total, vpaddlq_u8(difference));
+    }
+    uint64x2_t pairs = vpaddlq_u32(total);
+    sum += vgetq_lane_u64(pairs, 0) + vgetq_lane_u64(pairs, 1);
+    return x;
+}
+
+#endif // FRAMEKERNELS_NEON
+
+typedef int (*ConvertRow)(const uchar *src, uchar *dst, int width);
+typedef int (*HalfRow)(const uchar *row0, const uchar *row1, uchar *dst, int width);
+typedef int (*SadRow)(const uchar *a, const uchar *b, int width, quint64 &sum);
+
+struct ConvertKernel {
+    ConvertRow sse2;
+    ConvertRow avx2;
+    ConvertRow neon;
+    void (*scalar)(const uchar *src, uchar *dst, int from, int width);
+};
+
+struct HalfKernel {
+    HalfRow sse2;
+    HalfRow avx2;
+    HalfRow neon;
+    void (*scalar)(const uchar *row0, const uchar *row1, uchar *dst, int from, int width);
+};
+
+#ifdef FRAMEKERNELS_SSE2
+#define SSE2_ROW(name) name##Sse2
+#else
+#define SSE2_ROW(name) nullptr
+#endif
+#ifdef FRAMEKERNELS_AVX2
+#define AVX2_ROW(name) name##Avx2
+#else
+#define AVX2_ROW(name) nullptr
+#endif
+#ifdef FRAMEKERNELS_NEON
+#define NEON_ROW(name) name##Neon
+#else
+#define NEON_ROW(name) nullptr
+#endif
+
+static const ConvertKernel YuyvToBgrKernel = {
+    SSE2_ROW(yuyvToBgrRow), nullptr, NEON_ROW(yuyvToBgrRow), yuyvToBgrRowScalar
+};
+static const ConvertKernel YuyvToGrayKernel = {
+    SSE2_ROW(yuyvToGrayRow), AVX2_ROW(yuyvToGrayRow), NEON_ROW(yuyvToGrayRow), yuyvToGrayRowScalar
+};
+static const ConvertKernel BgrToGrayKernel = {
+    SSE2_ROW(bgrToGrayRow), nullptr, NEON_ROW(bgrToGrayRow), bgrToGrayRowScalar
+};
+static const HalfKernel HalfBgrKernel = {
+    SSE2_ROW(halfBgrRow), nullptr, NEON_ROW(halfBgrRow), halfBgrRowScalar
+};
+static const HalfKernel HalfGrayKernel = {
+    SSE2_ROW(halfGrayRow), AVX2_ROW(halfGrayRow), NEON_ROW(halfGrayRow), halfGrayRowScalar
+};
+
+//!
+//! \brief Function checks which instruction sets were built and are supported by CPU.
+//! \param isa Represents requested instruction set, AutoIsa or unsupported one gives the best one.
+//! \return Returns instruction set to use.
+//!
+static Isa resolve(Isa isa)
+{
+    Isa best = bestIsa();
+    if (isa == ScalarIsa || isa == best)
+    {
+        return isa;
+    }
+    // SSE2 is always there when AVX2 is.
+    if (isa == Sse2Isa && best == Avx2Isa)
+    {
+        return Sse2Isa;
+    }
+    return best;
+}
+
+template <typename Row>
+static Row select(Row sse2, Row avx2, Row neon, Isa isa)
+{
+    switch (resolve(isa))
+    {
+        case Avx2Isa: {
+            // Kernels without AVX2 version use SSE2.
+            return avx2 != nullptr ? avx2 : sse2;
+        } break;
+        case Sse2Isa: {
+            return sse2;
+        } break;
+        case NeonIsa: {
+            return neon;
+        } break;
+        default: {
+        } break;
+    }
+    return nullptr;
+}
+
+static void convert(const ConvertKernel &kernel, const uchar *src, size_t srcStep, uchar *dst, size_t dstStep,
+                    int width, int height, Isa isa)
+{
+    ConvertRow row = select(kernel.sse2, kernel.avx2, kernel.neon, isa);
+    for (int y = 0; y < height; ++y)
+    {
+        const uchar *in = src + y * srcStep;
+        uchar *out = dst + y * dstStep;
+        int done = row != nullptr ? row(in, out, width) : 0;
+        kernel.scalar(in, out, done, width);
+    }
+}
+
+static void half(const HalfKernel &kernel, const uchar *src, size_t srcStep, uchar *dst, size_t dstStep,
+                 int dstWidth, int dstHeight, Isa isa)
+{
+    HalfRow row = select(kernel.sse2, kernel.avx2, kernel.neon, isa);
+    for (int y = 0; y < dstHeight; ++y)
+    {
+        const uchar *row0 = src + 2 * y * srcStep;
+        const uchar *row1 = row0 + srcStep;
+        uchar *out = dst + y * dstStep;
+        int done = row != nullptr ? row(row0, row1, out, dstWidth) : 0;
+        kernel.scalar(row0, row1, out, done, dstWidth);
+    }
+}
+
+//!
+//! \brief Function detects the best instruction set, only once.
+//! \return Returns the best instruction set built and supported by CPU.
+//!
+Isa bestIsa(void)
+{
+#if defined(FRAMEKERNELS_AVX2)
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2 ? Avx2Isa : Sse2Isa;
+#elif defined(FRAMEKERNELS_SSE2)
+    return Sse2Isa;
+#elif defined(FRAMEKERNELS_NEON)
+    return NeonIsa;
+#else
+    return ScalarIsa;
+#endif
+}
+
+//!
+//! \brief Function gives name of instruction set for logs.
+//! \param isa Represents instruction set.
+//! \return Returns short name.
+//!
+const char *isaName(Isa isa)
+{
+    switch (resolve(isa))
+    {
+        case Avx2Isa: {
+            return "avx2";
+        } break;
+        case Sse2Isa: {
+            return "sse2";
+        } break;
+        case NeonIsa: {
+            return "neon";
+        } break;
+        default: {
+        } break;
+    }
+    return "scalar";
+}
+
+//!
+//! \brief Function converts YUYV image to BGR with BT.601 limited range coefficients.
+//! \param width Represents number of pixels in row, even.
+//!
+void yuyvToBgr(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, Isa isa)
+{
+    convert(YuyvToBgrKernel, src, srcStep, dst, dstStep, width, height, isa);
+}
+
+//!
+//! \brief Function copies luma of YUYV image to gray one.
+//!
+void yuyvToGray(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, Isa isa)
+{
+    convert(YuyvToGrayKernel, src, srcStep, dst, dstStep, width, height, isa);
+}
+
+//!
+//! \brief Function converts BGR image to gray.
+//!
+void bgrToGray(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, Isa isa)
+{
+    convert(BgrToGrayKernel, src, srcStep, dst, dstStep, width, height, isa);
+}
+
+//!
+//! \brief Function halves BGR image in both directions, every output pixel averages 2x2 block.
+//! \param dstWidth Represents output width, source has at least twice as many pixels.
+//! \param dstHeight Represents output height, source has at least twice as many rows.
+//!
+void halfBgr(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int dstWidth, int dstHeight, Isa isa)
+{
+    half(HalfBgrKernel, src, srcStep, dst, dstStep, dstWidth, dstHeight, isa);
+}
+
+//!
+//! \brief Function halves gray image in both directions, every output pixel averages 2x2 block.
+//!
+void halfGray(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int dstWidth, int dstHeight, Isa isa)
+{
+    half(HalfGrayKernel, src, srcStep, dst, dstStep, dstWidth, dstHeight, isa);
+}
+
+//!
+//! \brief Function sums absolute differences of bytes of two images.
+//! \param widthBytes Represents number of bytes compared in every row.
+//! \return Returns sum over all rows.
+//!
+quint64 sad(const uchar *a, size_t aStep, const uchar *b, size_t bStep, int widthBytes, int height, Isa isa)
+{
+    SadRow row = select<SadRow>(SSE2_ROW(sadRow), AVX2_ROW(sadRow), NEON_ROW(sadRow), isa);
+    quint64 sum = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        const uchar *rowA = a + y * aStep;
+        const uchar *rowB = b + y * bStep;
+        int done = row != nullptr ? row(rowA, rowB, widthBytes, sum) : 0;
+        sadRowScalar(rowA, rowB, done, widthBytes, sum);
+    }
+    return sum;
+}
+
+} // namespace FrameKernels
@@ -0,0 +1,37 @@
+#ifndef FRAMEKERNELS_H
+#define FRAMEKERNELS_H
+
+#include <QtGlobal>
+#include <cstddef>
+
+//!
+//! \brief Pixel kernels of frame processing stage.
+//!
+//! Every kernel has scalar version and vector versions for SSE2, AVX2 and
+//! NEON where they pay off; vector versions give exactly the same result as
+//! scalar ones. Instruction set is chosen at run time, AutoIsa selects the
+//! best one supported by CPU. Images are 8-bit: YUYV (2 bytes per pixel),
+//! BGR (3 bytes) or gray (1 byte), rows are step bytes apart.
+//!
+namespace FrameKernels
+{
+    enum Isa {
+        AutoIsa,
+        ScalarIsa,
+        Sse2Isa,
+        Avx2Isa,
+        NeonIsa
+    };
+
+    Isa bestIsa(void);
+    const char *isaName(Isa isa);
+
+    void yuyvToBgr(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, Isa isa = AutoIsa);
+    void yuyvToGray(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, Isa isa = AutoIsa);
+    void bgrToGray(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int width, int height, Isa isa = AutoIsa);
+    void halfBgr(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int dstWidth, int dstHeight, Isa isa = AutoIsa);
+    void halfGray(const uchar *src, size_t srcStep, uchar *dst, size_t dstStep, int dstWidth, int dstHeight, Isa isa = AutoIsa);
+    quint64 sad(const uchar *a, size_t aStep, const uchar *b, size_t bStep, int widthBytes, int height, Isa isa = AutoIsa);
+}
+
+#endif // FRAMEKERNELS_H
@@ -0,0 +1,211 @@
+#include <QDebug>
+#include <string.h>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "framepool.h"
+#include "recorderstats.h"
+
+//!
+//! \brief Object constructor. Allocates and locks all buffers at once.
+//! \param bufferBytes Represents size of one frame, rounded up to whole pages.
+//! \param capacity Represents number of buffers.
+//!
+FramePool::FramePool(size_t bufferBytes, int capacity) :
+    _memory(nullptr),
+    _bufferBytes(0),
+    _capacity(qMax(capacity, 1)),
+    _free(_capacity),
+    _stats(nullptr),
+    _heapAllocations(0),
+    _available(0),
+    _locked(false)
+{
+    size_t page = pageSize();
+    this->_bufferBytes = (qMax(bufferBytes, size_t(1)) + page - 1) / page * page;
+
+    size_t totalBytes = this->_bufferBytes * size_t(this->_capacity);
+    this->_memory = static_cast<uchar *>(qMallocAligned(totalBytes, page));
+    if (this->_memory == nullptr)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot allocate frame pool of" << totalBytes << "bytes";
+        return;
+    }
+
+    // Touch every page now, so first frames do not pay for page faults.
+    memset(this->_memory, 0, totalBytes);
+
+#ifdef Q_OS_WIN
+    this->_locked = VirtualLock(this->_memory, totalBytes) != 0;
+#else
+    this->_locked = mlock(this->_memory, totalBytes) == 0;
+#endif
+    if (!this->_locked)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Frame pool not locked in memory, check memlock limit";
+    }
+
+    this->_refcounts.resize(size_t(this->_capacity), 0);
+    for (int i = 0; i < this->_capacity; ++i)
+    {
+        this->_free.tryPush(int(i));
+    }
+    this->_available.store(this->_capacity);
+
+    qDebug() << __FILE__ << "frame pool:" << this->_capacity << "x" << this->_bufferBytes << "bytes"
+             << (this->_locked ? "locked" : "not locked");
+}
+
+//!
+//! \brief Object destructor. All frames from pool have to be released before.
+//!
+FramePool::~FramePool()
+{
+    if (this->_memory == nullptr)
+    {
+        return;
+    }
+
+    if (this->_available.load() != this->_capacity)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Frame pool destroyed with" << this->_capacity - this->_available.load()
+                   << "buffers in use";
+    }
+
+    size_t totalBytes = this->_bufferBytes * size_t(this->_capacity);
+#ifdef Q_OS_WIN
+    if (this->_locked)
+    {
+        VirtualUnlock(this->_memory, totalBytes);
+    }
+#else
+    if (this->_locked)
+    {
+        munlock(this->_memory, totalBytes);
+    }
+#endif
+    qFreeAligned(this->_memory);
+}
+
+//!
+//! \brief Overloaded method. Called by cv::Mat::create() of matrix using pool.
+//!
+void FramePool::allocate(int dims, const int *sizes, int type, int *&refcount, uchar *&datastart, uchar *&data, size_t *step)
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; --i)
+    {
+        step[i] = total;
+        total *= size_t(sizes[i]);
+    }
+
+    int index = -1;
+    if (this->_memory != nullptr && total <= this->_bufferBytes && this->_free.tryPop(index))
+    {
+        --this->_available;
+        datastart = data = this->_memory + size_t(index) * this->_bufferBytes;
+        refcount = &this->_refcounts[size_t(index)];
+        *refcount = 1;
+        return;
+    }
+
+    // Pool exhausted or frame bigger than expected; refcount is kept behind data like OpenCV does.
+    ++this->_heapAllocations;
+    if (this->_stats != nullptr)
+    {
+        this->_stats->increment(RecorderStats::HeapAllocationsCounter);
+    }
+
+    size_t alignedTotal = (total + sizeof(int) - 1) / sizeof(int) * sizeof(int);
+    datastart = data = static_cast<uchar *>(qMallocAligned(alignedTotal + sizeof(int), 64));
+    if (datastart == nullptr)
+    {
+        CV_Error(CV_StsNoMem, "Frame pool heap fallback failed");
+    }
+    refcount = reinterpret_cast<int *>(data + alignedTotal);
+    *refcount = 1;
+}
+
+//!
+//! \brief Overloaded method. Called when the last cv::Mat sharing buffer is released.
+//!
+void FramePool::deallocate(int *refcount, uchar *datastart, uchar *data)
+{
+    Q_UNUSED(refcount);
+    Q_UNUSED(data);
+
+    size_t totalBytes = this->_bufferBytes * size_t(this->_capacity);
+    if (this->_memory != nullptr && datastart >= this->_memory && datastart < this->_memory + totalBytes)
+    {
+        int index = int(size_t(datastart - this->_memory) / this->_bufferBytes);
+        this->_free.tryPush(int(index)); // never full, every index is returned once
+        ++this->_available;
+        return;
+    }
+
+    qFreeAligned(datastart);
+}
+
+//!
+//! \brief Setter for instrumentation. Has to be called before frames are allocated.
+//! \param stats Represents stats owned by caller, nullptr disables counting.
+//!
+void FramePool::setStats(RecorderStats *stats)
+{
+    this->_stats = stats;
+}
+
+//!
+//! \brief Getter for number of buffers.
+//! \return Returns pool capacity.
+//!
+int FramePool::capacity(void) const
+{
+    return this->_capacity;
+}
+
+//!
+//! \brief Getter for free buffers.
+//! \return Returns number of buffers not used by any frame.
+//!
+int FramePool::available(void) const
+{
+    return this->_available.load();
+}
+
+//!
+//! \brief Getter for fallback count.
+//! \return Returns number of frames which had to be allocated on heap.
+//!
+quint64 FramePool::heapAllocations(void) const
+{
+    return this->_heapAllocations.load();
+}
+
+//!
+//! \brief Getter for lock state.
+//! \return Returns true if buffers are locked in physical memory.
+//!
+bool FramePool::isLocked(void) const
+{
+    return this->_locked;
+}
+
+//!
+//! \brief Method gives size of memory page.
+//! \return Returns page size in bytes.
+//!
+size_t FramePool::pageSize(void)
+{
+#ifdef Q_OS_WIN
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return size_t(info.dwPageSize);
+#else
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? size_t(size) : 4096;
+#endif
+}
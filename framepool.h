@@ -0,0 +1,53 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "boundedqueue.h"
+
+class RecorderStats;
+
+//!
+//! \brief Fixed set of page aligned, locked frame buffers.
+//!
+//! Pool is used as allocator of cv::Mat: matrix with allocator set takes
+//! its memory from pool in create() and returns it when the last header
+//! sharing it is released. Frames are therefore passed between capture,
+//! encoder and preview as ordinary reference counted cv::Mat headers, and
+//! steady state recording does not touch heap. Requests bigger than buffer
+//! or made when pool is empty fall back to heap and are counted.
+//!
+class FramePool : public cv::MatAllocator
+{
+public:
+    FramePool(size_t bufferBytes, int capacity);
+    ~FramePool();
+    void allocate(int dims, const int *sizes, int type, int *&refcount, uchar *&datastart, uchar *&data, size_t *step);
+    void deallocate(int *refcount, uchar *datastart, uchar *data);
+    void setStats(RecorderStats *stats);
+    int capacity(void) const;
+    int available(void) const;
+    quint64 heapAllocations(void) const;
+    bool isLocked(void) const;
+
+    static size_t pageSize(void);
+
+private:
+    FramePool(const FramePool &);
+    FramePool &operator=(const FramePool &);
+
+private:
+    uchar *_memory;
+    size_t _bufferBytes;
+    int _capacity;
+    std::vector<int> _refcounts;
+    BoundedQueue<int> _free;
+    RecorderStats *_stats;
+    std::atomic<quint64> _heapAllocations;
+    std::atomic<int> _available;
+    bool _locked;
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,290 @@
+#include <QDebug>
+#include <QStringList>
+#include "frameprocessor.h"
+
+//!
+//! \brief Object constructor. Empty chain passes frames unchanged.
+//!
+FrameProcessor::FrameProcessor() :
+    _gray(false),
+    _isa(FrameKernels::AutoIsa)
+{
+}
+
+//!
+//! \brief Method reads chain of steps.
+//! \param spec Represents steps joined by '+': "crop=x,y,w,h", "half", "gray"; empty text gives empty chain.
+//! \return Returns false if step is unknown or has bad arguments, chain is empty then.
+//!
+bool FrameProcessor::parse(const QString &spec)
+{
+    this->_operations.clear();
+    this->_gray = false;
+
+    QStringList steps = spec.split('+', QString::SkipEmptyParts);
+    for (int i = 0; i < steps.size(); ++i)
+    {
+        QString step = steps[i].trimmed().toLower();
+        Operation operation;
+        if (step == "half")
+        {
+            operation.step = Half;
+        }
+        else if (step == "gray")
+        {
+            operation.step = Gray;
+            this->_gray = true;
+        }
+        else if (step.startsWith("crop="))
+        {
+            QStringList values = step.mid(5).split(',');
+            int numbers[4] = { -1, -1, -1, -1 };
+            bool ok = values.size() == 4;
+            for (int j = 0; ok && j < 4; ++j)
+            {
+                numbers[j] = values[j].trimmed().toInt(&ok);
+            }
+            if (!ok || numbers[0] < 0 || numbers[1] < 0 || numbers[2] <= 0 || numbers[3] <= 0)
+            {
+                qWarning() << __FILE__ << __LINE__ << "Crop needs x,y,width,height:" << steps[i];
+                this->_operations.clear();
+                this->_gray = false;
+                return false;
+            }
+            operation.step = Crop;
+            operation.rect = cv::Rect(numbers[0], numbers[1], numbers[2], numbers[3]);
+        }
+        else
+        {
+            qWarning() << __FILE__ << __LINE__ << "Unknown processing step:" << steps[i];
+            this->_operations.clear();
+            this->_gray = false;
+            return false;
+        }
+        this->_operations.append(operation);
+    }
+    return true;
+}
+
+//!
+//! \brief Setter for instruction set of kernels, used by benchmark.
+//! \param isa Represents instruction set, AutoIsa picks the best one.
+//!
+void FrameProcessor::setIsa(FrameKernels::Isa isa)
+{
+    this->_isa = isa;
+}
+
+//!
+//! \brief Method checks if chain has any step.
+//! \return Returns true if frames pass unchanged.
+//!
+bool FrameProcessor::isEmpty(void) const
+{
+    return this->_operations.isEmpty();
+}
+
+//!
+//! \brief Method computes size of processed frame.
+//! \param inputSize Represents size of input frame.
+//! \param inputType Represents type of input frame.
+//! \return Returns size of output frame, empty if crop is outside of frame.
+//!
+cv::Size FrameProcessor::outputSize(cv::Size inputSize, int inputType) const
+{
+    cv::Size size = inputSize;
+    bool yuyv = inputType == CV_8UC2;
+    for (int i = 0; i < this->_operations.size(); ++i)
+    {
+        const Operation &operation = this->_operations[i];
+        switch (operation.step)
+        {
+            case Crop: {
+                size = clip(operation.rect, size, yuyv).size();
+            } break;
+            case Half: {
+                size = cv::Size(size.width / 2, size.height / 2);
+                yuyv = false;
+            } break;
+            case Gray: {
+                yuyv = false;
+            } break;
+        }
+    }
+    return size;
+}
+
+//!
+//! \brief Method computes type of processed frame.
+//! \param inputType Represents type of input frame.
+//! \return Returns CV_8UC1 for gray output, CV_8UC3 otherwise.
+//!
+int FrameProcessor::outputType(int inputType) const
+{
+    return this->_gray || inputType == CV_8UC1 ? CV_8UC1 : CV_8UC3;
+}
+
+//!
+//! \brief Method applies chain to frame.
+//! \param input Represents 8-bit BGR, gray or YUYV frame, it is not modified.
+//! \param output Represents processed frame, created with its own allocator, so it can come from pool.
+//! \return Returns false if input type is not supported or crop is outside of frame.
+//!
+bool FrameProcessor::process(const cv::Mat &input, cv::Mat &output)
+{
+    if (input.empty() || input.depth() != CV_8U || input.channels() > 3)
+    {
+        return false;
+    }
+
+    // Last step writes straight into output; chain ending with crop is copied at the end.
+    int last = !this->_operations.isEmpty() && this->_operations.last().step != Crop ? this->_operations.size() - 1 : -1;
+    cv::Mat current = input;
+    bool yuyv = input.type() == CV_8UC2;
+    int work = 0;
+
+    for (int i = 0; i < this->_operations.size(); ++i)
+    {
+        const Operation &operation = this->_operations[i];
+        if (operation.step == Crop)
+        {
+            cv::Rect rect = clip(operation.rect, current.size(), yuyv);
+            if (rect.area() == 0)
+            {
+                return false;
+            }
+            current = current(rect);
+            continue;
+        }
+
+        cv::Mat &target = i == last ? output : this->_work[work++ % 2];
+        if (yuyv)
+        {
+            // Gray step is done by conversion itself.
+            cv::Mat &converted = operation.step == Gray ? target : this->_converted;
+            this->convertYuyv(current, converted);
+            current = converted;
+            yuyv = false;
+            if (operation.step == Gray)
+            {
+                continue;
+            }
+        }
+
+        switch (operation.step)
+        {
+            case Half: {
+                target.create(current.rows / 2, current.cols / 2, current.type());
+                if (current.channels() == 3)
+                {
+                    FrameKernels::halfBgr(current.data, current.step, target.data, target.step, target.cols, target.rows, this->_isa);
+                }
+                else
+                {
+                    FrameKernels::halfGray(current.data, current.step, target.data, target.step, target.cols, target.rows, this->_isa);
+                }
+            } break;
+            case Gray: {
+                if (current.channels() == 1)
+                {
+                    if (i != last)
+                    {
+                        continue; // already gray
+                    }
+                    current.copyTo(target);
+                }
+                else
+                {
+                    target.create(current.size(), CV_8UC1);
+                    FrameKernels::bgrToGray(current.data, current.step, target.data, target.step, target.cols, target.rows, this->_isa);
+                }
+            } break;
+            default: {
+            } break;
+        }
+        current = target;
+    }
+
+    if (last < 0)
+    {
+        if (yuyv)
+        {
+            this->convertYuyv(current, output);
+        }
+        else
+        {
+            current.copyTo(output);
+        }
+    }
+    return true;
+}
+
+//!
+//! \brief Method describes chain for logs.
+//! \return Returns steps and instruction set or "none".
+//!
+QString FrameProcessor::description(void) const
+{
+    if (this->_operations.isEmpty())
+    {
+        return QString("none");
+    }
+
+    QStringList steps;
+    for (int i = 0; i < this->_operations.size(); ++i)
+    {
+        const Operation &operation = this->_operations[i];
+        switch (operation.step)
+        {
+            case Crop: {
+                steps << QString("crop=%1,%2,%3,%4").arg(operation.rect.x).arg(operation.rect.y)
+                         .arg(operation.rect.width).arg(operation.rect.height);
+            } break;
+            case Half: {
+                steps << "half";
+            } break;
+            case Gray: {
+                steps << "gray";
+            } break;
+        }
+    }
+    return QString("%1 (%2)").arg(steps.join("+")).arg(FrameKernels::isaName(this->_isa));
+}
+
+//!
+//! \brief Method limits crop to frame.
+//! \param rect Represents requested region.
+//! \param size Represents frame size.
+//! \param yuyv Represents true value when frame is YUYV, region then starts and ends on pixel pair.
+//! \return Returns region inside of frame, empty if there is none.
+//!
+cv::Rect FrameProcessor::clip(cv::Rect rect, cv::Size size, bool yuyv)
+{
+    rect &= cv::Rect(0, 0, size.width, size.height);
+    if (yuyv)
+    {
+        int x = rect.x & ~1;
+        rect.width = (rect.width + rect.x - x) & ~1;
+        rect.x = x;
+    }
+    return rect;
+}
+
+//!
+//! \brief Method converts YUYV frame to BGR, or to gray when chain ends gray.
+//! \param input Represents YUYV frame.
+//! \param output Represents converted frame.
+//!
+void FrameProcessor::convertYuyv(const cv::Mat &input, cv::Mat &output) const
+{
+    if (this->_gray)
+    {
+        output.create(input.size(), CV_8UC1);
+        FrameKernels::yuyvToGray(input.data, input.step, output.data, output.step, input.cols, input.rows, this->_isa);
+    }
+    else
+    {
+        output.create(input.size(), CV_8UC3);
+        FrameKernels::yuyvToBgr(input.data, input.step, output.data, output.step, input.cols, input.rows, this->_isa);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMEPROCESSOR_H
+#define FRAMEPROCESSOR_H
+
+#include <QString>
+#include <QVector>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "framekernels.h"
+
+//!
+//! \brief Chain of pixel operations applied to frame before it is stored or shown.
+//!
+//! Chain is given as text, steps joined by '+', e.g. "crop=0,0,1280,720+half+gray":
+//! crop=x,y,w,h keeps region of interest, half averages 2x2 blocks and gray
+//! drops colour. BGR, gray and YUYV (CV_8UC2) input is accepted, YUYV is
+//! converted at the first step that needs pixels, directly to gray when the
+//! chain contains gray. Crop only moves matrix header, so it costs nothing
+//! unless it is the last step. Work buffers are reused, one processor serves
+//! one thread.
+//!
+class FrameProcessor
+{
+public:
+    FrameProcessor();
+    bool parse(const QString &spec);
+    void setIsa(FrameKernels::Isa isa);
+    bool isEmpty(void) const;
+    cv::Size outputSize(cv::Size inputSize, int inputType = CV_8UC3) const;
+    int outputType(int inputType = CV_8UC3) const;
+    bool process(const cv::Mat &input, cv::Mat &output);
+    QString description(void) const;
+
+private:
+    enum Step {
+        Crop,
+        Half,
+        Gray
+    };
+
+    struct Operation {
+        Step step;
+        cv::Rect rect;
+    };
+
+private:
+    static cv::Rect clip(cv::Rect rect, cv::Size size, bool yuyv);
+    void convertYuyv(const cv::Mat &input, cv::Mat &output) const;
+
+private:
+    QVector<Operation> _operations;
+    bool _gray;
+    FrameKernels::Isa _isa;
+    cv::Mat _converted;
+    cv::Mat _work[2];
+};
+
+#endif // FRAMEPROCESSOR_H
@@ -0,0 +1,188 @@
+#include <QDebug>
+#include "framesink.h"
+#include "opencvframesink.h"
+#include "mjpegavisink.h"
+#include "parallelmjpegsink.h"
+#include "rawframesink.h"
+
+//!
+//! \brief Object destructor.
+//!
+FrameSink::Listener::~Listener()
+{
+}
+
+//!
+//! \brief Object constructor.
+//!
+FrameSink::FrameSink() :
+    _listener(nullptr)
+{
+}
+
+//!
+//! \brief Object destructor.
+//!
+FrameSink::~FrameSink()
+{
+}
+
+//!
+//! \brief Method writes frame together with its bookkeeping data.
+//! Sinks which only store images keep default implementation.
+//! \param frame Represents frame selected by trigger.
+//! \return Returns false if frame was not accepted.
+//!
+bool FrameSink::writeFrame(const RecordedFrame &frame)
+{
+    if (!this->write(frame.image))
+    {
+        return false;
+    }
+    this->notifyStored(frame);
+    return true;
+}
+
+//!
+//! \brief Setter for compression quality of next frames.
+//! Sinks which cannot change it keep default implementation.
+//! \param quality Represents JPEG quality 1-100.
+//! \return Returns false if sink does not compress frames itself.
+//!
+bool FrameSink::setQuality(int quality)
+{
+    Q_UNUSED(quality);
+    return false;
+}
+
+//!
+//! \brief Method stores all accepted frames before return.
+//! Sinks which store frames in writeFrame() keep default implementation.
+//!
+void FrameSink::flush(void)
+{
+}
+
+//!
+//! \brief Setter for receiver of stored and lost frames. Has to be called while sink is not used.
+//! \param listener Represents receiver owned by caller, nullptr reports nothing.
+//!
+void FrameSink::setListener(Listener *listener)
+{
+    this->_listener = listener;
+}
+
+//!
+//! \brief Getter for receiver of stored and lost frames.
+//! \return Returns listener set by setListener().
+//!
+FrameSink::Listener *FrameSink::listener(void) const
+{
+    return this->_listener;
+}
+
+//!
+//! \brief Method reports frame which is in file now.
+//! \param frame Represents frame accepted by writeFrame().
+//!
+void FrameSink::notifyStored(const RecordedFrame &frame) const
+{
+    if (this->_listener != nullptr)
+    {
+        this->_listener->frameStored(frame);
+    }
+}
+
+//!
+//! \brief Method reports frame which was accepted but could not be stored.
+//! \param frame Represents frame accepted by writeFrame().
+//!
+void FrameSink::notifyLost(const RecordedFrame &frame) const
+{
+    if (this->_listener != nullptr)
+    {
+        this->_listener->frameLost(frame);
+    }
+}
+
+//!
+//! \brief Factory method creating output for given source.
+//! \param fileName Represents video file name.
+//! \param fourcc Represents codec four character code, -1 asks user to select codec, RawFrameSink::Fourcc stores frames uncompressed.
+//! \param fps Represents frame rate stored in file.
+//! \param frameSize Represents size of frames.
+//! \param compressedInput Represents true value when frames are JPEG bytes from camera.
+//! \param encoderThreads Represents number of threads compressing MJPEG frames.
+//! \param writeBehindBuffer Represents size of blocks written behind encoder in bytes, 0 disables write-behind.
+//! \return Returns new sink owned by caller; check isOpened().
+//!
+FrameSink *FrameSink::create(const QString &fileName, int fourcc, double fps, cv::Size frameSize, bool compressedInput,
+                             int encoderThreads, size_t writeBehindBuffer)
+{
+    if (fourcc == RawFrameSink::Fourcc)
+    {
+        return new RawFrameSink(fileName, fps, frameSize, compressedInput);
+    }
+
+    if (compressedInput)
+    {
+        // Camera JPEG is stored as is, any other codec would need decode and encode again.
+        if (fourcc != -1 && fourcc != CV_FOURCC('M', 'J', 'P', 'G'))
+        {
+            qWarning() << __FILE__ << __LINE__ << "Codec ignored, MJPEG passthrough writes camera frames as is";
+        }
+        return new MjpegAviSink(fileName, fps, frameSize, 90, writeBehindBuffer);
+    }
+
+    if (encoderThreads > 1)
+    {
+        // Only intra-only codec lets frames be compressed independently.
+        if (fourcc == CV_FOURCC('M', 'J', 'P', 'G'))
+        {
+            return new ParallelMjpegSink(fileName, fps, frameSize, encoderThreads, 90, writeBehindBuffer);
+        }
+        qWarning() << __FILE__ << __LINE__ << "Parallel encoding needs MJPG codec, single encoder thread used";
+    }
+
+    if (writeBehindBuffer > 0)
+    {
+        // OpenCV writer owns its file, only AVI written here can be written behind.
+        if (fourcc == CV_FOURCC('M', 'J', 'P', 'G'))
+        {
+            return new MjpegAviSink(fileName, fps, frameSize, 90, writeBehindBuffer);
+        }
+        qWarning() << __FILE__ << __LINE__ << "Write-behind needs MJPG codec, OpenCV writer used";
+    }
+
+    return new OpenCvFrameSink(fileName, fourcc, fps, frameSize);
+}
+
+//!
+//! \brief Method tells whether create() gives MJPEG AVI sink, whose files end at MjpegAviSink::MaxFileSize.
+//! \param fourcc Represents codec four character code.
+//! \param compressedInput Represents true value when frames are JPEG bytes from camera.
+//! \param encoderThreads Represents number of threads compressing MJPEG frames.
+//! \param writeBehindBuffer Represents size of blocks written behind encoder in bytes.
+//! \return Returns true if frames are written by MjpegAviSink.
+//!
+bool FrameSink::writesAvi(int fourcc, bool compressedInput, int encoderThreads, size_t writeBehindBuffer)
+{
+    if (fourcc == RawFrameSink::Fourcc)
+    {
+        return false;
+    }
+    return compressedInput || (fourcc == CV_FOURCC('M', 'J', 'P', 'G') && (encoderThreads > 1 || writeBehindBuffer > 0));
+}
+
+//!
+//! \brief Method tells whether sink given by create() writes frame index file used by FrameExtract.
+//! \param fourcc Represents codec four character code.
+//! \param compressedInput Represents true value when frames are JPEG bytes from camera.
+//! \param encoderThreads Represents number of threads compressing MJPEG frames.
+//! \param writeBehindBuffer Represents size of blocks written behind encoder in bytes.
+//! \return Returns true for MJPEG AVI and raw output, OpenCV writer has no index.
+//!
+bool FrameSink::writesIndex(int fourcc, bool compressedInput, int encoderThreads, size_t writeBehindBuffer)
+{
+    return fourcc == RawFrameSink::Fourcc || FrameSink::writesAvi(fourcc, compressedInput, encoderThreads, writeBehindBuffer);
+}
@@ -0,0 +1,59 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <QString>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "recordedframe.h"
+
+//!
+//! \brief Interface of video outputs.
+//! Sink is opened by its constructor and used only by encoder thread
+//! afterwards. Frames are 8-bit BGR images, or single row of JPEG bytes
+//! for sinks created for compressed sources.
+//!
+//! Frame accepted by writeFrame() is reported to listener once it is in
+//! file. Sinks compressing on worker threads store it later, on one of the
+//! following calls or on flush(), and report frames they lose meanwhile.
+//!
+class FrameSink
+{
+public:
+    //!
+    //! \brief Receiver of stored and lost frames. Called on thread which uses sink.
+    //!
+    class Listener
+    {
+    public:
+        virtual ~Listener();
+        virtual void frameStored(const RecordedFrame &frame) = 0;
+        virtual void frameLost(const RecordedFrame &frame) = 0;
+    };
+
+public:
+    FrameSink();
+    virtual ~FrameSink();
+    virtual bool isOpened(void) const = 0;
+    virtual bool write(const cv::Mat &frame) = 0;
+    virtual bool writeFrame(const RecordedFrame &frame);
+    virtual void release(void) = 0;
+    virtual QString description(void) const = 0;
+    virtual qint64 bytesWritten(void) const = 0;
+    virtual bool setQuality(int quality);
+    virtual void flush(void);
+    virtual void setListener(Listener *listener);
+
+    static FrameSink *create(const QString &fileName, int fourcc, double fps, cv::Size frameSize, bool compressedInput,
+                             int encoderThreads = 1, size_t writeBehindBuffer = 0);
+    static bool writesAvi(int fourcc, bool compressedInput, int encoderThreads = 1, size_t writeBehindBuffer = 0);
+    static bool writesIndex(int fourcc, bool compressedInput, int encoderThreads = 1, size_t writeBehindBuffer = 0);
+
+protected:
+    Listener *listener(void) const;
+    void notifyStored(const RecordedFrame &frame) const;
+    void notifyLost(const RecordedFrame &frame) const;
+
+private:
+    Listener *_listener;
+};
+
+#endif // FRAMESINK_H
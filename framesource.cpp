@@ -0,0 +1,87 @@
+#include <QDebug>
+#include <QFileInfo>
+#include <chrono>
+#include <thread>
+#include "framesource.h"
+#include "opencvframesource.h"
+#include "fileframesource.h"
+#ifdef Q_OS_LINUX
+#include "v4l2framesource.h"
+#endif
+#include "monotonicclock.h"
+
+//!
+//! \brief Object destructor.
+//!
+FrameSource::~FrameSource()
+{
+}
+
+//!
+//! \brief Getter for compressed delivery.
+//! \return Returns true if read() gives JPEG bytes instead of BGR image.
+//!
+bool FrameSource::isCompressed(void) const
+{
+    return false;
+}
+
+//!
+//! \brief Factory method creating backend from source description.
+//! \param spec Represents camera id ("0"), "v4l2:<device>", "v4l2-mjpeg:<device>", "file:<image dir>" or path of video file.
+//! \param fps Represents frame rate used by sources which cannot report it.
+//! \return Returns new source owned by caller or nullptr if spec is not supported.
+//!
+FrameSource *FrameSource::create(const QString &spec, double fps)
+{
+    bool ok = false;
+    int cameraID = spec.toInt(&ok);
+    if (ok)
+    {
+        return new OpenCvFrameSource(cameraID);
+    }
+
+    if (spec.startsWith("v4l2:") || spec.startsWith("v4l2-mjpeg:"))
+    {
+#ifdef Q_OS_LINUX
+        bool passthrough = spec.startsWith("v4l2-mjpeg:");
+        return new V4l2FrameSource(spec.mid(spec.indexOf(':') + 1), passthrough);
+#else
+        qWarning() << __FILE__ << __LINE__ << "V4L2 capture is available only on Linux";
+        return nullptr;
+#endif
+    }
+
+    if (spec.startsWith("file:"))
+    {
+        return new FileFrameSource(spec.mid(5), fps);
+    }
+
+    if (QFileInfo(spec).exists())
+    {
+        return new OpenCvFrameSource(spec);
+    }
+
+    qWarning() << __FILE__ << __LINE__ << "Unknown frame source:" << spec;
+    return nullptr;
+}
+
+//!
+//! \brief Method paces sources which are not limited by hardware, like camera would.
+//! \param nextFrame Represents monotonic due time of next frame in ns, 0 at start; updated.
+//! \param fps Represents frame rate.
+//!
+void FrameSource::waitForNextFrame(qint64 &nextFrame, double fps)
+{
+    qint64 period = qint64(1e9 / (fps > 0.0 ? fps : 25.0));
+    qint64 now = monotonicNs();
+    if (nextFrame == 0 || now - nextFrame > period)
+    {
+        nextFrame = now; // start or overrun, do not try to catch up
+    }
+    else if (nextFrame > now)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(nextFrame - now));
+    }
+    nextFrame += period;
+}
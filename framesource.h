@@ -0,0 +1,31 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QString>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+
+//!
+//! \brief Interface of capture backends.
+//! Source is opened by its constructor and used only by capture thread
+//! afterwards. Frames are delivered as 8-bit BGR, or as single row of JPEG
+//! bytes when isCompressed() is true.
+//!
+class FrameSource
+{
+public:
+    virtual ~FrameSource();
+    virtual bool isOpened(void) const = 0;
+    virtual bool read(cv::Mat &frame) = 0;
+    virtual cv::Size frameSize(void) const = 0;
+    virtual double fps(void) const = 0;
+    virtual void release(void) = 0;
+    virtual QString description(void) const = 0;
+    virtual bool isCompressed(void) const;
+
+    static FrameSource *create(const QString &spec, double fps = 25.0);
+
+protected:
+    static void waitForNextFrame(qint64 &nextFrame, double fps);
+};
+
+#endif // FRAMESOURCE_H
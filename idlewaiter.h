@@ -0,0 +1,74 @@
+#ifndef IDLEWAITER_H
+#define IDLEWAITER_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+//!
+//! \brief Sleep and wake-up of threads waiting for lock-free queue.
+//!
+//! Waiting thread announces that it is going to sleep and checks its queue
+//! once more, waking thread looks at the announcement after it has changed
+//! the queue. Fences make sure one of them sees the other, so waking thread
+//! takes the mutex only when some thread really sleeps and never waits.
+//!
+class IdleWaiter
+{
+public:
+    IdleWaiter();
+
+    template <typename Ready>
+    void wait(Ready ready, unsigned long timeoutMs);
+    void wake(void);
+
+private:
+    IdleWaiter(const IdleWaiter &);
+    IdleWaiter &operator=(const IdleWaiter &);
+
+private:
+    QMutex _mutex;
+    QWaitCondition _condition;
+    std::atomic<int> _sleeping;
+};
+
+//!
+//! \brief Object constructor.
+//!
+inline IdleWaiter::IdleWaiter() :
+    _sleeping(0)
+{
+}
+
+//!
+//! \brief Method puts calling thread to sleep until wake() or timeout.
+//! \param ready Represents predicate telling that queue changed meanwhile, thread does not sleep then.
+//! \param timeoutMs Represents longest sleep.
+//!
+template <typename Ready>
+void IdleWaiter::wait(Ready ready, unsigned long timeoutMs)
+{
+    QMutexLocker locker(&this->_mutex);
+    this->_sleeping.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready())
+    {
+        this->_condition.wait(&this->_mutex, timeoutMs);
+    }
+    this->_sleeping.fetch_sub(1, std::memory_order_relaxed);
+}
+
+//!
+//! \brief Method wakes all sleeping threads. Called after queue was changed.
+//!
+inline void IdleWaiter::wake(void)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->_sleeping.load(std::memory_order_relaxed) > 0)
+    {
+        QMutexLocker locker(&this->_mutex);
+        this->_condition.wakeAll();
+    }
+}
+
+#endif // IDLEWAITER_H
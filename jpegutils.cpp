@@ -0,0 +1,121 @@
+#include <vector>
+#include <string.h>
+#include <opencv2/highgui/highgui.hpp>  // Image decode
+#include "jpegutils.h"
+
+// DHT segment with tables from JPEG standard Annex K.3. MJPEG cameras usually
+// omit it, every decoder assumes these tables then (AVI1 convention).
+static const uchar standardHuffmanTables[] = {
+    0xff, 0xc4, 0x01, 0xa2,
+    // Luminance DC
+    0x00,
+    0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+    // Luminance AC
+    0x10,
+    0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7d,
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+    // Chrominance DC
+    0x01,
+    0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+    // Chrominance AC
+    0x11,
+    0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77,
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+//!
+//! \brief Function checks if JPEG defines its Huffman tables.
+//! \param data Represents JPEG bytes.
+//! \param length Represents number of bytes.
+//! \return Returns offset of SOS marker where tables have to be inserted, or -1 if none are needed.
+//!
+int jpegHuffmanInsertPosition(const uchar *data, size_t length)
+{
+    if (length < 4 || data[0] != 0xff || data[1] != 0xd8)
+    {
+        return -1; // not JPEG, written as is
+    }
+
+    // Header segments are walked only up to start of scan.
+    size_t pos = 2;
+    while (pos + 4 <= length)
+    {
+        if (data[pos] != 0xff)
+        {
+            return -1;
+        }
+
+        uchar marker = data[pos + 1];
+        if (marker == 0xff)
+        {
+            ++pos; // fill byte
+            continue;
+        }
+        if (marker == 0xc4)
+        {
+            return -1;
+        }
+        if (marker == 0xda)
+        {
+            return int(pos);
+        }
+        pos += 2 + ((size_t(data[pos + 2]) << 8) | data[pos + 3]);
+    }
+    return -1;
+}
+
+//!
+//! \brief Function gives DHT segment with standard tables.
+//! \param length Represents output for segment length in bytes.
+//! \return Returns segment bytes including marker.
+//!
+const uchar *jpegStandardHuffmanTables(size_t *length)
+{
+    *length = sizeof(standardHuffmanTables);
+    return standardHuffmanTables;
+}
+
+//!
+//! \brief Function decodes camera JPEG, adding standard Huffman tables when they are missing.
+//! \param jpeg Represents continuous JPEG bytes.
+//! \return Returns BGR image or empty one on error.
+//!
+cv::Mat decodeJpeg(const cv::Mat &jpeg)
+{
+    size_t length = jpeg.total() * jpeg.elemSize();
+    int insert = jpegHuffmanInsertPosition(jpeg.data, length);
+    if (insert < 0)
+    {
+        return cv::imdecode(jpeg, CV_LOAD_IMAGE_COLOR);
+    }
+
+    size_t tablesLength = 0;
+    const uchar *tables = jpegStandardHuffmanTables(&tablesLength);
+    std::vector<uchar> complete(length + tablesLength);
+    memcpy(&complete[0], jpeg.data, size_t(insert));
+    memcpy(&complete[size_t(insert)], tables, tablesLength);
+    memcpy(&complete[size_t(insert) + tablesLength], jpeg.data + insert, length - size_t(insert));
+    return cv::imdecode(complete, CV_LOAD_IMAGE_COLOR);
+}
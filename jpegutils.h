@@ -0,0 +1,11 @@
+#ifndef JPEGUTILS_H
+#define JPEGUTILS_H
+
+#include <QtGlobal>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+
+int jpegHuffmanInsertPosition(const uchar *data, size_t length);
+const uchar *jpegStandardHuffmanTables(size_t *length);
+cv::Mat decodeJpeg(const cv::Mat &jpeg);
+
+#endif // JPEGUTILS_H
@@ -0,0 +1,132 @@
+#include "latencyhistogram.h"
+
+//!
+//! \brief Object constructor.
+//!
+LatencyHistogram::LatencyHistogram()
+{
+    this->reset();
+}
+
+//!
+//! \brief Method adds one measured duration.
+//! \param ns Represents duration in ns, negative values are counted as 0.
+//!
+void LatencyHistogram::record(qint64 ns)
+{
+    if (ns < 0)
+    {
+        ns = 0;
+    }
+
+    this->_buckets[bucketIndex(quint64(ns))].fetch_add(1, std::memory_order_relaxed);
+    this->_count.fetch_add(1, std::memory_order_relaxed);
+
+    qint64 max = this->_max.load(std::memory_order_relaxed);
+    while (ns > max && !this->_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+//!
+//! \brief Method clears all values.
+//!
+void LatencyHistogram::reset(void)
+{
+    for (int i = 0; i < BucketCount; ++i)
+    {
+        this->_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    this->_count.store(0, std::memory_order_relaxed);
+    this->_max.store(0, std::memory_order_relaxed);
+}
+
+//!
+//! \brief Getter for number of recorded values.
+//! \return Returns number of values.
+//!
+quint64 LatencyHistogram::count(void) const
+{
+    return this->_count.load(std::memory_order_relaxed);
+}
+
+//!
+//! \brief Getter for longest recorded value.
+//! \return Returns exact maximum in ns.
+//!
+qint64 LatencyHistogram::max(void) const
+{
+    return this->_max.load(std::memory_order_relaxed);
+}
+
+//!
+//! \brief Method estimates percentile.
+//! \param percent Represents percentile in range 0 - 100.
+//! \return Returns upper bound of bucket holding percentile in ns, 0 if empty.
+//!
+qint64 LatencyHistogram::percentile(double percent) const
+{
+    quint64 total = 0;
+    for (int i = 0; i < BucketCount; ++i)
+    {
+        total += this->_buckets[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    quint64 rank = quint64(double(total) * qBound(0.0, percent, 100.0) / 100.0 + 0.5);
+    rank = qBound(quint64(1), rank, total);
+
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i)
+    {
+        seen += this->_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return qMin(qint64(bucketUpperBound(i)), this->max());
+        }
+    }
+    return this->max();
+}
+
+//!
+//! \brief Method maps value to bucket.
+//! \param ns Represents value.
+//! \return Returns bucket index.
+//!
+int LatencyHistogram::bucketIndex(quint64 ns)
+{
+    if (ns < SubBuckets)
+    {
+        return int(ns);
+    }
+
+    int msb = 63;
+    while ((ns & (quint64(1) << msb)) == 0)
+    {
+        --msb;
+    }
+
+    int sub = int((ns >> (msb - SubBucketBits)) & (SubBuckets - 1));
+    return (msb - SubBucketBits + 1) * SubBuckets + sub;
+}
+
+//!
+//! \brief Method gives highest value stored in bucket.
+//! \param index Represents bucket index.
+//! \return Returns value in ns.
+//!
+quint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SubBuckets)
+    {
+        return quint64(index);
+    }
+
+    int msb = index / SubBuckets + SubBucketBits - 1;
+    quint64 sub = quint64(index % SubBuckets);
+    quint64 lower = (quint64(1) << msb) | (sub << (msb - SubBucketBits));
+    return lower + (quint64(1) << (msb - SubBucketBits)) - 1;
+}
@@ -0,0 +1,40 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+#include <atomic>
+
+//!
+//! \brief Lock-free histogram of durations in ns.
+//!
+//! Buckets are logarithmic with 8 linear sub-buckets per power of two, so
+//! reported percentiles are within 12.5% of real value. Any thread may
+//! record, snapshot is taken without stopping writers.
+//!
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    void record(qint64 ns);
+    void reset(void);
+    quint64 count(void) const;
+    qint64 max(void) const;
+    qint64 percentile(double percent) const;
+
+private:
+    static int bucketIndex(quint64 ns);
+    static quint64 bucketUpperBound(int index);
+
+private:
+    enum {
+        SubBucketBits = 3,
+        SubBuckets = 1 << SubBucketBits,
+        BucketCount = 64 * SubBuckets
+    };
+
+    std::atomic<quint64> _buckets[BucketCount];
+    std::atomic<quint64> _count;
+    std::atomic<qint64> _max;
+};
+
+#endif // LATENCYHISTOGRAM_H
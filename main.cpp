@@ -2,6 +2,9 @@
 #include <QtCore>
 #include <QCamera>
 #include "camerathread.h"
+#include "framesource.h"
+#include "rawframesink.h"
+#include "changedetector.h"
 #include "globals.h"
 
 int main(int argc, char *argv[])
@@ -28,8 +31,8 @@ int main(int argc, char *argv[])
 
     // An option with a value
     QCommandLineOption cameraIdOption(QStringList() << "c" << "camera",
-                                             QCoreApplication::translate("main", "Set camera with <id>."),
-                                             QCoreApplication::translate("main", "id"));
+                                             QCoreApplication::translate("main", "Set cameras as comma separated <sources>: id, v4l2:<device>, v4l2-mjpeg:<device> (no re-encode), file:<image dir> or video file."),
+                                             QCoreApplication::translate("main", "sources"));
     parser.addOption(cameraIdOption);
 
     // An option with a value
@@ -45,7 +48,187 @@ int main(int argc, char *argv[])
                                       QCoreApplication::translate("main", "fps"),
                                       QLatin1String("25"));
     parser.addOption(fpsOption);
-    
+
+    // An option with a value
+    QCommandLineOption queueOption(QStringList() << "queue" ,
+                                      QCoreApplication::translate("main", "Set encoder queue length as <frames>."),
+                                      QCoreApplication::translate("main", "frames"),
+                                      QLatin1String("32"));
+    parser.addOption(queueOption);
+
+    // An option with a value
+    QCommandLineOption overflowOption(QStringList() << "overflow" ,
+                                      QCoreApplication::translate("main", "Set full encoder queue policy as <policy> (block, drop-oldest, drop-newest). Block stalls trigger handling and burst capture until encoder takes a frame."),
+                                      QCoreApplication::translate("main", "policy"),
+                                      QLatin1String("block"));
+    parser.addOption(overflowOption);
+
+    // An option with a value
+    QCommandLineOption preTriggerOption(QStringList() << "pre" ,
+                                      QCoreApplication::translate("main", "Keep last <seconds> of frames and save them on event command."),
+                                      QCoreApplication::translate("main", "seconds"),
+                                      QLatin1String("0"));
+    parser.addOption(preTriggerOption);
+
+    // An option with a value
+    QCommandLineOption postTriggerOption(QStringList() << "post" ,
+                                      QCoreApplication::translate("main", "Save <seconds> of frames after event command."),
+                                      QCoreApplication::translate("main", "seconds"),
+                                      QLatin1String("0"));
+    parser.addOption(postTriggerOption);
+
+    // An option with a value
+    QCommandLineOption eventOption(QStringList() << "event" ,
+                                      QCoreApplication::translate("main", "Set UART event command as <char>."),
+                                      QCoreApplication::translate("main", "char"),
+                                      QLatin1String("e"));
+    parser.addOption(eventOption);
+
+    // A boolean option
+    QCommandLineOption compressOption(QStringList() << "compress-pre", QCoreApplication::translate("main", "Keep pre-trigger frames as JPEG to bound memory"));
+    parser.addOption(compressOption);
+
+    // An option with a value
+    QCommandLineOption statsOption(QStringList() << "stats" ,
+                                      QCoreApplication::translate("main", "Enable latency stats, printed every <seconds>."),
+                                      QCoreApplication::translate("main", "seconds"),
+                                      QLatin1String("0"));
+    parser.addOption(statsOption);
+
+    // An option with a value
+    QCommandLineOption codecOption(QStringList() << "codec" ,
+                                      QCoreApplication::translate("main", "Set output codec as four character <code>, e.g. MJPG. Asks for codec if not set."),
+                                      QCoreApplication::translate("main", "code"));
+    parser.addOption(codecOption);
+
+    // An option with a value
+    QCommandLineOption segmentFramesOption(QStringList() << "segment-frames" ,
+                                      QCoreApplication::translate("main", "Start new output file every <frames>."),
+                                      QCoreApplication::translate("main", "frames"),
+                                      QLatin1String("0"));
+    parser.addOption(segmentFramesOption);
+
+    // An option with a value
+    QCommandLineOption segmentSecondsOption(QStringList() << "segment-seconds" ,
+                                      QCoreApplication::translate("main", "Start new output file every <seconds> of capture time."),
+                                      QCoreApplication::translate("main", "seconds"),
+                                      QLatin1String("0"));
+    parser.addOption(segmentSecondsOption);
+
+    // An option with a value
+    QCommandLineOption segmentSizeOption(QStringList() << "segment-mb" ,
+                                      QCoreApplication::translate("main", "Start new output file when it reaches <megabytes>. MJPEG AVI output is split below 2 GB anyway."),
+                                      QCoreApplication::translate("main", "megabytes"),
+                                      QLatin1String("0"));
+    parser.addOption(segmentSizeOption);
+
+    // An option with a value
+    QCommandLineOption encodeThreadsOption(QStringList() << "encode-threads" ,
+                                      QCoreApplication::translate("main", "Compress MJPG frames on <threads> per camera."),
+                                      QCoreApplication::translate("main", "threads"),
+                                      QLatin1String("1"));
+    parser.addOption(encodeThreadsOption);
+
+    // An option with a value
+    QCommandLineOption writeBehindOption(QStringList() << "write-behind" ,
+                                      QCoreApplication::translate("main", "Write MJPG files behind encoder in <megabytes> blocks, directly to storage where possible."),
+                                      QCoreApplication::translate("main", "megabytes"),
+                                      QLatin1String("0"));
+    parser.addOption(writeBehindOption);
+
+    // An option with a value
+    QCommandLineOption storeProcessOption(QStringList() << "store-process" ,
+                                      QCoreApplication::translate("main", "Process stored frames by <steps> joined by '+': crop=x,y,w,h, half, gray."),
+                                      QCoreApplication::translate("main", "steps"));
+    parser.addOption(storeProcessOption);
+
+    // An option with a value
+    QCommandLineOption skipSimilarOption(QStringList() << "skip-similar" ,
+                                      QCoreApplication::translate("main", "Skip frames whose mean absolute difference from the last stored frame is below <difference> (0-255)."),
+                                      QCoreApplication::translate("main", "difference"),
+                                      QLatin1String("0"));
+    parser.addOption(skipSimilarOption);
+
+    // An option with a value
+    QCommandLineOption skipRoiOption(QStringList() << "skip-roi" ,
+                                      QCoreApplication::translate("main", "Compare only <region> x,y,width,height for --skip-similar."),
+                                      QCoreApplication::translate("main", "region"));
+    parser.addOption(skipRoiOption);
+
+    // A boolean option
+    QCommandLineOption skipMarkOption(QStringList() << "skip-mark", QCoreApplication::translate("main", "Store similar frames too, only mark them in change log"));
+    parser.addOption(skipMarkOption);
+
+    // An option with a value
+    QCommandLineOption shmOption(QStringList() << "shm" ,
+                                      QCoreApplication::translate("main", "Publish captured frames to POSIX shared memory ring <name> for local consumers."),
+                                      QCoreApplication::translate("main", "name"));
+    parser.addOption(shmOption);
+
+    // An option with a value
+    QCommandLineOption shmSlotsOption(QStringList() << "shm-slots" ,
+                                      QCoreApplication::translate("main", "Keep <count> frames in shared memory ring."),
+                                      QCoreApplication::translate("main", "count"),
+                                      QLatin1String("8"));
+    parser.addOption(shmSlotsOption);
+
+    // A boolean option
+    QCommandLineOption rawOption(QStringList() << "raw", QCoreApplication::translate("main", "Record uncompressed frames to memory-mapped .raw file, convert with RawConvert"));
+    parser.addOption(rawOption);
+
+    // A boolean option
+    QCommandLineOption headlessOption(QStringList() << "headless", QCoreApplication::translate("main", "Run without preview window"));
+    parser.addOption(headlessOption);
+
+    // A boolean option
+    QCommandLineOption serialThreadOption(QStringList() << "serial-thread", QCoreApplication::translate("main", "Read serial port on dedicated thread in raw low latency mode (Linux)"));
+    parser.addOption(serialThreadOption);
+
+    // An option with a value
+    QCommandLineOption previewFpsOption(QStringList() << "preview-fps" ,
+                                      QCoreApplication::translate("main", "Refresh preview at most <fps> times per second."),
+                                      QCoreApplication::translate("main", "fps"),
+                                      QLatin1String("10"));
+    parser.addOption(previewFpsOption);
+
+    // An option with a value
+    QCommandLineOption previewScaleOption(QStringList() << "preview-scale" ,
+                                      QCoreApplication::translate("main", "Downscale preview by <factor> (0-1]."),
+                                      QCoreApplication::translate("main", "factor"),
+                                      QLatin1String("0.5"));
+    parser.addOption(previewScaleOption);
+
+    // An option with a value
+    QCommandLineOption previewProcessOption(QStringList() << "preview-process" ,
+                                      QCoreApplication::translate("main", "Process shown frames by <steps> joined by '+': crop=x,y,w,h, half, gray."),
+                                      QCoreApplication::translate("main", "steps"));
+    parser.addOption(previewProcessOption);
+
+    // A boolean option
+    QCommandLineOption adaptiveOption(QStringList() << "adaptive", QCoreApplication::translate("main", "Lower preview rate, preview size and JPEG quality while encoders fall behind, restore them when load drops"));
+    parser.addOption(adaptiveOption);
+
+    // An option with a value
+    QCommandLineOption adaptiveQualityOption(QStringList() << "adaptive-min-quality" ,
+                                      QCoreApplication::translate("main", "Do not lower JPEG quality below <quality> (1-100)."),
+                                      QCoreApplication::translate("main", "quality"),
+                                      QLatin1String("50"));
+    parser.addOption(adaptiveQualityOption);
+
+    // An option with a value
+    QCommandLineOption adaptiveFpsOption(QStringList() << "adaptive-min-preview-fps" ,
+                                      QCoreApplication::translate("main", "Do not lower preview rate below <fps>."),
+                                      QCoreApplication::translate("main", "fps"),
+                                      QLatin1String("1"));
+    parser.addOption(adaptiveFpsOption);
+
+    // An option with a value
+    QCommandLineOption adaptiveScaleOption(QStringList() << "adaptive-min-preview-scale" ,
+                                      QCoreApplication::translate("main", "Do not downscale preview below <factor> (0-1]."),
+                                      QCoreApplication::translate("main", "factor"),
+                                      QLatin1String("0.125"));
+    parser.addOption(adaptiveScaleOption);
+
     // Process the actual command line arguments given by the user
     parser.process(a);
 
@@ -57,6 +240,15 @@ int main(int argc, char *argv[])
     QString cameraID = parser.value(cameraIdOption);
     QString fileName = parser.value(fileNameOption);
     QString fpsValue = parser.value(fpsOption);
+    QString queueValue = parser.value(queueOption);
+    QString overflowValue = parser.value(overflowOption);
+    QString preTriggerValue = parser.value(preTriggerOption);
+    QString postTriggerValue = parser.value(postTriggerOption);
+    QString eventValue = parser.value(eventOption);
+    QString statsValue = parser.value(statsOption);
+    QString codecValue = parser.value(codecOption);
+    int previewFps = parser.value(previewFpsOption).toInt();
+    double previewScale = parser.value(previewScaleOption).toDouble();
 
     quint8 status = 0;
 
@@ -77,25 +269,102 @@ int main(int argc, char *argv[])
             if (!cameraID.isEmpty())
             {
                 bool ok = false;
-                int id = cameraID.toInt(&ok);
+                int fps = fpsValue.toInt(&ok);
                 if (!ok)
                 {
-                    qWarning() << __FILE__ << __LINE__ << "Bad camera id";
+                    qWarning() << __FILE__ << __LINE__ << "Bad fps value";
                 }
 
-                int fps = fpsValue.toInt(&ok);
-                if (!ok)
+                int queueSize = queueValue.toInt(&ok);
+                if (!ok || queueSize <= 0)
                 {
-                    qWarning() << __FILE__ << __LINE__ << "Bad fps value";
+                    qWarning() << __FILE__ << __LINE__ << "Bad queue length";
+                    queueSize = 32;
+                }
+
+                EncoderThread::OverflowPolicy policy = EncoderThread::Block;
+                if (!EncoderThread::policyFromString(overflowValue, policy))
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad overflow policy";
+                }
+
+                QList<FrameSource *> sources;
+                foreach (const QString &spec, cameraID.split(',', QString::SkipEmptyParts))
+                {
+                    FrameSource *source = FrameSource::create(spec, fps);
+                    if (source == nullptr)
+                    {
+                        qWarning() << __FILE__ << __LINE__ << "Bad camera source";
+                        qDeleteAll(sources);
+                        return 1;
+                    }
+                    qDebug() << "Camera: " << source->description();
+                    sources.append(source);
                 }
 
-                qDebug() << "Camera id: " << id;
                 qDebug() << "File name: " << fileName;
                 qDebug() << "FPS : " << fps;
+                qDebug() << "Queue : " << queueSize << overflowValue;
+
+                double preSeconds = preTriggerValue.toDouble(&ok);
+                if (!ok || preSeconds < 0.0)
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad pre-trigger time";
+                    preSeconds = 0.0;
+                }
+
+                double postSeconds = postTriggerValue.toDouble(&ok);
+                if (!ok || postSeconds < 0.0)
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad post-trigger time";
+                    postSeconds = 0.0;
+                }
+
+                if (eventValue.size() != 1 || eventValue == "a" || eventValue == "q" || eventValue == "s")
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad event command";
+                    eventValue = "e";
+                }
 
                 CameraThread camera;
                 camera.readRSConfig();
-                camera.init(id, fps, fileName);
+                camera.setPreviewEnabled(!parser.isSet(headlessOption));
+                camera.setSerialThreadEnabled(parser.isSet(serialThreadOption));
+                camera.setPreviewOptions(previewFps, previewScale);
+                camera.setAdaptiveQuality(parser.isSet(adaptiveOption), parser.value(adaptiveQualityOption).toInt(),
+                                          parser.value(adaptiveFpsOption).toInt(), parser.value(adaptiveScaleOption).toDouble());
+                camera.setEncoderQueue(queueSize, policy);
+                camera.setPreTrigger(preSeconds, postSeconds, parser.isSet(compressOption), eventValue.at(0).toLatin1());
+                camera.setStats(statsValue.toInt() > 0, statsValue.toInt());
+                camera.setEncoderThreads(parser.value(encodeThreadsOption).toInt());
+                camera.setWriteBehind(parser.value(writeBehindOption).toInt());
+                camera.setProcessing(parser.value(storeProcessOption), parser.value(previewProcessOption));
+
+                cv::Rect skipRoi;
+                if (parser.isSet(skipRoiOption) && !ChangeDetector::parseRoi(parser.value(skipRoiOption), skipRoi))
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad skip region, whole frame is compared";
+                }
+                camera.setFrameSkipping(parser.value(skipSimilarOption).toDouble(), skipRoi, parser.isSet(skipMarkOption));
+                camera.setSharedMemory(parser.value(shmOption), parser.value(shmSlotsOption).toInt());
+                camera.setSegments(parser.value(segmentFramesOption).toInt(), parser.value(segmentSecondsOption).toDouble(),
+                                   parser.value(segmentSizeOption).toLongLong() * 1024 * 1024);
+                if (parser.isSet(rawOption))
+                {
+                    QFileInfo info(fileName);
+                    fileName = QDir(info.path()).filePath(info.completeBaseName() + ".raw");
+                    camera.setCodec(RawFrameSink::Fourcc);
+                }
+                else if (codecValue.size() == 4)
+                {
+                    QByteArray code = codecValue.toLatin1();
+                    camera.setCodec(CV_FOURCC(code[0], code[1], code[2], code[3]));
+                }
+                else if (!codecValue.isEmpty())
+                {
+                    qWarning() << __FILE__ << __LINE__ << "Bad codec";
+                }
+                camera.init(sources, fps, fileName);
 
                 camera.start();
                 return a.exec();
@@ -127,17 +396,27 @@ int main(int argc, char *argv[])
             if (!cameraID.isEmpty())
             {
                 qDebug() << "-- TEST RUN -- ";
-                bool ok = false;
-                int id = cameraID.toInt(&ok);
-                if (!ok)
+                QList<FrameSource *> sources;
+                foreach (const QString &spec, cameraID.split(',', QString::SkipEmptyParts))
                 {
-                    qWarning() << __FILE__ << __LINE__ << "Bad camera id";
+                    FrameSource *source = FrameSource::create(spec, fpsValue.toDouble());
+                    if (source == nullptr)
+                    {
+                        qWarning() << __FILE__ << __LINE__ << "Bad camera source";
+                        qDeleteAll(sources);
+                        return 1;
+                    }
+                    qDebug() << "Camera: " << source->description();
+                    sources.append(source);
                 }
-                qDebug() << "Camera id: " << id;
                 CameraThread camera;
-                camera.initCamera(id);
+                camera.setPreviewOptions(previewFps, previewScale);
+                camera.setProcessing(QString(), parser.value(previewProcessOption));
+                camera.setSharedMemory(parser.value(shmOption), parser.value(shmSlotsOption).toInt());
+                camera.initCamera(sources);
 
                 camera.start();
+                return a.exec();
             }
             else
             {
@@ -0,0 +1,385 @@
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+#include <opencv2/highgui/highgui.hpp>  // Image encode
+#include "mjpegavisink.h"
+#include "jpegutils.h"
+#include "monotonicclock.h"
+#include "writebehindfile.h"
+
+// Header layout, see writeHeader(). Offsets of fields patched on release.
+static const qint64 RiffSizeOffset = 4;
+static const qint64 MaxBytesPerSecOffset = 36;
+static const qint64 TotalFramesOffset = 48;
+static const qint64 SuggestedBufferOffset = 60;
+static const qint64 StreamLengthOffset = 140;
+static const qint64 StreamBufferOffset = 144;
+static const qint64 MoviSizeOffset = 216;
+
+//!
+//! \brief Function appends 32-bit little endian value.
+//! \param buffer Represents destination.
+//! \param value Represents value.
+//!
+static void appendU32(QByteArray &buffer, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    buffer.append(reinterpret_cast<const char *>(bytes), 4);
+}
+
+//!
+//! \brief Function appends 16-bit little endian value.
+//! \param buffer Represents destination.
+//! \param value Represents value.
+//!
+static void appendU16(QByteArray &buffer, quint16 value)
+{
+    uchar bytes[2];
+    qToLittleEndian(value, bytes);
+    buffer.append(reinterpret_cast<const char *>(bytes), 2);
+}
+
+//!
+//! \brief Object constructor. Opens file and writes header.
+//! \param fileName Represents video file name.
+//! \param fps Represents frame rate stored in file.
+//! \param frameSize Represents size of frames.
+//! \param quality Represents JPEG quality used for BGR frames.
+//! \param writeBehindBuffer Represents size of blocks written behind encoder in bytes, 0 writes through QFile.
+//!
+MjpegAviSink::MjpegAviSink(const QString &fileName, double fps, cv::Size frameSize, int quality, size_t writeBehindBuffer) :
+    _file(nullptr),
+    _writeBehind(nullptr),
+    _fileName(fileName),
+    _frameSize(frameSize),
+    _fps(fps > 0.0 ? fps : 25.0),
+    _moviStart(0),
+    _frames(0),
+    _maxChunk(0),
+    _full(false)
+{
+    this->_index.reserve(16 * 4096);
+    this->_jpegParams.push_back(CV_IMWRITE_JPEG_QUALITY);
+    this->_jpegParams.push_back(quality);
+
+    if (writeBehindBuffer > 0)
+    {
+        this->_writeBehind = new WriteBehindFile(fileName, writeBehindBuffer);
+        if (this->_writeBehind->open(QIODevice::WriteOnly))
+        {
+            this->_file = this->_writeBehind;
+        }
+        else
+        {
+            qWarning() << __FILE__ << __LINE__ << "Write-behind not available, buffered file used:" << fileName << this->_writeBehind->errorString();
+            delete this->_writeBehind;
+            this->_writeBehind = nullptr;
+        }
+    }
+    if (this->_file == nullptr)
+    {
+        QFile *file = new QFile(fileName);
+        file->open(QIODevice::WriteOnly | QIODevice::Truncate);
+        this->_file = file;
+    }
+
+    if (!this->_file->isOpen() || !this->writeHeader())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open the output video for write:" << fileName << this->_file->errorString();
+        this->_file->close();
+        return;
+    }
+    this->_frameIndex.open(FrameIndexFile::fileNameForVideo(fileName), true);
+}
+
+//!
+//! \brief Object destructor. Finishes file.
+//!
+MjpegAviSink::~MjpegAviSink()
+{
+    this->release();
+    delete this->_file;
+}
+
+//!
+//! \brief Method writes RIFF header with single MJPEG video stream and opens 'movi' list.
+//! \return Returns true if header was written.
+//!
+bool MjpegAviSink::writeHeader(void)
+{
+    quint32 width = quint32(this->_frameSize.width);
+    quint32 height = quint32(this->_frameSize.height);
+    quint32 rate = quint32(qRound(this->_fps * 1000.0));
+
+    QByteArray header;
+    header.append("RIFF");
+    appendU32(header, 0);                               // patched
+    header.append("AVI ");
+
+    header.append("LIST");
+    appendU32(header, 192);
+    header.append("hdrl");
+
+    header.append("avih");
+    appendU32(header, 56);
+    appendU32(header, quint32(qRound(1e6 / this->_fps)));  // us per frame
+    appendU32(header, 0);                               // max bytes per sec, patched
+    appendU32(header, 0);                               // padding granularity
+    appendU32(header, 0x10);                            // AVIF_HASINDEX
+    appendU32(header, 0);                               // total frames, patched
+    appendU32(header, 0);                               // initial frames
+    appendU32(header, 1);                               // streams
+    appendU32(header, 0);                               // suggested buffer size, patched
+    appendU32(header, width);
+    appendU32(header, height);
+    for (int i = 0; i < 4; ++i)
+    {
+        appendU32(header, 0);
+    }
+
+    header.append("LIST");
+    appendU32(header, 116);
+    header.append("strl");
+
+    header.append("strh");
+    appendU32(header, 56);
+    header.append("vids");
+    header.append("MJPG");
+    appendU32(header, 0);                               // flags
+    appendU16(header, 0);                               // priority
+    appendU16(header, 0);                               // language
+    appendU32(header, 0);                               // initial frames
+    appendU32(header, 1000);                            // scale
+    appendU32(header, rate);                            // rate, fps = rate / scale
+    appendU32(header, 0);                               // start
+    appendU32(header, 0);                               // length, patched
+    appendU32(header, 0);                               // suggested buffer size, patched
+    appendU32(header, quint32(-1));                     // quality
+    appendU32(header, 0);                               // sample size
+    appendU16(header, 0);
+    appendU16(header, 0);
+    appendU16(header, quint16(width));
+    appendU16(header, quint16(height));
+
+    header.append("strf");
+    appendU32(header, 40);
+    appendU32(header, 40);                              // BITMAPINFOHEADER size
+    appendU32(header, width);
+    appendU32(header, height);
+    appendU16(header, 1);                               // planes
+    appendU16(header, 24);                              // bit count
+    header.append("MJPG");
+    appendU32(header, width * height * 3);
+    appendU32(header, 0);
+    appendU32(header, 0);
+    appendU32(header, 0);
+    appendU32(header, 0);
+
+    header.append("LIST");
+    appendU32(header, 0);                               // patched
+    header.append("movi");
+
+    this->_moviStart = header.size() - 4;               // index offsets are relative to 'movi'
+    return this->_file->write(header) == header.size();
+}
+
+//!
+//! \brief Method writes one frame chunk and records it in both indexes.
+//! \param data Represents JPEG bytes.
+//! \param length Represents number of bytes.
+//! \param frame Represents bookkeeping data of frame.
+//! \return Returns true if chunk was written.
+//!
+bool MjpegAviSink::writeChunk(const uchar *data, size_t length, const RecordedFrame &frame)
+{
+    int insert = jpegHuffmanInsertPosition(data, length);
+    size_t tablesLength = 0;
+    const uchar *tables = jpegStandardHuffmanTables(&tablesLength);
+    quint32 chunkLength = quint32(length + (insert >= 0 ? tablesLength : 0));
+
+    qint64 position = this->_file->pos();
+    if (position + 8 + chunkLength + 1 + qint64(this->_index.size()) + 16 + 8 > MaxFileSize)
+    {
+        if (!this->_full)
+        {
+            qWarning() << __FILE__ << __LINE__ << "AVI size limit reached, next frames are dropped:" << this->_fileName;
+            this->_full = true;
+        }
+        return false;
+    }
+
+    QByteArray chunkHeader;
+    chunkHeader.append("00dc");
+    appendU32(chunkHeader, chunkLength);
+
+    bool ok = this->_file->write(chunkHeader) == chunkHeader.size();
+    if (insert >= 0)
+    {
+        ok = ok && this->_file->write(reinterpret_cast<const char *>(data), insert) == insert;
+        ok = ok && this->_file->write(reinterpret_cast<const char *>(tables), qint64(tablesLength)) == qint64(tablesLength);
+        ok = ok && this->_file->write(reinterpret_cast<const char *>(data) + insert, qint64(length) - insert) == qint64(length) - insert;
+    }
+    else
+    {
+        ok = ok && this->_file->write(reinterpret_cast<const char *>(data), qint64(length)) == qint64(length);
+    }
+    if (chunkLength & 1)
+    {
+        ok = ok && this->_file->putChar(0);              // chunks are word aligned
+    }
+
+    if (!ok)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Write failed:" << this->_file->errorString();
+        return false;
+    }
+
+    this->_index.append("00dc");
+    appendU32(this->_index, 0x10);                      // AVIIF_KEYFRAME
+    appendU32(this->_index, quint32(position - this->_moviStart));
+    appendU32(this->_index, chunkLength);
+    this->_frameIndex.append(frame, position + 8, chunkLength);
+
+    ++this->_frames;
+    this->_maxChunk = qMax(this->_maxChunk, chunkLength);
+    this->notifyStored(frame);
+    return true;
+}
+
+//!
+//! \brief Method overwrites 32-bit header field.
+//! \param position Represents field offset.
+//! \param value Represents value.
+//!
+void MjpegAviSink::patch(qint64 position, quint32 value)
+{
+    QByteArray bytes;
+    appendU32(bytes, value);
+    this->_file->seek(position);
+    this->_file->write(bytes);
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool MjpegAviSink::isOpened(void) const
+{
+    return this->_file->isOpen();
+}
+
+//!
+//! \brief Overloaded method. Frame without bookkeeping data gets no trigger number.
+//!
+bool MjpegAviSink::write(const cv::Mat &frame)
+{
+    RecordedFrame recorded;
+    recorded.image = frame;
+    recorded.captureTimestamp = monotonicNs();
+    return this->writeFrame(recorded);
+}
+
+//!
+//! \brief Overloaded method. JPEG bytes (single row) are stored as is, BGR or gray image is compressed first.
+//!
+bool MjpegAviSink::writeFrame(const RecordedFrame &frame)
+{
+    const cv::Mat &image = frame.image;
+    if (!this->_file->isOpen() || image.empty())
+    {
+        return false;
+    }
+
+    if (image.rows > 1 || image.type() != CV_8UC1)
+    {
+        cv::imencode(".jpg", image, this->_encoded, this->_jpegParams);
+        return this->writeChunk(&this->_encoded[0], this->_encoded.size(), frame);
+    }
+
+    if (!image.isContinuous())
+    {
+        qWarning() << __FILE__ << __LINE__ << "JPEG frame is not continuous";
+        return false;
+    }
+    return this->writeChunk(image.data, image.total() * image.elemSize(), frame);
+}
+
+//!
+//! \brief Overloaded method. Writes index and frame counts.
+//!
+void MjpegAviSink::release(void)
+{
+    if (!this->_file->isOpen())
+    {
+        return;
+    }
+
+    qint64 moviEnd = this->_file->pos();
+    QByteArray indexHeader;
+    indexHeader.append("idx1");
+    appendU32(indexHeader, quint32(this->_index.size()));
+    this->_file->write(indexHeader);
+    this->_file->write(this->_index);
+    qint64 fileEnd = this->_file->pos();
+
+    double seconds = this->_frames > 0 ? double(this->_frames) / this->_fps : 1.0;
+    this->patch(RiffSizeOffset, quint32(fileEnd - 8));
+    this->patch(MaxBytesPerSecOffset, quint32(double(moviEnd - this->_moviStart) / seconds));
+    this->patch(TotalFramesOffset, this->_frames);
+    this->patch(SuggestedBufferOffset, this->_maxChunk + 8);
+    this->patch(StreamLengthOffset, this->_frames);
+    this->patch(StreamBufferOffset, this->_maxChunk + 8);
+    this->patch(MoviSizeOffset, quint32(moviEnd - this->_moviStart));
+
+    this->_frameIndex.close();
+
+    qDebug() << __FILE__ << "MJPEG AVI closed:" << this->_fileName << this->_frames << "frames";
+    if (this->_writeBehind != nullptr)
+    {
+        qDebug() << __FILE__ << "waits for storage:" << this->_writeBehind->stalls();
+    }
+    this->_file->close();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString MjpegAviSink::description(void) const
+{
+    if (this->_writeBehind != nullptr)
+    {
+        return QString("mjpeg avi %1, %2").arg(this->_fileName).arg(this->_writeBehind->description());
+    }
+    return QString("mjpeg avi %1").arg(this->_fileName);
+}
+
+//!
+//! \brief Overloaded method.
+//!
+qint64 MjpegAviSink::bytesWritten(void) const
+{
+    return this->_file->isOpen() ? this->_file->pos() : 0;
+}
+
+//!
+//! \brief Overloaded method. Camera JPEG frames are stored as they are regardless of it.
+//!
+bool MjpegAviSink::setQuality(int quality)
+{
+    this->_jpegParams[1] = qBound(1, quality, 100);
+    return true;
+}
+
+//!
+//! \brief Method checks whether frames still fit under AVI size limit.
+//! \param frames Represents number of frames.
+//! \param frameBytes Represents largest JPEG size of one frame.
+//! \return Returns false if writeFrame() could refuse one of them.
+//!
+bool MjpegAviSink::hasRoom(int frames, qint64 frameBytes) const
+{
+    size_t tablesLength = 0;
+    jpegStandardHuffmanTables(&tablesLength);
+    qint64 chunk = 8 + frameBytes + qint64(tablesLength) + 1 + 16;     // chunk, padding and index entry
+    return this->bytesWritten() + frames * chunk + qint64(this->_index.size()) + 8 <= MaxFileSize;
+}
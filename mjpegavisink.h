@@ -0,0 +1,63 @@
+#ifndef MJPEGAVISINK_H
+#define MJPEGAVISINK_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <vector>
+#include "framesink.h"
+#include "frameindex.h"
+
+class WriteBehindFile;
+
+//!
+//! \brief Frame sink storing JPEG frames in MJPEG AVI without re-encoding.
+//!
+//! Camera JPEG bytes are written as '00dc' chunks; standard Huffman tables
+//! are inserted when camera omits them so any player can decode the file.
+//! Index and frame counts are written by release(). BGR and gray frames are
+//! accepted too and compressed on the way. File is kept under 2 GB (AVI 1.0 readers).
+//! With write-behind buffer file is written by WriteBehindFile in large
+//! blocks, so encoder thread does not wait for storage. Place of every
+//! frame is recorded in frame index next to the file.
+//!
+class MjpegAviSink : public FrameSink
+{
+public:
+    enum {
+        MaxFileSize = 0x7fffffff        //!< AVI 1.0 readers use signed 32-bit offsets
+    };
+
+public:
+    MjpegAviSink(const QString &fileName, double fps, cv::Size frameSize, int quality = 90, size_t writeBehindBuffer = 0);
+    ~MjpegAviSink();
+    bool isOpened(void) const;
+    bool write(const cv::Mat &frame);
+    bool writeFrame(const RecordedFrame &frame);
+    void release(void);
+    QString description(void) const;
+    qint64 bytesWritten(void) const;
+    bool setQuality(int quality);
+    bool hasRoom(int frames, qint64 frameBytes) const;
+
+private:
+    bool writeHeader(void);
+    bool writeChunk(const uchar *data, size_t length, const RecordedFrame &frame);
+    void patch(qint64 position, quint32 value);
+
+private:
+    QIODevice *_file;
+    WriteBehindFile *_writeBehind;
+    QString _fileName;
+    cv::Size _frameSize;
+    double _fps;
+    QByteArray _index;
+    FrameIndexWriter _frameIndex;
+    std::vector<uchar> _encoded;
+    std::vector<int> _jpegParams;
+    qint64 _moviStart;
+    quint32 _frames;
+    quint32 _maxChunk;
+    bool _full;
+};
+
+#endif // MJPEGAVISINK_H
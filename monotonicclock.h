@@ -0,0 +1,17 @@
+#ifndef MONOTONICCLOCK_H
+#define MONOTONICCLOCK_H
+
+#include <QtGlobal>
+#include <chrono>
+
+//!
+//! \brief Returns value of monotonic clock.
+//! \return Returns nanoseconds since unspecified starting point, never goes backwards.
+//!
+inline qint64 monotonicNs(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // MONOTONICCLOCK_H
@@ -0,0 +1,105 @@
+#include <QDebug>
+#include <QFileInfo>
+#include <opencv2/imgproc/imgproc.hpp>  // Gray to BGR conversion
+#include "opencvframesink.h"
+
+// Frames between reads of file size.
+static const quint64 SizeRefreshFrames = 16;
+
+//!
+//! \brief Object constructor. Opens video file.
+//! \param fileName Represents video file name.
+//! \param fourcc Represents codec four character code, -1 asks user to select codec.
+//! \param fps Represents frame rate stored in file.
+//! \param frameSize Represents size of frames.
+//!
+OpenCvFrameSink::OpenCvFrameSink(const QString &fileName, int fourcc, double fps, cv::Size frameSize) :
+    _writer(fileName.toStdString(), fourcc, fps, frameSize, true),
+    _fileName(fileName),
+    _fourcc(fourcc),
+    _fps(fps),
+    _frameSize(frameSize),
+    _frames(0),
+    _bytes(0)
+{
+}
+
+//!
+//! \brief Object destructor.
+//!
+OpenCvFrameSink::~OpenCvFrameSink()
+{
+    this->release();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool OpenCvFrameSink::isOpened(void) const
+{
+    return this->_writer.isOpened();
+}
+
+//!
+//! \brief Overloaded method. Writer is opened for colour, first gray frame opens it again for gray.
+//! Codec selected by user is not known, its gray frames are converted to colour.
+//!
+bool OpenCvFrameSink::write(const cv::Mat &frame)
+{
+    if (!this->_writer.isOpened())
+    {
+        return false;
+    }
+
+    const cv::Mat *image = &frame;
+    if (frame.channels() == 1)
+    {
+        if (this->_fourcc == -1)
+        {
+            cv::cvtColor(frame, this->_converted, CV_GRAY2BGR); // buffer reused after first frame
+            image = &this->_converted;
+        }
+        else if (this->_frames == 0)
+        {
+            this->_writer.open(this->_fileName.toStdString(), this->_fourcc, this->_fps, this->_frameSize, false);
+            if (!this->_writer.isOpened())
+            {
+                qWarning() << __FILE__ << __LINE__ << "Could not open the output video for gray frames:" << this->_fileName;
+                return false;
+            }
+        }
+    }
+
+    this->_writer.write(*image);
+    ++this->_frames;
+    if (this->_frames % SizeRefreshFrames == 0)
+    {
+        this->_bytes = QFileInfo(this->_fileName).size();
+    }
+    return true;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+void OpenCvFrameSink::release(void)
+{
+    this->_writer.release();
+    this->_bytes = QFileInfo(this->_fileName).size();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString OpenCvFrameSink::description(void) const
+{
+    return QString("opencv writer %1").arg(this->_fileName);
+}
+
+//!
+//! \brief Overloaded method. Writer keeps no count, so file size read from disk lags by up to SizeRefreshFrames frames.
+//!
+qint64 OpenCvFrameSink::bytesWritten(void) const
+{
+    return this->_bytes;
+}
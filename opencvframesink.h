@@ -0,0 +1,36 @@
+#ifndef OPENCVFRAMESINK_H
+#define OPENCVFRAMESINK_H
+
+#include <opencv2/highgui/highgui.hpp>  // Video write
+#include "framesink.h"
+
+//!
+//! \brief Frame sink encoding BGR or gray frames with cv::VideoWriter.
+//!
+//! Writer does not tell codec selected by user, so gray frames written with
+//! such codec are converted to BGR instead of opening file again.
+//! Writer keeps no byte count, file size is read from disk every few frames.
+//!
+class OpenCvFrameSink : public FrameSink
+{
+public:
+    OpenCvFrameSink(const QString &fileName, int fourcc, double fps, cv::Size frameSize);
+    ~OpenCvFrameSink();
+    bool isOpened(void) const;
+    bool write(const cv::Mat &frame);
+    void release(void);
+    QString description(void) const;
+    qint64 bytesWritten(void) const;
+
+private:
+    cv::VideoWriter _writer;
+    QString _fileName;
+    int _fourcc;
+    double _fps;
+    cv::Size _frameSize;
+    cv::Mat _converted;
+    quint64 _frames;
+    qint64 _bytes;
+};
+
+#endif // OPENCVFRAMESINK_H
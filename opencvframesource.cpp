@@ -0,0 +1,79 @@
+#include "opencvframesource.h"
+
+//!
+//! \brief Object constructor. Opens camera.
+//! \param cameraID Represents camera id.
+//!
+OpenCvFrameSource::OpenCvFrameSource(int cameraID) :
+    _cap(cameraID),
+    _description(QString("opencv camera %1").arg(cameraID))
+{
+}
+
+//!
+//! \brief Object constructor. Opens video file.
+//! \param fileName Represents video file or image sequence pattern.
+//!
+OpenCvFrameSource::OpenCvFrameSource(const QString &fileName) :
+    _cap(fileName.toStdString()),
+    _description(QString("opencv file %1").arg(fileName))
+{
+}
+
+//!
+//! \brief Object destructor.
+//!
+OpenCvFrameSource::~OpenCvFrameSource()
+{
+    this->release();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool OpenCvFrameSource::isOpened(void) const
+{
+    return this->_cap.isOpened();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool OpenCvFrameSource::read(cv::Mat &frame)
+{
+    return this->_cap.read(frame);
+}
+
+//!
+//! \brief Overloaded method.
+//!
+cv::Size OpenCvFrameSource::frameSize(void) const
+{
+    cv::VideoCapture &cap = const_cast<cv::VideoCapture &>(this->_cap); // get() is not const in OpenCV 2.4
+    return cv::Size((int) cap.get(CV_CAP_PROP_FRAME_WIDTH), (int) cap.get(CV_CAP_PROP_FRAME_HEIGHT));
+}
+
+//!
+//! \brief Overloaded method.
+//!
+double OpenCvFrameSource::fps(void) const
+{
+    cv::VideoCapture &cap = const_cast<cv::VideoCapture &>(this->_cap);
+    return cap.get(CV_CAP_PROP_FPS);
+}
+
+//!
+//! \brief Overloaded method.
+//!
+void OpenCvFrameSource::release(void)
+{
+    this->_cap.release();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString OpenCvFrameSource::description(void) const
+{
+    return this->_description;
+}
@@ -0,0 +1,28 @@
+#ifndef OPENCVFRAMESOURCE_H
+#define OPENCVFRAMESOURCE_H
+
+#include <opencv2/highgui/highgui.hpp>  // Video capture
+#include "framesource.h"
+
+//!
+//! \brief Frame source using cv::VideoCapture (camera id or video file).
+//!
+class OpenCvFrameSource : public FrameSource
+{
+public:
+    explicit OpenCvFrameSource(int cameraID);
+    explicit OpenCvFrameSource(const QString &fileName);
+    ~OpenCvFrameSource();
+    bool isOpened(void) const;
+    bool read(cv::Mat &frame);
+    cv::Size frameSize(void) const;
+    double fps(void) const;
+    void release(void);
+    QString description(void) const;
+
+private:
+    cv::VideoCapture _cap;
+    QString _description;
+};
+
+#endif // OPENCVFRAMESOURCE_H
@@ -0,0 +1,265 @@
+#include <QDebug>
+#include <QRunnable>
+#include <opencv2/highgui/highgui.hpp>  // Image encode
+#include "parallelmjpegsink.h"
+#include "mjpegavisink.h"
+#include "monotonicclock.h"
+
+//!
+//! \brief Job compressing one frame on worker thread.
+//!
+class EncodeJob : public QRunnable
+{
+public:
+    EncodeJob(ParallelMjpegSink *sink, int index) :
+        _sink(sink),
+        _index(index)
+    {
+    }
+
+    void run(void)
+    {
+        this->_sink->encode(this->_index);
+    }
+
+private:
+    ParallelMjpegSink *_sink;
+    int _index;
+};
+
+//!
+//! \brief Object constructor. Opens file and starts workers.
+//! \param fileName Represents video file name.
+//! \param fps Represents frame rate stored in file.
+//! \param frameSize Represents size of frames.
+//! \param threads Represents number of encoding threads.
+//! \param quality Represents JPEG quality.
+//! \param writeBehindBuffer Represents size of blocks written behind encoder in bytes, 0 writes through QFile.
+//!
+ParallelMjpegSink::ParallelMjpegSink(const QString &fileName, double fps, cv::Size frameSize, int threads, int quality,
+                                     size_t writeBehindBuffer) :
+    _sink(new MjpegAviSink(fileName, fps, frameSize, quality, writeBehindBuffer)),
+    _frameBytes(qint64(frameSize.width) * frameSize.height * 3),
+    _quality(quality),
+    _head(0),
+    _count(0),
+    _refused(false)
+{
+    threads = qMax(threads, 1);
+    this->_workers.setMaxThreadCount(threads);
+    this->_workers.setExpiryTimeout(-1); // workers stay for whole recording
+
+    size_t frameBytes = size_t(frameSize.width) * size_t(frameSize.height) * 3;
+    this->_slots.resize(2 * threads);
+    for (int i = 0; i < this->_slots.size(); ++i)
+    {
+        this->_slots[i].jpeg.reserve(frameBytes / 4);
+        this->_slots[i].jpegParams.push_back(CV_IMWRITE_JPEG_QUALITY);
+        this->_slots[i].jpegParams.push_back(quality);
+        this->_slots[i].done = true;
+    }
+}
+
+//!
+//! \brief Object destructor. Writes frames in flight and finishes file.
+//!
+ParallelMjpegSink::~ParallelMjpegSink()
+{
+    this->release();
+    delete this->_sink;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool ParallelMjpegSink::isOpened(void) const
+{
+    return this->_sink->isOpened();
+}
+
+//!
+//! \brief Overloaded method. Frame without bookkeeping data gets no trigger number.
+//!
+bool ParallelMjpegSink::write(const cv::Mat &frame)
+{
+    RecordedFrame recorded;
+    recorded.image = frame;
+    recorded.captureTimestamp = monotonicNs();
+    return this->writeFrame(recorded);
+}
+
+//!
+//! \brief Overloaded method. Hands BGR or gray frame to workers and writes frames finished meanwhile.
+//! Image is shared with worker, not copied; bookkeeping data go to file with compressed frame.
+//!
+bool ParallelMjpegSink::writeFrame(const RecordedFrame &frame)
+{
+    if (!this->_sink->isOpened() || frame.image.empty() || this->_refused)
+    {
+        return false;
+    }
+
+    // Camera JPEG needs no work, it only has to keep its place in order.
+    if (frame.image.rows == 1 && frame.image.type() == CV_8UC1)
+    {
+        this->writeAll();
+        return !this->_refused && this->_sink->writeFrame(frame);
+    }
+
+    // JPEG sizes are known only after encoding, so frames in flight are counted at raw size.
+    if (!this->_sink->hasRoom(this->_count + 1, this->_frameBytes))
+    {
+        this->writeAll();
+        if (this->_refused || !this->_sink->hasRoom(1, this->_frameBytes))
+        {
+            return false;
+        }
+    }
+
+    if (this->_count == this->_slots.size())
+    {
+        this->writeNext(true);
+    }
+
+    int index = (this->_head + this->_count) % this->_slots.size();
+    Slot &slot = this->_slots[index];
+    slot.frame = frame;
+    slot.jpegParams[1] = this->_quality;
+    slot.done = false;
+    ++this->_count;
+    this->_workers.start(new EncodeJob(this, index));
+
+    while (this->writeNext(false))
+    {
+    }
+    return true;
+}
+
+//!
+//! \brief Overloaded method. Writes frames in flight and finishes file.
+//!
+void ParallelMjpegSink::release(void)
+{
+    this->writeAll();
+    this->_workers.waitForDone();
+    this->_sink->release();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString ParallelMjpegSink::description(void) const
+{
+    return QString("%1 encoders, %2").arg(this->_workers.maxThreadCount()).arg(this->_sink->description());
+}
+
+//!
+//! \brief Overloaded method.
+//!
+qint64 ParallelMjpegSink::bytesWritten(void) const
+{
+    return this->_sink->bytesWritten();
+}
+
+//!
+//! \brief Overloaded method. Frames already handed to workers keep their quality.
+//!
+bool ParallelMjpegSink::setQuality(int quality)
+{
+    this->_quality = qBound(1, quality, 100);
+    return true;
+}
+
+//!
+//! \brief Overloaded method. Writes all frames in flight.
+//!
+void ParallelMjpegSink::flush(void)
+{
+    this->writeAll();
+}
+
+//!
+//! \brief Overloaded method. Frames are reported by file which stores them.
+//!
+void ParallelMjpegSink::setListener(Listener *listener)
+{
+    FrameSink::setListener(listener);
+    this->_sink->setListener(listener);
+}
+
+//!
+//! \brief Method compresses frame of slot. Called only from worker thread.
+//! \param index Represents slot filled by write().
+//!
+void ParallelMjpegSink::encode(int index)
+{
+    Slot &slot = this->_slots[index];
+    if (!cv::imencode(".jpg", slot.frame.image, slot.jpeg, slot.jpegParams))
+    {
+        slot.jpeg.clear();
+    }
+    slot.frame.image.release(); // pooled frame goes back before file write
+
+    QMutexLocker locker(&this->_mutex);
+    slot.done = true;
+    this->_encoded.wakeAll();
+}
+
+//!
+//! \brief Method writes the oldest frame in flight.
+//! \param wait Represents true value to wait until frame is encoded.
+//! \return Returns false if nothing was written.
+//!
+bool ParallelMjpegSink::writeNext(bool wait)
+{
+    if (this->_count == 0)
+    {
+        return false;
+    }
+
+    Slot &slot = this->_slots[this->_head];
+    {
+        QMutexLocker locker(&this->_mutex);
+        if (!slot.done && !wait)
+        {
+            return false;
+        }
+        while (!slot.done)
+        {
+            this->_encoded.wait(&this->_mutex);
+        }
+    }
+
+    // Finished slot is not touched by workers until it is handed out again.
+    if (slot.jpeg.empty())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Frame not encoded";
+        this->notifyLost(slot.frame);
+    }
+    else
+    {
+        slot.frame.image = cv::Mat(1, int(slot.jpeg.size()), CV_8UC1, &slot.jpeg[0]);
+        if (!this->_sink->writeFrame(slot.frame))
+        {
+            // Caller was already told frame is accepted; next frames are refused so it can start next file.
+            qWarning() << __FILE__ << __LINE__ << "Encoded frame refused by file, dropped:" << slot.frame.trigger;
+            this->notifyLost(slot.frame);
+            this->_refused = true;
+        }
+        slot.frame.image.release();
+    }
+
+    this->_head = (this->_head + 1) % this->_slots.size();
+    --this->_count;
+    return true;
+}
+
+//!
+//! \brief Method writes all frames in flight in order.
+//!
+void ParallelMjpegSink::writeAll(void)
+{
+    while (this->writeNext(true))
+    {
+    }
+}
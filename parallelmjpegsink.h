@@ -0,0 +1,64 @@
+#ifndef PARALLELMJPEGSINK_H
+#define PARALLELMJPEGSINK_H
+
+#include <QMutex>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <vector>
+#include "framesink.h"
+
+class MjpegAviSink;
+
+//!
+//! \brief Frame sink compressing BGR or gray frames to JPEG on several threads.
+//!
+//! MJPEG frames are independent, so every frame is encoded by worker pool
+//! and results are written to MjpegAviSink in order of arrival by the
+//! calling thread. At most two frames per worker are in flight, further
+//! write() waits for the oldest one, so frames are reported stored after
+//! writeFrame() returned. Frame is refused while frames in
+//! flight could reach AVI size limit, so caller can start next file.
+//!
+class ParallelMjpegSink : public FrameSink
+{
+public:
+    ParallelMjpegSink(const QString &fileName, double fps, cv::Size frameSize, int threads, int quality = 90, size_t writeBehindBuffer = 0);
+    ~ParallelMjpegSink();
+    bool isOpened(void) const;
+    bool write(const cv::Mat &frame);
+    bool writeFrame(const RecordedFrame &frame);
+    void release(void);
+    QString description(void) const;
+    qint64 bytesWritten(void) const;
+    bool setQuality(int quality);
+    void flush(void);
+    void setListener(Listener *listener);
+    void encode(int index);
+
+private:
+    struct Slot {
+        RecordedFrame frame;
+        std::vector<uchar> jpeg;
+        std::vector<int> jpegParams;
+        bool done;
+    };
+
+private:
+    bool writeNext(bool wait);
+    void writeAll(void);
+
+private:
+    MjpegAviSink *_sink;
+    QThreadPool _workers;
+    QVector<Slot> _slots;
+    QMutex _mutex;
+    QWaitCondition _encoded;
+    qint64 _frameBytes;
+    int _quality;
+    int _head;
+    int _count;
+    bool _refused;
+};
+
+#endif // PARALLELMJPEGSINK_H
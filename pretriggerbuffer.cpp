@@ -0,0 +1,319 @@
+#include <QDebug>
+#include <QThread>
+#include <opencv2/highgui/highgui.hpp>  // Image encode
+#include "pretriggerbuffer.h"
+
+//!
+//! \brief Number of captured frames which may wait for compression.
+//!
+static const int StagedFrames = 4;
+
+//!
+//! \brief Thread compressing staged frames of pre-trigger buffer.
+//!
+class PreTriggerCompressor : public QThread
+{
+public:
+    explicit PreTriggerCompressor(PreTriggerBuffer *buffer) :
+        _buffer(buffer)
+    {
+    }
+
+protected:
+    void run(void)
+    {
+        this->_buffer->compress();
+    }
+
+private:
+    PreTriggerBuffer *_buffer;
+};
+
+//!
+//! \brief Object constructor. Preallocates all slots.
+//! \param frameSize Represents size of captured frames.
+//! \param preFrames Represents number of frames kept from before trigger.
+//! \param postFrames Represents number of frames recorded after trigger.
+//! \param compressed Represents true value to keep frames as JPEG to bound memory.
+//! \param quality Represents JPEG quality used when compressed.
+//! \param encodedInput Represents true value when pushed frames are already JPEG bytes.
+//!
+PreTriggerBuffer::PreTriggerBuffer(cv::Size frameSize, int preFrames, int postFrames, bool compressed, int quality,
+                                   bool encodedInput) :
+    _preFrames(qMax(preFrames, 1)),
+    _postFrames(qMax(postFrames, 0)),
+    _compressed(compressed || encodedInput),
+    _encodedInput(encodedInput),
+    _head(0),
+    _count(0),
+    _postRemaining(0),
+    _trigger(0),
+    _receiveTimestamp(0),
+    _state(Armed),
+    _stageHead(0),
+    _stageTail(0),
+    _stagedCount(0),
+    _droppedFrames(0),
+    _stopping(false),
+    _compressor(nullptr)
+{
+    this->_slots.resize(this->_preFrames + this->_postFrames);
+    size_t frameBytes = size_t(frameSize.width) * size_t(frameSize.height) * 3;
+    for (int i = 0; i < this->_slots.size(); ++i)
+    {
+        if (this->_compressed)
+        {
+            // Typical JPEG size, slot of rare larger frame grows once and keeps its capacity.
+            this->_slots[i].jpeg.reserve(frameBytes / 4);
+        }
+        else
+        {
+            this->_slots[i].image.create(frameSize, CV_8UC3);
+        }
+        this->_slots[i].timestamp = 0;
+    }
+
+    this->_jpegParams.push_back(CV_IMWRITE_JPEG_QUALITY);
+    this->_jpegParams.push_back(quality);
+
+    if (this->_compressed && !this->_encodedInput)
+    {
+        this->_staged.resize(StagedFrames);
+        for (int i = 0; i < this->_staged.size(); ++i)
+        {
+            this->_staged[i].image.create(frameSize, CV_8UC3);
+            this->_staged[i].slot = 0;
+        }
+        this->_compressor = new PreTriggerCompressor(this);
+        this->_compressor->setObjectName("pre-trigger compress");
+        this->_compressor->start();
+    }
+
+    qDebug() << __FILE__ << "pre-trigger buffer:" << this->_preFrames << "+" << this->_postFrames
+             << "frames" << (this->_encodedInput ? "camera JPEG" : (this->_compressed ? "compressed" : "raw"));
+}
+
+//!
+//! \brief Object destructor. Stops compressor thread.
+//!
+PreTriggerBuffer::~PreTriggerBuffer()
+{
+    if (this->_compressor != nullptr)
+    {
+        this->_stopping = true;
+        this->_stagedWaiter.wake();
+        this->_compressor->wait();
+        delete this->_compressor;
+    }
+}
+
+//!
+//! \brief Method stores captured frame. Called only from capture thread.
+//! \param frame Represents captured frame.
+//! \param timestamp Represents monotonic capture time in ns.
+//! \return Returns true when this call completed post-trigger window.
+//!
+bool PreTriggerBuffer::push(const cv::Mat &frame, qint64 timestamp)
+{
+    int state = this->_state.load(std::memory_order_acquire);
+    if (state == Full)
+    {
+        return false;
+    }
+
+    if (state == PostTrigger && this->_postRemaining == 0)
+    {
+        this->_state.store(Full, std::memory_order_release);
+        return true;
+    }
+
+    Slot &slot = this->_slots[this->_head];
+    if (this->_encodedInput)
+    {
+        slot.jpeg.assign(frame.data, frame.data + frame.total() * frame.elemSize()); // reuses reserved capacity
+    }
+    else if (this->_compressed)
+    {
+        if (this->_stagedCount.load(std::memory_order_acquire) == this->_staged.size())
+        {
+            // Compressor is behind, capture must not wait for it.
+            ++this->_droppedFrames;
+            return false;
+        }
+
+        Staged &staged = this->_staged[this->_stageHead];
+        frame.copyTo(staged.image); // same size and type, no allocation
+        staged.slot = this->_head;
+        this->_stageHead = (this->_stageHead + 1) % this->_staged.size();
+        this->_stagedCount.fetch_add(1, std::memory_order_release);
+        this->_stagedWaiter.wake();
+    }
+    else
+    {
+        frame.copyTo(slot.image); // same size and type, no allocation
+    }
+    slot.timestamp = timestamp;
+
+    this->_head = (this->_head + 1) % this->_slots.size();
+    this->_count = qMin(this->_count + 1, this->_slots.size());
+
+    if (state == PostTrigger)
+    {
+        if (--this->_postRemaining == 0)
+        {
+            this->_state.store(Full, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+//!
+//! \brief Method starts post-trigger part of window.
+//! \param trigger Represents trigger number assigned to window frames.
+//! \param receiveTimestamp Represents monotonic time in ns when command was read.
+//! \return Returns false if previous window is not written yet.
+//!
+bool PreTriggerBuffer::trigger(quint64 trigger, qint64 receiveTimestamp)
+{
+    if (this->_state.load(std::memory_order_acquire) != Armed)
+    {
+        return false;
+    }
+
+    this->_trigger = trigger;
+    this->_receiveTimestamp = receiveTimestamp;
+    this->_postRemaining = this->_postFrames;
+
+    int expected = Armed;
+    return this->_state.compare_exchange_strong(expected, PostTrigger, std::memory_order_acq_rel);
+}
+
+//!
+//! \brief Getter for full state.
+//! \return Returns true if window is complete and waits for encoder.
+//!
+bool PreTriggerBuffer::isFull(void) const
+{
+    return this->_state.load(std::memory_order_acquire) == Full;
+}
+
+//!
+//! \brief Getter for number of frames in complete window.
+//! \return Returns number of pre and post-trigger frames available.
+//!
+int PreTriggerBuffer::frameCount(void) const
+{
+    // Ring holds pre + post frames, post-trigger frames overwrote only the oldest ones.
+    return this->_count;
+}
+
+//!
+//! \brief Method gives frame of complete window. Called only from encoder thread after waitForFrames().
+//! \param index Represents position in window, 0 is the oldest frame.
+//! \param frame Represents output; raw image and camera JPEG share slot memory, compressed one is decoded.
+//! \return Returns false if index is out of range.
+//!
+bool PreTriggerBuffer::frame(int index, RecordedFrame &frame)
+{
+    int count = this->frameCount();
+    if (index < 0 || index >= count)
+    {
+        return false;
+    }
+
+    int size = this->_slots.size();
+    Slot &slot = this->_slots[(this->_head - count + index + size) % size];
+    if (this->_encodedInput)
+    {
+        frame.image = cv::Mat(1, int(slot.jpeg.size()), CV_8UC1, slot.jpeg.data());
+    }
+    else if (this->_compressed)
+    {
+        frame.image = cv::imdecode(cv::Mat(slot.jpeg), CV_LOAD_IMAGE_COLOR);
+    }
+    else
+    {
+        frame.image = slot.image;
+    }
+    frame.trigger = this->_trigger;
+    frame.receiveTimestamp = this->_receiveTimestamp;
+    frame.captureTimestamp = slot.timestamp;
+    return !frame.image.empty();
+}
+
+//!
+//! \brief Method waits until compressor has stored all frames of complete window. Called only from encoder thread.
+//!
+void PreTriggerBuffer::waitForFrames(void)
+{
+    while (this->_stagedCount.load(std::memory_order_acquire) > 0)
+    {
+        this->_drainedWaiter.wait([this]() { return this->_stagedCount.load(std::memory_order_relaxed) == 0; }, 100);
+    }
+}
+
+//!
+//! \brief Method starts collecting frames again after window was written.
+//!
+void PreTriggerBuffer::rearm(void)
+{
+    this->_count = 0;
+    this->_head = 0;
+    this->_state.store(Armed, std::memory_order_release);
+}
+
+//!
+//! \brief Getter for pre-trigger window length.
+//! \return Returns number of frames kept before trigger.
+//!
+int PreTriggerBuffer::preFrames(void) const
+{
+    return this->_preFrames;
+}
+
+//!
+//! \brief Getter for post-trigger window length.
+//! \return Returns number of frames recorded after trigger.
+//!
+int PreTriggerBuffer::postFrames(void) const
+{
+    return this->_postFrames;
+}
+
+//!
+//! \brief Getter for frames dropped while compressor was behind.
+//! \return Returns number of frames since buffer was created.
+//!
+quint64 PreTriggerBuffer::droppedFrames(void) const
+{
+    return this->_droppedFrames.load();
+}
+
+//!
+//! \brief Compressor loop. Encodes staged frames into their slots in order. Called only from compressor thread.
+//!
+void PreTriggerBuffer::compress(void)
+{
+    while (!this->_stopping.load())
+    {
+        if (this->_stagedCount.load(std::memory_order_acquire) == 0)
+        {
+            this->_stagedWaiter.wait([this]() {
+                return this->_stagedCount.load(std::memory_order_relaxed) > 0 || this->_stopping.load();
+            }, 100);
+            continue;
+        }
+
+        // Only this thread writes JPEG slots, so slot staged twice is still written in order.
+        Staged &staged = this->_staged[this->_stageTail];
+        Slot &slot = this->_slots[staged.slot];
+        if (!cv::imencode(".jpg", staged.image, slot.jpeg, this->_jpegParams))
+        {
+            slot.jpeg.clear();
+        }
+        this->_stageTail = (this->_stageTail + 1) % this->_staged.size();
+        this->_stagedCount.fetch_sub(1, std::memory_order_release);
+        this->_drainedWaiter.wake();
+    }
+}
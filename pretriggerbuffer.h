@@ -0,0 +1,90 @@
+#ifndef PRETRIGGERBUFFER_H
+#define PRETRIGGERBUFFER_H
+
+#include <QVector>
+#include <atomic>
+#include <vector>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "recordedframe.h"
+#include "idlewaiter.h"
+
+class QThread;
+
+//!
+//! \brief Ring of last captured frames used for pre-trigger recording.
+//!
+//! Capture thread pushes every frame while buffer is armed. After trigger it
+//! pushes post-trigger frames and then marks buffer full; from that moment
+//! encoder thread owns the slots until it calls rearm(). All slots are
+//! allocated in constructor, push only copies into them. When frames are
+//! kept compressed, push copies frame into one of few preallocated staging
+//! images and compressor thread encodes it into its slot, so capture thread
+//! never waits for JPEG encoder. Frame is dropped when all staging images
+//! are still waiting. JPEG frames of compressed source are kept as they are.
+//!
+class PreTriggerBuffer
+{
+public:
+    enum State {
+        Armed,
+        PostTrigger,
+        Full
+    };
+
+public:
+    PreTriggerBuffer(cv::Size frameSize, int preFrames, int postFrames, bool compressed = false, int quality = 90,
+                     bool encodedInput = false);
+    ~PreTriggerBuffer();
+    bool push(const cv::Mat &frame, qint64 timestamp);
+    bool trigger(quint64 trigger, qint64 receiveTimestamp);
+    bool isFull(void) const;
+    int frameCount(void) const;
+    bool frame(int index, RecordedFrame &frame);
+    void waitForFrames(void);
+    void rearm(void);
+    int preFrames(void) const;
+    int postFrames(void) const;
+    quint64 droppedFrames(void) const;
+    void compress(void);
+
+private:
+    struct Slot {
+        cv::Mat image;
+        std::vector<uchar> jpeg;
+        qint64 timestamp;
+    };
+
+    struct Staged {
+        cv::Mat image;
+        int slot;
+    };
+
+private:
+    PreTriggerBuffer(const PreTriggerBuffer &);
+    PreTriggerBuffer &operator=(const PreTriggerBuffer &);
+
+private:
+    QVector<Slot> _slots;
+    QVector<Staged> _staged;
+    std::vector<int> _jpegParams;
+    int _preFrames;
+    int _postFrames;
+    bool _compressed;
+    bool _encodedInput;
+    int _head;
+    int _count;
+    int _postRemaining;
+    quint64 _trigger;
+    qint64 _receiveTimestamp;
+    std::atomic<int> _state;
+    int _stageHead;                     //!< used by capture thread
+    int _stageTail;                     //!< used by compressor thread
+    std::atomic<int> _stagedCount;
+    std::atomic<quint64> _droppedFrames;
+    std::atomic<bool> _stopping;
+    IdleWaiter _stagedWaiter;
+    IdleWaiter _drainedWaiter;
+    QThread *_compressor;
+};
+
+#endif // PRETRIGGERBUFFER_H
@@ -0,0 +1,237 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <opencv2/highgui/highgui.hpp>  // Window
+#include <opencv2/imgproc/imgproc.hpp>  // Resize
+#include "previewthread.h"
+#include "capturethread.h"
+#include "jpegutils.h"
+#include "monotonicclock.h"
+#include "recorderstats.h"
+
+//!
+//! \brief Object constructor.
+//! \param fps Represents maximal display rate.
+//! \param scale Represents size factor applied before rendering, 1 keeps full size.
+//! \param parent Represents parent of object.
+//!
+PreviewThread::PreviewThread(int fps, double scale, QObject *parent) :
+    QThread(parent),
+    _stats(nullptr),
+    _fps(qMax(fps, 1)),
+    _scale(scale > 0.0 && scale <= 1.0 ? scale : 1.0),
+    _follow(false)
+{
+}
+
+//!
+//! \brief Object destructor. Stops thread.
+//!
+PreviewThread::~PreviewThread()
+{
+    this->stop();
+}
+
+//!
+//! \brief Method registers camera window. Has to be called before start.
+//! \param capture Represents capture thread of camera, used in follow mode.
+//! \param windowName Represents name of preview window.
+//! \param compressed Represents true value when frames are camera JPEG bytes.
+//! \return Returns channel number used by post().
+//!
+int PreviewThread::addChannel(CaptureThread *capture, const QString &windowName, bool compressed)
+{
+    Channel channel;
+    channel.capture = capture;
+    channel.windowName = windowName;
+    channel.compressed = compressed;
+    channel.pending = false;
+    channel.processor.parse(this->_process);
+    this->_channels.append(channel);
+    return this->_channels.size() - 1;
+}
+
+//!
+//! \brief Setter for follow mode. Has to be called before start.
+//! \param follow Represents true value to show newest captured frames instead of posted ones.
+//!
+void PreviewThread::setFollowCapture(bool follow)
+{
+    this->_follow = follow;
+}
+
+//!
+//! \brief Setter for instrumentation. Has to be called before start.
+//! \param stats Represents stats owned by caller, nullptr disables measurements.
+//!
+void PreviewThread::setStats(RecorderStats *stats)
+{
+    this->_stats = stats;
+}
+
+//!
+//! \brief Setter for CPU affinity and scheduling policy. Has to be called before start.
+//! \param schedule Represents schedule applied when thread starts, empty keeps inherited one.
+//!
+void PreviewThread::setSchedule(const ThreadSchedule &schedule)
+{
+    this->_schedule = schedule;
+}
+
+//!
+//! \brief Setter for processing of shown frames. Has to be called before addChannel().
+//! \param spec Represents FrameProcessor steps, e.g. "crop=0,0,640,480+gray"; empty shows frames as captured.
+//! \return Returns false if steps are not valid, frames are shown unprocessed then.
+//!
+bool PreviewThread::setProcess(const QString &spec)
+{
+    FrameProcessor processor;
+    this->_process = processor.parse(spec) ? spec : QString();
+    return this->_process == spec;
+}
+
+//!
+//! \brief Setter for display rate and size. May be called while preview runs.
+//! \param fps Represents maximal display rate.
+//! \param scale Represents size factor applied before rendering, 1 keeps full size.
+//!
+void PreviewThread::setRate(int fps, double scale)
+{
+    this->_fps = qMax(fps, 1);
+    this->_scale = scale > 0.0 && scale <= 1.0 ? scale : 1.0;
+}
+
+//!
+//! \brief Method puts frame into camera mailbox. Called from trigger path, never blocks on rendering.
+//! \param channel Represents channel number returned by addChannel().
+//! \param frame Represents frame; it is shared, not copied, so it must not be modified afterwards.
+//!
+void PreviewThread::post(int channel, const cv::Mat &frame)
+{
+    QMutexLocker locker(&this->_mutex);
+    this->_channels[channel].mailbox = frame;
+    this->_channels[channel].pending = true;
+}
+
+//!
+//! \brief Method stops preview loop and waits for thread end.
+//!
+void PreviewThread::stop(void)
+{
+    if (this->isRunning())
+    {
+        this->requestInterruption();
+        {
+            QMutexLocker locker(&this->_mutex);
+            this->_posted.wakeOne();
+        }
+        this->wait();
+    }
+}
+
+//!
+//! \brief Method decodes, processes, downscales and renders frame of camera.
+//! \param channel Represents camera with frame to show.
+//!
+void PreviewThread::show(Channel &channel)
+{
+    qint64 start = this->_stats != nullptr ? monotonicNs() : 0;
+
+    const cv::Mat *image = &channel.frame;
+    if (channel.compressed)
+    {
+        channel.decoded = decodeJpeg(channel.frame);
+        image = &channel.decoded;
+    }
+    if (image->empty())
+    {
+        return;
+    }
+
+    if (!channel.processor.isEmpty() && channel.processor.process(*image, channel.processed))
+    {
+        image = &channel.processed;
+    }
+
+    double scale = this->_scale.load();
+    if (scale < 1.0)
+    {
+        cv::resize(*image, channel.scaled, cv::Size(), scale, scale, CV_INTER_NN);
+        image = &channel.scaled;
+    }
+    cv::imshow(channel.windowName.toStdString(), *image);
+
+    if (this->_stats != nullptr)
+    {
+        this->_stats->record(RecorderStats::DisplayStage, monotonicNs() - start);
+    }
+}
+
+//!
+//! \brief Preview loop. Shows newest frames at most at display rate.
+//!
+void PreviewThread::run(void)
+{
+    qDebug() << "preview thread:" << this->_schedule.apply();
+    qint64 nextFrame = monotonicNs();
+    while (!this->isInterruptionRequested())
+    {
+        if (this->_follow)
+        {
+            for (int i = 0; i < this->_channels.size(); ++i)
+            {
+                if (this->_channels[i].capture->latestFrame(this->_channels[i].frame))
+                {
+                    this->show(this->_channels[i]);
+                }
+            }
+        }
+        else
+        {
+            {
+                // Mailbox frame is only referenced, swap keeps lock time constant.
+                QMutexLocker locker(&this->_mutex);
+                for (int i = 0; i < this->_channels.size(); ++i)
+                {
+                    if (this->_channels[i].pending)
+                    {
+                        cv::swap(this->_channels[i].frame, this->_channels[i].mailbox);
+                        this->_channels[i].mailbox.release();
+                        this->_channels[i].pending = false;
+                    }
+                }
+            }
+
+            for (int i = 0; i < this->_channels.size(); ++i)
+            {
+                if (!this->_channels[i].frame.empty())
+                {
+                    this->show(this->_channels[i]);
+                    this->_channels[i].frame.release(); // recorded frame is not held longer than needed
+                }
+            }
+        }
+
+        // Window events are handled by thread which owns windows.
+        int key = cv::waitKey(1);
+        if (key >= 0)
+        {
+            emit keyPressed(key);
+        }
+
+        nextFrame += qint64(1e9 / this->_fps.load());
+        qint64 now = monotonicNs();
+        if (nextFrame < now)
+        {
+            nextFrame = now; // rendering overrun, do not try to catch up
+            continue;
+        }
+
+        QMutexLocker locker(&this->_mutex);
+        while (!this->isInterruptionRequested() && (nextFrame - now) > 1000000)
+        {
+            // Sleep until next display slot; posts only wake thread to check stop request.
+            this->_posted.wait(&this->_mutex, (unsigned long)((nextFrame - now) / 1000000));
+            now = monotonicNs();
+        }
+    }
+}
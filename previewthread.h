@@ -0,0 +1,76 @@
+#ifndef PREVIEWTHREAD_H
+#define PREVIEWTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QString>
+#include <atomic>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "frameprocessor.h"
+#include "threadschedule.h"
+
+class CaptureThread;
+class RecorderStats;
+
+//!
+//! \brief Preview window renderer running apart from recording path.
+//!
+//! Every camera has single-slot mailbox: post() only replaces its frame,
+//! older frame which was not shown yet is dropped. Thread shows newest
+//! frames at display rate, downscaled, and pumps HighGUI events. In follow
+//! mode it takes newest captured frames itself, nothing has to be posted.
+//! Optional processing chain runs on this thread before downscale.
+//!
+class PreviewThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit PreviewThread(int fps = 10, double scale = 0.5, QObject *parent = 0);
+    ~PreviewThread();
+    int addChannel(CaptureThread *capture, const QString &windowName, bool compressed);
+    void setFollowCapture(bool follow);
+    void setStats(RecorderStats *stats);
+    void setSchedule(const ThreadSchedule &schedule);
+    bool setProcess(const QString &spec);
+    void setRate(int fps, double scale);
+    void post(int channel, const cv::Mat &frame);
+    void stop(void);
+
+signals:
+    void keyPressed(int key);
+
+protected:
+    void run(void);
+
+private:
+    struct Channel {
+        CaptureThread *capture;
+        QString windowName;
+        bool compressed;
+        cv::Mat mailbox;
+        bool pending;
+        cv::Mat frame;
+        cv::Mat decoded;
+        FrameProcessor processor;
+        cv::Mat processed;
+        cv::Mat scaled;
+    };
+
+private:
+    void show(Channel &channel);
+
+private:
+    QVector<Channel> _channels;
+    QMutex _mutex;
+    QWaitCondition _posted;
+    RecorderStats *_stats;
+    ThreadSchedule _schedule;
+    QString _process;
+    std::atomic<int> _fps;
+    std::atomic<double> _scale;
+    bool _follow;
+};
+
+#endif // PREVIEWTHREAD_H
@@ -0,0 +1,205 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <cstdio>
+#include "qualitycontroller.h"
+#include "monotonicclock.h"
+
+// Load above any of these is pressure, below all of them relief; the gap keeps level stable.
+static const double PressureFill = 0.5;
+static const double PressureBusy = 0.9;
+static const double ReliefFill = 0.1;
+static const double ReliefBusy = 0.6;
+static const int QualityStep = 10;
+
+//!
+//! \brief Object constructor. Starts at nominal level.
+//! \param nominal Represents configured settings, never exceeded.
+//! \param minimum Represents lowest settings, values above nominal are clamped to it.
+//! \param pressureSamples Represents number of loaded samples in a row lowering one step.
+//! \param reliefSamples Represents number of calm samples in a row restoring one step.
+//!
+QualityController::QualityController(const Level &nominal, const Level &minimum, int pressureSamples, int reliefSamples) :
+    _nominal(nominal),
+    _minimum(minimum),
+    _level(nominal),
+    _pressureSamples(qMax(pressureSamples, 1)),
+    _reliefSamples(qMax(reliefSamples, 1)),
+    _pressure(0),
+    _relief(0)
+{
+    this->_minimum.quality = qMin(this->_minimum.quality, this->_nominal.quality);
+    this->_minimum.previewFps = qMin(this->_minimum.previewFps, this->_nominal.previewFps);
+    this->_minimum.previewScale = qMin(this->_minimum.previewScale, this->_nominal.previewScale);
+}
+
+//!
+//! \brief Method creates change log and writes header line.
+//! \param fileName Represents path of csv file.
+//! \return Returns true if file was opened.
+//!
+bool QualityController::openLog(const QString &fileName)
+{
+    this->_file.setFileName(fileName);
+    if (!this->_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open quality log:" << fileName << this->_file.errorString();
+        return false;
+    }
+
+    this->_file.write("trigger,time_ns,change,quality,preview_fps,preview_scale,queue_fill,encoder_busy,dropped\n");
+    return true;
+}
+
+//!
+//! \brief Method evaluates one load sample and changes level when needed.
+//! \param load Represents encoder load since previous sample.
+//! \param trigger Represents number of triggers received so far, logged with change.
+//! \return Returns Lowered or Restored when level() changed.
+//!
+QualityController::Change QualityController::update(const Load &load, quint64 trigger)
+{
+    bool pressure = load.dropped > 0 || load.fill >= PressureFill || load.busy >= PressureBusy;
+    bool relief = load.dropped == 0 && load.fill <= ReliefFill && load.busy <= ReliefBusy;
+
+    this->_pressure = pressure ? this->_pressure + 1 : 0;
+    this->_relief = relief ? this->_relief + 1 : 0;
+
+    // Dropped frames are already lost, they do not wait for more samples.
+    if (pressure && (this->_pressure >= this->_pressureSamples || load.dropped > 0))
+    {
+        this->_pressure = 0;
+        if (this->lower())
+        {
+            this->log("lowered", load, trigger);
+            return Lowered;
+        }
+    }
+    else if (relief && this->_relief >= this->_reliefSamples)
+    {
+        this->_relief = 0;
+        if (this->restore())
+        {
+            this->log("restored", load, trigger);
+            return Restored;
+        }
+    }
+    return Unchanged;
+}
+
+//!
+//! \brief Getter for current settings.
+//! \return Returns level applied after the last change.
+//!
+const QualityController::Level &QualityController::level(void) const
+{
+    return this->_level;
+}
+
+//!
+//! \brief Method describes bounds for logs.
+//! \return Returns nominal and minimal level.
+//!
+QString QualityController::description(void) const
+{
+    return QString("%1 down to %2").arg(levelName(this->_nominal)).arg(levelName(this->_minimum));
+}
+
+//!
+//! \brief Method describes level for logs.
+//! \param level Represents settings.
+//! \return Returns quality and preview settings.
+//!
+QString QualityController::levelName(const Level &level)
+{
+    return QString("quality %1, preview %2 fps at %3").arg(level.quality > 0 ? QString::number(level.quality) : QString("fixed"))
+            .arg(level.previewFps).arg(level.previewScale);
+}
+
+//!
+//! \brief Method builds log name for video.
+//! \param videoName Represents video file name.
+//! \return Returns "<name>_quality.csv" in video directory.
+//!
+QString QualityController::fileNameForVideo(const QString &videoName)
+{
+    QFileInfo info(videoName);
+    return QDir(info.path()).filePath(info.completeBaseName() + "_quality.csv");
+}
+
+//!
+//! \brief Method lowers one step, preview goes first so stored frames keep quality longest.
+//! \return Returns false if everything is at minimum.
+//!
+bool QualityController::lower(void)
+{
+    if (this->_level.previewFps > this->_minimum.previewFps)
+    {
+        this->_level.previewFps = qMax(this->_level.previewFps / 2, this->_minimum.previewFps);
+    }
+    else if (this->_level.previewScale > this->_minimum.previewScale)
+    {
+        this->_level.previewScale = qMax(this->_level.previewScale / 2.0, this->_minimum.previewScale);
+    }
+    else if (this->_level.quality > this->_minimum.quality)
+    {
+        this->_level.quality = qMax(this->_level.quality - QualityStep, this->_minimum.quality);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Method restores one step in reverse order of lower().
+//! \return Returns false if everything is at nominal level.
+//!
+bool QualityController::restore(void)
+{
+    if (this->_level.quality < this->_nominal.quality)
+    {
+        this->_level.quality = qMin(this->_level.quality + QualityStep, this->_nominal.quality);
+    }
+    else if (this->_level.previewScale < this->_nominal.previewScale)
+    {
+        this->_level.previewScale = qMin(this->_level.previewScale * 2.0, this->_nominal.previewScale);
+    }
+    else if (this->_level.previewFps < this->_nominal.previewFps)
+    {
+        this->_level.previewFps = qMin(this->_level.previewFps * 2, this->_nominal.previewFps);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Method reports change and appends it to log.
+//! \param change Represents change name.
+//! \param load Represents sample which caused change.
+//! \param trigger Represents number of triggers received so far.
+//!
+void QualityController::log(const char *change, const Load &load, quint64 trigger)
+{
+    qDebug() << __FILE__ << "quality" << change << "at trigger:" << trigger << levelName(this->_level)
+             << "queue fill:" << load.fill << "encoder busy:" << load.busy << "dropped:" << load.dropped;
+
+    if (!this->_file.isOpen())
+    {
+        return;
+    }
+
+    char line[160];
+    int length = snprintf(line, sizeof(line), "%llu,%lld,%s,%d,%d,%.4f,%.3f,%.3f,%llu\n",
+                          static_cast<unsigned long long>(trigger), static_cast<long long>(monotonicNs()), change,
+                          this->_level.quality, this->_level.previewFps, this->_level.previewScale, load.fill, load.busy,
+                          static_cast<unsigned long long>(load.dropped));
+    if (this->_file.write(line, qMin(length, int(sizeof(line)) - 1)) < 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Quality log write failed:" << this->_file.errorString();
+    }
+}
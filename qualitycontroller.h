@@ -0,0 +1,63 @@
+#ifndef QUALITYCONTROLLER_H
+#define QUALITYCONTROLLER_H
+
+#include <QFile>
+#include <QString>
+
+//!
+//! \brief Lowers output quality while encoders do not keep up and restores it afterwards.
+//!
+//! Load is sampled periodically from encoder queues. Queue filling up,
+//! encoder busy most of the time or dropped frames for a few samples in a
+//! row lower one step: preview rate first, then preview size, then JPEG
+//! quality of stored frames, never below configured minimum. Longer calm
+//! period restores steps in reverse order, so settings do not oscillate.
+//! Every change is logged with trigger number to CSV file.
+//!
+class QualityController
+{
+public:
+    struct Level {
+        int quality;            //!< JPEG quality of stored frames, 0 when sinks cannot change it
+        int previewFps;         //!< 0 without preview
+        double previewScale;
+    };
+
+    struct Load {
+        double fill;            //!< fullest encoder queue, 0-1
+        double busy;            //!< busiest encoder, part of time spent writing frames
+        quint64 dropped;        //!< frames dropped since previous sample
+    };
+
+    enum Change {
+        Unchanged,
+        Lowered,
+        Restored
+    };
+
+public:
+    QualityController(const Level &nominal, const Level &minimum, int pressureSamples = 2, int reliefSamples = 10);
+    bool openLog(const QString &fileName);
+    Change update(const Load &load, quint64 trigger);
+    const Level &level(void) const;
+    QString description(void) const;
+    static QString levelName(const Level &level);
+    static QString fileNameForVideo(const QString &videoName);
+
+private:
+    bool lower(void);
+    bool restore(void);
+    void log(const char *change, const Load &load, quint64 trigger);
+
+private:
+    Level _nominal;
+    Level _minimum;
+    Level _level;
+    int _pressureSamples;
+    int _reliefSamples;
+    int _pressure;
+    int _relief;
+    QFile _file;
+};
+
+#endif // QUALITYCONTROLLER_H
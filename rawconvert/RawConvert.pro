@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Raw recording converter: transcodes RawFrameSink files to video
+#
+#-------------------------------------------------
+
+QT       += core
+
+TARGET = RawConvert
+CONFIG   += console
+CONFIG   -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+include(../recorder.pri)
+
+SOURCES += main.cpp \
+    convertjob.cpp
+
+HEADERS += \
+    convertjob.h
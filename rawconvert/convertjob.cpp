@@ -0,0 +1,102 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include "convertjob.h"
+#include "framesink.h"
+#include "jpegutils.h"
+#include "rawframefile.h"
+#include "timestamplog.h"
+
+//!
+//! \brief Object constructor.
+//! \param input Represents raw recording.
+//! \param first Represents first converted frame.
+//! \param count Represents number of converted frames.
+//! \param part Represents part number added to output name, -1 converts whole file to one output.
+//! \param options Represents output settings.
+//! \param failures Represents counter incremented when job fails.
+//!
+ConvertJob::ConvertJob(const QString &input, int first, int count, int part, const Options &options, QAtomicInt *failures) :
+    _input(input),
+    _first(first),
+    _count(count),
+    _part(part),
+    _options(options),
+    _failures(failures)
+{
+}
+
+//!
+//! \brief Method builds output file name.
+//! \return Returns name in output directory with input base name and part number.
+//!
+QString ConvertJob::outputName(void) const
+{
+    QFileInfo info(this->_input);
+    QString dir = this->_options.outputDir.isEmpty() ? info.path() : this->_options.outputDir;
+    QString name = info.completeBaseName();
+    if (this->_part >= 0)
+    {
+        name += QString("_part%1").arg(this->_part, 3, 10, QChar('0'));
+    }
+    return QDir(dir).filePath(name + "." + this->_options.suffix);
+}
+
+//!
+//! \brief Method converts frame range. Called by thread pool.
+//!
+void ConvertJob::run(void)
+{
+    RawFrameReader reader;
+    if (!reader.open(this->_input))
+    {
+        this->_failures->ref();
+        return;
+    }
+
+    // Camera JPEG goes to MJPEG file as is, other codecs need decoded frames.
+    bool passthrough = reader.isCompressed() && this->_options.fourcc == CV_FOURCC('M', 'J', 'P', 'G');
+    QString output = this->outputName();
+    FrameSink *sink = FrameSink::create(output, this->_options.fourcc, reader.fps() > 0.0 ? reader.fps() : 25.0,
+                                        reader.frameSize(), passthrough);
+    if (!sink->isOpened())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open output:" << output;
+        delete sink;
+        this->_failures->ref();
+        return;
+    }
+
+    TimestampLog log;
+    log.open(TimestampLog::fileNameForVideo(output));
+
+    int end = qMin(this->_first + this->_count, reader.frameCount());
+    int written = 0;
+    RecordedFrame frame;
+    for (int i = this->_first; i < end; ++i)
+    {
+        if (!reader.frame(i, frame))
+        {
+            break;
+        }
+        if (reader.isCompressed() && !passthrough)
+        {
+            frame.image = decodeJpeg(frame.image);
+        }
+        if (frame.image.empty() || !sink->writeFrame(frame))
+        {
+            qWarning() << __FILE__ << __LINE__ << "Frame not converted:" << i << this->_input;
+            continue;
+        }
+        log.append(quint64(i), frame);
+        ++written;
+    }
+
+    // Images share mapped file, they have to be gone before reader.
+    frame = RecordedFrame();
+    sink->release();
+    delete sink;
+    log.close();
+
+    qDebug() << "converted" << this->_input << "frames" << this->_first << "-" << end - 1 << "->" << output << written;
+}
@@ -0,0 +1,35 @@
+#ifndef CONVERTJOB_H
+#define CONVERTJOB_H
+
+#include <QRunnable>
+#include <QString>
+#include <QAtomicInt>
+
+//!
+//! \brief Conversion of frame range of one raw recording into video file.
+//! Every job maps input on its own, so jobs run in parallel without locks.
+//!
+class ConvertJob : public QRunnable
+{
+public:
+    struct Options {
+        int fourcc;
+        QString suffix;
+        QString outputDir;
+    };
+
+public:
+    ConvertJob(const QString &input, int first, int count, int part, const Options &options, QAtomicInt *failures);
+    void run(void);
+    QString outputName(void) const;
+
+private:
+    QString _input;
+    int _first;
+    int _count;
+    int _part;
+    Options _options;
+    QAtomicInt *_failures;
+};
+
+#endif // CONVERTJOB_H
@@ -0,0 +1,108 @@
+#include <QCoreApplication>
+#include <QtCore>
+#include "convertjob.h"
+#include "rawframefile.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName("RawConvert");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Transcodes raw recordings to video files");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("files", QCoreApplication::translate("main", "Raw recordings to convert."));
+
+    // An option with a value
+    QCommandLineOption codecOption(QStringList() << "codec",
+                                   QCoreApplication::translate("main", "Set output codec as four character <code>."),
+                                   QCoreApplication::translate("main", "code"),
+                                   QLatin1String("MJPG"));
+    parser.addOption(codecOption);
+
+    // An option with a value
+    QCommandLineOption suffixOption(QStringList() << "format",
+                                    QCoreApplication::translate("main", "Set output container as file <suffix>, e.g. avi or mp4."),
+                                    QCoreApplication::translate("main", "suffix"),
+                                    QLatin1String("avi"));
+    parser.addOption(suffixOption);
+
+    // An option with a value
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    QCoreApplication::translate("main", "Write videos to <dir>, default is input directory."),
+                                    QCoreApplication::translate("main", "dir"));
+    parser.addOption(outputOption);
+
+    // An option with a value
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  QCoreApplication::translate("main", "Run <count> conversions in parallel."),
+                                  QCoreApplication::translate("main", "count"),
+                                  QString::number(QThread::idealThreadCount()));
+    parser.addOption(jobsOption);
+
+    // An option with a value
+    QCommandLineOption partOption(QStringList() << "part-frames",
+                                  QCoreApplication::translate("main", "Split every file into outputs of <frames>, converted in parallel. 0 keeps one output."),
+                                  QCoreApplication::translate("main", "frames"),
+                                  QLatin1String("0"));
+    parser.addOption(partOption);
+
+    parser.process(a);
+
+    QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Missing input file";
+        return 1;
+    }
+
+    QString codec = parser.value(codecOption);
+    if (codec.size() != 4)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Bad codec:" << codec;
+        return 1;
+    }
+    QByteArray code = codec.toLatin1();
+
+    ConvertJob::Options options;
+    options.fourcc = CV_FOURCC(code[0], code[1], code[2], code[3]);
+    options.suffix = parser.value(suffixOption);
+    options.outputDir = parser.value(outputOption);
+
+    int partFrames = qMax(parser.value(partOption).toInt(), 0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(parser.value(jobsOption).toInt(), 1));
+    QAtomicInt failures(0);
+
+    foreach (const QString &input, inputs)
+    {
+        int frames = 0;
+        {
+            RawFrameReader reader;
+            if (!reader.open(input))
+            {
+                failures.ref();
+                continue;
+            }
+            frames = reader.frameCount();
+        }
+
+        if (partFrames == 0 || frames <= partFrames)
+        {
+            pool.start(new ConvertJob(input, 0, frames, -1, options, &failures));
+            continue;
+        }
+
+        for (int first = 0, part = 0; first < frames; first += partFrames, ++part)
+        {
+            pool.start(new ConvertJob(input, first, partFrames, part, options, &failures));
+        }
+    }
+
+    pool.waitForDone();
+    return failures.load() == 0 ? 0 : 1;
+}
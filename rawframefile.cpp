@@ -0,0 +1,179 @@
+#include <QDebug>
+#include <cstring>
+#include "rawframefile.h"
+
+const char RawFrameFile::Magic[8] = { 'C', 'A', 'M', 'R', 'A', 'W', 0, 0 };
+
+//!
+//! \brief Function rounds payload size up to frame alignment.
+//! \param size Represents payload bytes.
+//! \return Returns bytes occupied in file.
+//!
+qint64 RawFrameFile::paddedSize(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+//!
+//! \brief Object constructor.
+//!
+RawFrameReader::RawFrameReader() :
+    _data(nullptr),
+    _size(0)
+{
+    memset(&this->_header, 0, sizeof(this->_header));
+}
+
+//!
+//! \brief Object destructor. Unmaps file.
+//!
+RawFrameReader::~RawFrameReader()
+{
+    this->close();
+}
+
+//!
+//! \brief Method maps file and collects offsets of all complete frames.
+//! \param fileName Represents raw recording.
+//! \return Returns false if file is missing or is not raw recording.
+//!
+bool RawFrameReader::open(const QString &fileName)
+{
+    this->close();
+
+    this->_file.setFileName(fileName);
+    if (!this->_file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open raw file:" << fileName << this->_file.errorString();
+        return false;
+    }
+
+    this->_size = this->_file.size();
+    this->_data = this->_size > qint64(sizeof(RawFrameFile::FileHeader)) ? this->_file.map(0, this->_size) : nullptr;
+    if (this->_data == nullptr)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not map raw file:" << fileName;
+        this->close();
+        return false;
+    }
+
+    memcpy(&this->_header, this->_data, sizeof(this->_header));
+    if (memcmp(this->_header.magic, RawFrameFile::Magic, sizeof(RawFrameFile::Magic)) != 0
+            || this->_header.version != RawFrameFile::Version)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Not a raw recording:" << fileName;
+        this->close();
+        return false;
+    }
+
+    // Header counts are missing after crash, so frames are found by walking them.
+    qint64 offset = this->_header.headerSize;
+    qint64 end = this->_header.dataEnd > 0 ? qint64(this->_header.dataEnd) : this->_size;
+    while (offset + qint64(sizeof(RawFrameFile::FrameHeader)) <= end)
+    {
+        RawFrameFile::FrameHeader header;
+        memcpy(&header, this->_data + offset, sizeof(header));
+        qint64 next = offset + qint64(sizeof(header)) + RawFrameFile::paddedSize(header.size);
+        if (header.magic != RawFrameFile::FrameMagic || next > end)
+        {
+            break;
+        }
+        this->_offsets.append(offset);
+        offset = next;
+    }
+
+    if (this->_header.frames > 0 && quint64(this->_offsets.size()) != this->_header.frames)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Raw file frame count mismatch:" << this->_offsets.size() << this->_header.frames;
+    }
+    return true;
+}
+
+//!
+//! \brief Method unmaps and closes file.
+//!
+void RawFrameReader::close(void)
+{
+    if (this->_data != nullptr)
+    {
+        this->_file.unmap(this->_data);
+        this->_data = nullptr;
+    }
+    this->_file.close();
+    this->_offsets.clear();
+    this->_size = 0;
+}
+
+//!
+//! \brief Getter for number of frames.
+//! \return Returns number of complete frames in file.
+//!
+int RawFrameReader::frameCount(void) const
+{
+    return this->_offsets.size();
+}
+
+//!
+//! \brief Method gives frame stored in file.
+//! \param index Represents frame number.
+//! \param frame Represents output; image shares mapped memory and is valid until close().
+//! \return Returns false if index is out of range or payload does not match header.
+//!
+bool RawFrameReader::frame(int index, RecordedFrame &frame) const
+{
+    if (index < 0 || index >= this->_offsets.size())
+    {
+        return false;
+    }
+
+    RawFrameFile::FrameHeader header;
+    const uchar *position = this->_data + this->_offsets.at(index);
+    memcpy(&header, position, sizeof(header));
+    uchar *payload = const_cast<uchar *>(position) + sizeof(header);
+
+    if (this->isCompressed())
+    {
+        frame.image = cv::Mat(1, int(header.size), CV_8UC1, payload);
+    }
+    else
+    {
+        int type = this->_header.type;
+        if (header.size != quint64(this->_header.width) * quint64(this->_header.height) * CV_ELEM_SIZE(type))
+        {
+            qWarning() << __FILE__ << __LINE__ << "Raw frame size does not match header:" << index << header.size;
+            return false;
+        }
+        frame.image = cv::Mat(this->_header.height, this->_header.width, type, payload);
+    }
+    frame.trigger = header.trigger;
+    frame.receiveTimestamp = header.receiveTimestamp;
+    frame.captureTimestamp = header.captureTimestamp;
+    return true;
+}
+
+//!
+//! \brief Getter for payload kind.
+//! \return Returns true if frames are JPEG bytes.
+//!
+bool RawFrameReader::isCompressed(void) const
+{
+    return (this->_header.flags & RawFrameFile::CompressedFlag) != 0;
+}
+
+//!
+//! \brief Getter for frame size.
+//! \return Returns size of recorded images.
+//!
+cv::Size RawFrameReader::frameSize(void) const
+{
+    return cv::Size(this->_header.width, this->_header.height);
+}
+
+//!
+//! \brief Getter for frame rate.
+//! \return Returns frame rate given to recorder.
+//!
+double RawFrameReader::fps(void) const
+{
+    return this->_header.fps;
+}
@@ -0,0 +1,76 @@
+#ifndef RAWFRAMEFILE_H
+#define RAWFRAMEFILE_H
+
+#include <QFile>
+#include <QVector>
+#include "recordedframe.h"
+
+//!
+//! \brief Layout of raw recording written by RawFrameSink.
+//!
+//! File starts with RawFileHeader followed by frames, each one is
+//! RawFrameHeader and payload padded to 8 bytes. Payload is continuous
+//! image of given type, or JPEG bytes when CompressedFlag is set. Values
+//! are stored in host byte order. Frame header is written after payload,
+//! so reader stops at first frame which was not completed.
+//!
+namespace RawFrameFile
+{
+    enum {
+        Version = 1,
+        CompressedFlag = 0x1,
+        FrameMagic = 0x304d5246     // "FRM0"
+    };
+
+    struct FileHeader {
+        char magic[8];              //!< "CAMRAW\0\0"
+        quint32 version;
+        quint32 headerSize;
+        qint32 width;
+        qint32 height;
+        qint32 type;                //!< OpenCV type of image payload
+        quint32 flags;
+        double fps;
+        quint64 frames;             //!< written on close, 0 after crash
+        quint64 dataEnd;            //!< written on close, 0 after crash
+        quint64 reserved;
+    };
+
+    struct FrameHeader {
+        quint32 magic;
+        quint32 size;               //!< payload bytes without padding
+        quint64 trigger;
+        qint64 receiveTimestamp;
+        qint64 captureTimestamp;
+    };
+
+    extern const char Magic[8];
+    qint64 paddedSize(qint64 size);
+}
+
+//!
+//! \brief Reader of raw recording. File is mapped once and frames are
+//! returned without copy, so several readers may share one file.
+//!
+class RawFrameReader
+{
+public:
+    RawFrameReader();
+    ~RawFrameReader();
+    bool open(const QString &fileName);
+    void close(void);
+    int frameCount(void) const;
+    bool frame(int index, RecordedFrame &frame) const;
+    bool isCompressed(void) const;
+    cv::Size frameSize(void) const;
+    double fps(void) const;
+
+private:
+    QFile _file;
+    uchar *_data;
+    qint64 _size;
+    RawFrameFile::FileHeader _header;
+    QVector<qint64> _offsets;
+};
+
+#endif // RAWFRAMEFILE_H
@@ -0,0 +1,273 @@
+#include <QDebug>
+#include <cstring>
+#ifndef Q_OS_WIN
+#include <fcntl.h>
+#endif
+#include "rawframesink.h"
+#include "monotonicclock.h"
+
+// Part of file mapped at once, frames larger than that get window of their own size.
+static const qint64 WindowSize = 64LL * 1024 * 1024;
+
+//!
+//! \brief Object constructor. Creates and preallocates file, writes header.
+//! \param fileName Represents raw file name.
+//! \param fps Represents frame rate stored in header.
+//! \param frameSize Represents size of frames.
+//! \param compressedInput Represents true value when frames are JPEG bytes from camera.
+//! \param preallocate Represents initial file size, file grows by this step when full.
+//!
+RawFrameSink::RawFrameSink(const QString &fileName, double fps, cv::Size frameSize, bool compressedInput,
+                           qint64 preallocate) :
+    _file(fileName),
+    _window(nullptr),
+    _windowOffset(0),
+    _windowSize(0),
+    _position(0),
+    _capacity(0),
+    _growBytes(qMax(preallocate, WindowSize))
+{
+    memset(&this->_header, 0, sizeof(this->_header));
+    memcpy(this->_header.magic, RawFrameFile::Magic, sizeof(RawFrameFile::Magic));
+    this->_header.version = RawFrameFile::Version;
+    this->_header.headerSize = sizeof(RawFrameFile::FileHeader);
+    this->_header.width = frameSize.width;
+    this->_header.height = frameSize.height;
+    this->_header.type = compressedInput ? CV_8UC1 : CV_8UC3;
+    this->_header.flags = compressedInput ? RawFrameFile::CompressedFlag : 0;
+    this->_header.fps = fps;
+
+    // Zeroed preallocated space ends frame list for reader after crash.
+    if (!this->_file.open(QIODevice::ReadWrite | QIODevice::Truncate)
+            || this->_file.write(reinterpret_cast<const char *>(&this->_header), sizeof(this->_header)) != qint64(sizeof(this->_header))
+            || !this->_file.flush()
+            || !this->allocate(this->_growBytes))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open the output video for write:" << fileName << this->_file.errorString();
+        this->_file.close();
+        return;
+    }
+
+    this->_position = sizeof(this->_header);
+    this->_frameIndex.open(FrameIndexFile::fileNameForVideo(fileName), compressedInput);
+}
+
+//!
+//! \brief Object destructor. Finishes file.
+//!
+RawFrameSink::~RawFrameSink()
+{
+    this->release();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool RawFrameSink::isOpened(void) const
+{
+    return this->_file.isOpen();
+}
+
+//!
+//! \brief Overloaded method. Frame without bookkeeping data gets no trigger number.
+//!
+bool RawFrameSink::write(const cv::Mat &frame)
+{
+    RecordedFrame recorded;
+    recorded.image = frame;
+    recorded.captureTimestamp = monotonicNs();
+    return this->writeFrame(recorded);
+}
+
+//!
+//! \brief Overloaded method. Copies image rows into mapped file, header follows them.
+//!
+bool RawFrameSink::writeFrame(const RecordedFrame &frame)
+{
+    const cv::Mat &image = frame.image;
+    if (!this->_file.isOpen() || image.empty())
+    {
+        return false;
+    }
+
+    bool compressed = (this->_header.flags & RawFrameFile::CompressedFlag) != 0;
+    if (this->_header.frames == 0)
+    {
+        this->_header.type = image.type();
+        if (!compressed)
+        {
+            // Processed frames may differ from camera size.
+            this->_header.width = image.cols;
+            this->_header.height = image.rows;
+        }
+    }
+    else if (image.type() != this->_header.type
+             || (!compressed && (image.cols != this->_header.width || image.rows != this->_header.height)))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Frame type or size changed, frame not written";
+        return false;
+    }
+
+    size_t rowBytes = image.cols * image.elemSize();
+    qint64 payload = qint64(rowBytes) * image.rows;
+    qint64 total = qint64(sizeof(RawFrameFile::FrameHeader)) + RawFrameFile::paddedSize(payload);
+    if (payload > qint64(0xffffffffLL) || !this->reserve(total))
+    {
+        return false;
+    }
+
+    uchar *destination = this->_window + (this->_position - this->_windowOffset);
+    uchar *data = destination + sizeof(RawFrameFile::FrameHeader);
+    if (image.isContinuous())
+    {
+        memcpy(data, image.data, size_t(payload));
+    }
+    else
+    {
+        for (int y = 0; y < image.rows; ++y)
+        {
+            memcpy(data + y * rowBytes, image.ptr(y), rowBytes);
+        }
+    }
+
+    RawFrameFile::FrameHeader header;
+    header.magic = RawFrameFile::FrameMagic;
+    header.size = quint32(payload);
+    header.trigger = frame.trigger;
+    header.receiveTimestamp = frame.receiveTimestamp;
+    header.captureTimestamp = frame.captureTimestamp;
+    memcpy(destination, &header, sizeof(header));
+    this->_frameIndex.append(frame, this->_position + qint64(sizeof(header)), payload);
+
+    // Type is known only now, header on disk must match frames even after crash.
+    if (this->_header.frames == 0 && !this->writeHeader())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not write raw file header:" << this->_file.errorString();
+    }
+
+    this->_position += total;
+    ++this->_header.frames;
+    this->notifyStored(frame);
+    return true;
+}
+
+//!
+//! \brief Overloaded method. Writes counts into header and cuts unused preallocated space.
+//!
+void RawFrameSink::release(void)
+{
+    if (!this->_file.isOpen())
+    {
+        return;
+    }
+
+    this->unmapWindow();
+    this->_header.dataEnd = quint64(this->_position);
+    this->writeHeader();
+    this->_file.resize(this->_position);
+    this->_frameIndex.close();
+
+    qDebug() << __FILE__ << "raw file closed:" << this->_file.fileName() << this->_header.frames << "frames";
+    this->_file.close();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString RawFrameSink::description(void) const
+{
+    return QString("raw mapped %1").arg(this->_file.fileName());
+}
+
+//!
+//! \brief Overloaded method.
+//!
+qint64 RawFrameSink::bytesWritten(void) const
+{
+    return this->_position;
+}
+
+//!
+//! \brief Method writes current header at start of file.
+//! \return Returns false if header could not be written.
+//!
+bool RawFrameSink::writeHeader(void)
+{
+    return this->_file.seek(0)
+            && this->_file.write(reinterpret_cast<const char *>(&this->_header), sizeof(this->_header)) == qint64(sizeof(this->_header))
+            && this->_file.flush();
+}
+
+//!
+//! \brief Method makes sure mapped window has room for next frame.
+//! \param bytes Represents size of frame with header and padding.
+//! \return Returns false if file could not grow or be mapped.
+//!
+bool RawFrameSink::reserve(qint64 bytes)
+{
+    if (this->_window != nullptr && this->_position + bytes <= this->_windowOffset + this->_windowSize)
+    {
+        return true;
+    }
+
+    this->unmapWindow();
+    if (this->_position + bytes > this->_capacity)
+    {
+        qint64 capacity = qMax(this->_capacity + this->_growBytes, this->_position + bytes);
+        if (!this->allocate(capacity))
+        {
+            qWarning() << __FILE__ << __LINE__ << "Could not grow raw file, frame not written:" << this->_file.fileName();
+            return false;
+        }
+    }
+
+    this->_windowOffset = this->_position;
+    this->_windowSize = qMin(qMax(WindowSize, bytes), this->_capacity - this->_position);
+    this->_window = this->_file.map(this->_windowOffset, this->_windowSize);
+    if (this->_window == nullptr)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not map raw file:" << this->_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Method gives file disk blocks up to new size.
+//! Resize alone makes sparse file, its blocks would be allocated in page
+//! faults of mapped writes and full disk would kill recorder with SIGBUS.
+//! \param capacity Represents new file size.
+//! \return Returns false if disk space could not be allocated, capacity is unchanged then.
+//!
+bool RawFrameSink::allocate(qint64 capacity)
+{
+#ifdef Q_OS_WIN
+    // Windows allocates blocks when file is extended.
+    if (!this->_file.resize(capacity))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not allocate raw file:" << this->_file.errorString();
+        return false;
+    }
+#else
+    int result = posix_fallocate(this->_file.handle(), off_t(this->_capacity), off_t(capacity - this->_capacity));
+    if (result != 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not allocate raw file:" << strerror(result);
+        return false;
+    }
+#endif
+    this->_capacity = capacity;
+    return true;
+}
+
+//!
+//! \brief Method unmaps current window, its pages are written back by system.
+//!
+void RawFrameSink::unmapWindow(void)
+{
+    if (this->_window != nullptr)
+    {
+        this->_file.unmap(this->_window);
+        this->_window = nullptr;
+    }
+}
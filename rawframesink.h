@@ -0,0 +1,54 @@
+#ifndef RAWFRAMESINK_H
+#define RAWFRAMESINK_H
+
+#include <QFile>
+#include "framesink.h"
+#include "rawframefile.h"
+#include "frameindex.h"
+
+//!
+//! \brief Frame sink appending uncompressed frames to memory-mapped file.
+//!
+//! File is preallocated and written through mapped window, so frame costs
+//! one copy and no encoding. Disk space is allocated ahead, frames which
+//! do not fit on disk are refused. Layout is described in rawframefile.h; use
+//! RawConvert tool to transcode recording afterwards. Place of every
+//! frame is recorded in frame index next to the file.
+//!
+class RawFrameSink : public FrameSink
+{
+public:
+    enum {
+        Fourcc = CV_FOURCC('R', 'A', 'W', 'F')
+    };
+
+public:
+    RawFrameSink(const QString &fileName, double fps, cv::Size frameSize, bool compressedInput,
+                 qint64 preallocate = 1024LL * 1024 * 1024);
+    ~RawFrameSink();
+    bool isOpened(void) const;
+    bool write(const cv::Mat &frame);
+    bool writeFrame(const RecordedFrame &frame);
+    void release(void);
+    QString description(void) const;
+    qint64 bytesWritten(void) const;
+
+private:
+    bool reserve(qint64 bytes);
+    bool allocate(qint64 capacity);
+    bool writeHeader(void);
+    void unmapWindow(void);
+
+private:
+    QFile _file;
+    RawFrameFile::FileHeader _header;
+    FrameIndexWriter _frameIndex;
+    uchar *_window;
+    qint64 _windowOffset;
+    qint64 _windowSize;
+    qint64 _position;
+    qint64 _capacity;
+    qint64 _growBytes;
+};
+
+#endif // RAWFRAMESINK_H
@@ -0,0 +1,30 @@
+#ifndef RECORDEDFRAME_H
+#define RECORDEDFRAME_H
+
+#include <QtGlobal>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+
+//!
+//! \brief Frame selected by trigger together with its bookkeeping data.
+//! All timestamps are monotonic clock values in ns.
+//!
+struct RecordedFrame
+{
+    RecordedFrame() :
+        trigger(0),
+        receiveTimestamp(0),
+        captureTimestamp(0),
+        enqueueTimestamp(0),
+        encodeTimestamp(0)
+    {
+    }
+
+    cv::Mat image;
+    quint64 trigger;
+    qint64 receiveTimestamp;    //!< trigger byte read from serial port
+    qint64 captureTimestamp;    //!< frame read from camera
+    qint64 enqueueTimestamp;    //!< frame passed to encoder
+    qint64 encodeTimestamp;     //!< frame stored in file by sink
+};
+
+#endif // RECORDEDFRAME_H
@@ -0,0 +1,114 @@
+#-------------------------------------------------
+#
+# Recorder core shared by Recorder and its tools
+#
+#-------------------------------------------------
+
+QT       += core
+QT       += serialport
+QT       += widgets
+
+CONFIG += c++11
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/camerathread.cpp \
+    $$PWD/camerachannel.cpp \
+    $$PWD/capturethread.cpp \
+    $$PWD/framepool.cpp \
+    $$PWD/framekernels.cpp \
+    $$PWD/frameprocessor.cpp \
+    $$PWD/changedetector.cpp \
+    $$PWD/qualitycontroller.cpp \
+    $$PWD/threadschedule.cpp \
+    $$PWD/sharedframering.cpp \
+    $$PWD/sharedframepublisher.cpp \
+    $$PWD/encoderthread.cpp \
+    $$PWD/commandparser.cpp \
+    $$PWD/timestamplog.cpp \
+    $$PWD/pretriggerbuffer.cpp \
+    $$PWD/latencyhistogram.cpp \
+    $$PWD/recorderstats.cpp \
+    $$PWD/previewthread.cpp \
+    $$PWD/framesource.cpp \
+    $$PWD/opencvframesource.cpp \
+    $$PWD/fileframesource.cpp \
+    $$PWD/framesink.cpp \
+    $$PWD/opencvframesink.cpp \
+    $$PWD/mjpegavisink.cpp \
+    $$PWD/parallelmjpegsink.cpp \
+    $$PWD/segmentedsink.cpp \
+    $$PWD/writebehindfile.cpp \
+    $$PWD/rawframesink.cpp \
+    $$PWD/rawframefile.cpp \
+    $$PWD/frameindex.cpp \
+    $$PWD/jpegutils.cpp
+
+HEADERS += \
+    $$PWD/camerathread.h \
+    $$PWD/camerachannel.h \
+    $$PWD/capturethread.h \
+    $$PWD/framepool.h \
+    $$PWD/framekernels.h \
+    $$PWD/frameprocessor.h \
+    $$PWD/changedetector.h \
+    $$PWD/qualitycontroller.h \
+    $$PWD/threadschedule.h \
+    $$PWD/sharedframering.h \
+    $$PWD/sharedframepublisher.h \
+    $$PWD/monotonicclock.h \
+    $$PWD/boundedqueue.h \
+    $$PWD/idlewaiter.h \
+    $$PWD/recordedframe.h \
+    $$PWD/encoderthread.h \
+    $$PWD/commandparser.h \
+    $$PWD/timestamplog.h \
+    $$PWD/pretriggerbuffer.h \
+    $$PWD/latencyhistogram.h \
+    $$PWD/recorderstats.h \
+    $$PWD/previewthread.h \
+    $$PWD/framesource.h \
+    $$PWD/opencvframesource.h \
+    $$PWD/fileframesource.h \
+    $$PWD/framesink.h \
+    $$PWD/opencvframesink.h \
+    $$PWD/mjpegavisink.h \
+    $$PWD/parallelmjpegsink.h \
+    $$PWD/segmentedsink.h \
+    $$PWD/writebehindfile.h \
+    $$PWD/rawframesink.h \
+    $$PWD/rawframefile.h \
+    $$PWD/frameindex.h \
+    $$PWD/jpegutils.h
+
+# io_uring submission of write-behind blocks: qmake CONFIG+=uring, needs liburing
+uring {
+    DEFINES += RECORDER_URING
+    LIBS += -luring
+}
+
+linux {
+    SOURCES += $$PWD/v4l2framesource.cpp \
+        $$PWD/serialthread.cpp
+    HEADERS += $$PWD/v4l2framesource.h \
+        $$PWD/serialthread.h
+    LIBS += -lrt
+}
+
+# OPENCV
+"E:\Download\opencv\build\include"
+INCLUDEPATH += E:\\OpenCV\\opencv\\build\\include
+LIBS += -LE:\\OpenCV_release\\bin \
+        -lopencv_calib3d249 \
+        -lopencv_contrib249 \
+        -lopencv_core249 \
+        -lopencv_features2d249 \
+        -lopencv_flann249 \
+        -lopencv_gpu249 \
+        -lopencv_highgui249 \
+        -lopencv_imgproc249 \
+        -lopencv_legacy249 \
+        -lopencv_ml249 \
+        -lopencv_objdetect249 \
+        -lopencv_video249
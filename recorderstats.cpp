@@ -0,0 +1,160 @@
+#include <QStringList>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "recorderstats.h"
+#include "monotonicclock.h"
+
+//!
+//! \brief Object constructor.
+//!
+RecorderStats::RecorderStats() :
+    _startTimestamp(monotonicNs()),
+    _lastSummaryTimestamp(_startTimestamp),
+    _lastCaptured(0),
+    _lastWritten(0)
+{
+    for (int i = 0; i < CounterCount; ++i)
+    {
+        this->_counters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+//!
+//! \brief Method adds duration of stage.
+//! \param stage Represents measured stage.
+//! \param ns Represents duration in ns.
+//!
+void RecorderStats::record(Stage stage, qint64 ns)
+{
+    this->_stages[stage].record(ns);
+}
+
+//!
+//! \brief Method increases counter.
+//! \param counter Represents counter to increase.
+//! \param value Represents value added to counter.
+//!
+void RecorderStats::increment(Counter counter, quint64 value)
+{
+    this->_counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+//!
+//! \brief Getter for counter value.
+//! \param counter Represents counter.
+//! \return Returns value of counter.
+//!
+quint64 RecorderStats::counter(Counter counter) const
+{
+    return this->_counters[counter].load(std::memory_order_relaxed);
+}
+
+//!
+//! \brief Getter for stage histogram.
+//! \param stage Represents stage.
+//! \return Returns histogram of stage durations.
+//!
+const LatencyHistogram &RecorderStats::histogram(Stage stage) const
+{
+    return this->_stages[stage];
+}
+
+//!
+//! \brief Method builds human readable stats line. Frame rates are measured since previous call.
+//! \return Returns single line with rates, counters and latencies in ms.
+//!
+QString RecorderStats::summaryLine(void)
+{
+    qint64 now = monotonicNs();
+    double seconds = qMax(double(now - this->_lastSummaryTimestamp) / 1e9, 1e-9);
+    quint64 captured = this->counter(CapturedCounter);
+    quint64 written = this->counter(WrittenCounter);
+
+    QString line = QString("capture %1 fps, write %2 fps, triggers %3, dropped %4, skipped %5, heap allocations %6")
+            .arg(double(captured - this->_lastCaptured) / seconds, 0, 'f', 1)
+            .arg(double(written - this->_lastWritten) / seconds, 0, 'f', 1)
+            .arg(this->counter(TriggersCounter))
+            .arg(this->counter(DroppedTriggersCounter))
+            .arg(this->counter(SkippedCounter))
+            .arg(this->counter(HeapAllocationsCounter));
+
+    for (int i = 0; i < StageCount; ++i)
+    {
+        const LatencyHistogram &histogram = this->_stages[i];
+        if (histogram.count() == 0)
+        {
+            continue;
+        }
+        line += QString(" | %1 p50 %2 p99 %3 max %4 ms")
+                .arg(stageName(Stage(i)))
+                .arg(double(histogram.percentile(50.0)) / 1e6, 0, 'f', 2)
+                .arg(double(histogram.percentile(99.0)) / 1e6, 0, 'f', 2)
+                .arg(double(histogram.max()) / 1e6, 0, 'f', 2);
+    }
+
+    this->_lastSummaryTimestamp = now;
+    this->_lastCaptured = captured;
+    this->_lastWritten = written;
+    return line;
+}
+
+//!
+//! \brief Method builds machine readable dump of all stats.
+//! \return Returns compact JSON object, latencies in ns.
+//!
+QByteArray RecorderStats::toJson(void) const
+{
+    double seconds = qMax(double(monotonicNs() - this->_startTimestamp) / 1e9, 1e-9);
+
+    QJsonObject counters;
+    for (int i = 0; i < CounterCount; ++i)
+    {
+        counters.insert(counterName(Counter(i)), double(this->counter(Counter(i))));
+    }
+
+    QJsonObject stages;
+    for (int i = 0; i < StageCount; ++i)
+    {
+        const LatencyHistogram &histogram = this->_stages[i];
+        QJsonObject stage;
+        stage.insert("count", double(histogram.count()));
+        stage.insert("p50", double(histogram.percentile(50.0)));
+        stage.insert("p99", double(histogram.percentile(99.0)));
+        stage.insert("max", double(histogram.max()));
+        stages.insert(stageName(Stage(i)), stage);
+    }
+
+    QJsonObject root;
+    root.insert("uptime_s", seconds);
+    root.insert("capture_fps", double(this->counter(CapturedCounter)) / seconds);
+    root.insert("write_fps", double(this->counter(WrittenCounter)) / seconds);
+    root.insert("counters", counters);
+    root.insert("stages_ns", stages);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+//!
+//! \brief Method gives name of stage.
+//! \param stage Represents stage.
+//! \return Returns short name used in reports.
+//!
+const char *RecorderStats::stageName(Stage stage)
+{
+    static const char *const names[StageCount] = {
+        "serial", "capture", "convert", "process", "publish", "encode", "display", "trigger_to_disk"
+    };
+    return (stage >= 0 && stage < StageCount) ? names[stage] : "unknown";
+}
+
+//!
+//! \brief Method gives name of counter.
+//! \param counter Represents counter.
+//! \return Returns short name used in reports.
+//!
+const char *RecorderStats::counterName(Counter counter)
+{
+    static const char *const names[CounterCount] = {
+        "triggers", "dropped_triggers", "captured", "written", "skipped_similar", "heap_allocations"
+    };
+    return (counter >= 0 && counter < CounterCount) ? names[counter] : "unknown";
+}
@@ -0,0 +1,59 @@
+#ifndef RECORDERSTATS_H
+#define RECORDERSTATS_H
+
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+#include "latencyhistogram.h"
+
+//!
+//! \brief Latency histograms and counters of capture/encode path.
+//! Object is created only when instrumentation is enabled; components hold
+//! null pointer otherwise and skip all measurements.
+//!
+class RecorderStats
+{
+public:
+    enum Stage {
+        SerialStage,
+        CaptureStage,
+        ConvertStage,
+        ProcessStage,
+        PublishStage,
+        EncodeStage,
+        DisplayStage,
+        TriggerToDiskStage,
+        StageCount
+    };
+
+    enum Counter {
+        TriggersCounter,
+        DroppedTriggersCounter,
+        CapturedCounter,
+        WrittenCounter,
+        SkippedCounter,
+        HeapAllocationsCounter,
+        CounterCount
+    };
+
+public:
+    RecorderStats();
+    void record(Stage stage, qint64 ns);
+    void increment(Counter counter, quint64 value = 1);
+    quint64 counter(Counter counter) const;
+    const LatencyHistogram &histogram(Stage stage) const;
+    QString summaryLine(void);
+    QByteArray toJson(void) const;
+    static const char *stageName(Stage stage);
+    static const char *counterName(Counter counter);
+
+private:
+    LatencyHistogram _stages[StageCount];
+    std::atomic<quint64> _counters[CounterCount];
+    qint64 _startTimestamp;
+    qint64 _lastSummaryTimestamp;
+    quint64 _lastCaptured;
+    quint64 _lastWritten;
+};
+
+#endif // RECORDERSTATS_H
@@ -0,0 +1,373 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QRunnable>
+#include <functional>
+#include "segmentedsink.h"
+#include "frameindex.h"
+#include "monotonicclock.h"
+
+//!
+//! \brief Job running open or close of segment on worker thread.
+//!
+class SegmentJob : public QRunnable
+{
+public:
+    explicit SegmentJob(const std::function<void()> &function) :
+        _function(function)
+    {
+    }
+
+    void run(void)
+    {
+        this->_function();
+    }
+
+private:
+    std::function<void()> _function;
+};
+
+//!
+//! \brief Object constructor. Opens first segment and starts opening the second one.
+//! \param fileName Represents video file name, segment number is added to it.
+//! \param fourcc Represents codec four character code.
+//! \param fps Represents frame rate stored in files.
+//! \param frameSize Represents size of frames.
+//! \param compressedInput Represents true value when frames are JPEG bytes from camera.
+//! \param limits Represents segment length, first reached limit starts next segment.
+//! \param encoderThreads Represents number of threads compressing MJPEG frames of every segment.
+//! \param writeBehindBuffer Represents size of blocks written behind encoder in bytes, 0 disables write-behind.
+//!
+SegmentedSink::SegmentedSink(const QString &fileName, int fourcc, double fps, cv::Size frameSize, bool compressedInput,
+                             const Limits &limits, int encoderThreads, size_t writeBehindBuffer) :
+    _fileName(fileName),
+    _fourcc(fourcc),
+    _fps(fps),
+    _frameSize(frameSize),
+    _compressedInput(compressedInput),
+    _encoderThreads(encoderThreads),
+    _writeBehindBuffer(writeBehindBuffer),
+    _quality(0),
+    _limits(limits),
+    _written(0),
+    _closedBytes(0)
+{
+    // Jobs run in order of start, so manifest is written by one thread only.
+    this->_worker.setMaxThreadCount(1);
+
+    this->_current = this->newSegment(0);
+    this->_current.sink = FrameSink::create(this->_current.fileName, fourcc, fps, frameSize, compressedInput, encoderThreads,
+                                            writeBehindBuffer);
+    this->_next = this->newSegment(1);
+
+    this->_manifest.setFileName(manifestNameForVideo(fileName));
+    if (this->_manifest.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        this->_manifest.write("segment,file,first_trigger,last_trigger,first_frame,last_frame,frames,bytes\n");
+    }
+    else
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open segment manifest:" << this->_manifest.fileName()
+                   << this->_manifest.errorString();
+    }
+
+    if (this->_current.sink->isOpened())
+    {
+        this->openAhead();
+    }
+}
+
+//!
+//! \brief Object destructor. Closes all segments.
+//!
+SegmentedSink::~SegmentedSink()
+{
+    this->release();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool SegmentedSink::isOpened(void) const
+{
+    return this->_current.sink != nullptr && this->_current.sink->isOpened();
+}
+
+//!
+//! \brief Overloaded method. Frame without bookkeeping data gets no trigger number.
+//!
+bool SegmentedSink::write(const cv::Mat &frame)
+{
+    RecordedFrame recorded;
+    recorded.image = frame;
+    recorded.captureTimestamp = monotonicNs();
+    return this->writeFrame(recorded);
+}
+
+//!
+//! \brief Overloaded method. Starts next segment first when current one is full.
+//!
+bool SegmentedSink::writeFrame(const RecordedFrame &frame)
+{
+    if (this->_current.sink == nullptr)
+    {
+        return false;
+    }
+
+    if (this->_current.frames > 0 && this->isFull(frame))
+    {
+        this->rollover();
+    }
+
+    bool written = this->_current.sink->writeFrame(frame);
+    if (!written && this->_current.frames > 0 && this->rollover())
+    {
+        // Sink refused frame, e.g. at AVI 1.0 size limit, next segment takes it.
+        written = this->_current.sink->writeFrame(frame);
+    }
+    if (!written)
+    {
+        return false;
+    }
+
+    if (this->_current.frames == 0)
+    {
+        this->_current.firstTrigger = frame.trigger;
+        this->_current.firstFrame = this->_written;
+        this->_current.firstCapture = frame.captureTimestamp;
+    }
+    this->_current.lastTrigger = frame.trigger;
+    ++this->_current.frames;
+    ++this->_written;
+    return true;
+}
+
+//!
+//! \brief Overloaded method. Closes current segment and removes unused pre-opened one.
+//!
+void SegmentedSink::release(void)
+{
+    if (this->_current.sink == nullptr)
+    {
+        return;
+    }
+
+    this->_worker.waitForDone();
+    this->closeSegment(this->_current);
+    if (this->_next.sink != nullptr)
+    {
+        this->closeSegment(this->_next);
+    }
+
+    qDebug() << __FILE__ << "segments closed:" << this->_current.index + 1 << "frames:" << this->_written;
+    this->_current.sink = nullptr;
+    this->_next.sink = nullptr;
+    this->_manifest.close();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString SegmentedSink::description(void) const
+{
+    return QString("segmented (%1 frames, %2 s, %3 bytes) %4")
+            .arg(this->_limits.frames).arg(this->_limits.seconds).arg(this->_limits.bytes)
+            .arg(this->_current.sink != nullptr ? this->_current.sink->description() : this->_fileName);
+}
+
+//!
+//! \brief Overloaded method. Counts all segments.
+//!
+qint64 SegmentedSink::bytesWritten(void) const
+{
+    return this->_closedBytes + (this->_current.sink != nullptr ? this->_current.sink->bytesWritten() : 0);
+}
+
+//!
+//! \brief Overloaded method. Segments opened later get the same quality.
+//!
+bool SegmentedSink::setQuality(int quality)
+{
+    if (this->_current.sink == nullptr || !this->_current.sink->setQuality(quality))
+    {
+        return false;
+    }
+    this->_quality = quality;
+    return true;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+void SegmentedSink::flush(void)
+{
+    if (this->_current.sink != nullptr)
+    {
+        this->_current.sink->flush();
+    }
+}
+
+//!
+//! \brief Overloaded method. Segments opened later report to the same listener.
+//!
+void SegmentedSink::setListener(Listener *listener)
+{
+    FrameSink::setListener(listener);
+    if (this->_current.sink != nullptr)
+    {
+        this->_current.sink->setListener(listener);
+    }
+}
+
+//!
+//! \brief Method builds name of segment file.
+//! \param fileName Represents video file name given by user.
+//! \param index Represents segment number.
+//! \return Returns name with segment number before suffix.
+//!
+QString SegmentedSink::fileNameForSegment(const QString &fileName, int index)
+{
+    QFileInfo info(fileName);
+    QString name = QString("%1_%2").arg(info.completeBaseName()).arg(index, 4, 10, QChar('0'));
+    if (!info.suffix().isEmpty())
+    {
+        name += "." + info.suffix();
+    }
+    return QDir(info.path()).filePath(name);
+}
+
+//!
+//! \brief Method builds name of segment manifest.
+//! \param fileName Represents video file name given by user.
+//! \return Returns CSV file name placed next to segments.
+//!
+QString SegmentedSink::manifestNameForVideo(const QString &fileName)
+{
+    QFileInfo info(fileName);
+    return QDir(info.path()).filePath(info.completeBaseName() + "_segments.csv");
+}
+
+//!
+//! \brief Method prepares empty segment record.
+//! \param index Represents segment number.
+//! \return Returns segment without sink.
+//!
+SegmentedSink::Segment SegmentedSink::newSegment(int index) const
+{
+    Segment segment;
+    segment.sink = nullptr;
+    segment.fileName = fileNameForSegment(this->_fileName, index);
+    segment.index = index;
+    segment.firstTrigger = 0;
+    segment.lastTrigger = 0;
+    segment.firstFrame = 0;
+    segment.frames = 0;
+    segment.firstCapture = 0;
+    return segment;
+}
+
+//!
+//! \brief Method opens next segment on worker thread.
+//! Its sink is read by encoder thread only after worker is done.
+//!
+void SegmentedSink::openAhead(void)
+{
+    FrameSink **sink = &this->_next.sink;
+    QString fileName = this->_next.fileName;
+    int fourcc = this->_fourcc;
+    double fps = this->_fps;
+    cv::Size frameSize = this->_frameSize;
+    bool compressedInput = this->_compressedInput;
+    int encoderThreads = this->_encoderThreads;
+    size_t writeBehindBuffer = this->_writeBehindBuffer;
+
+    this->_worker.start(new SegmentJob([=]() {
+        *sink = FrameSink::create(fileName, fourcc, fps, frameSize, compressedInput, encoderThreads, writeBehindBuffer);
+    }));
+}
+
+//!
+//! \brief Method switches to pre-opened segment and closes current one on worker thread.
+//! \return Returns false if next segment could not be opened, current one continues then.
+//!
+bool SegmentedSink::rollover(void)
+{
+    // Next segment was opened while current one was written, normally nothing is waited for.
+    this->_worker.waitForDone();
+    if (this->_next.sink == nullptr || !this->_next.sink->isOpened())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open next segment, rollover disabled:" << this->_next.fileName;
+        delete this->_next.sink;
+        this->_next.sink = nullptr;
+        this->_limits.frames = 0;
+        this->_limits.seconds = 0.0;
+        this->_limits.bytes = 0;
+        return false;
+    }
+
+    // Frames in flight are stored here, so they are reported on this thread and before the segment is closed.
+    this->_current.sink->flush();
+    this->_current.sink->setListener(nullptr);
+    this->_closedBytes += this->_current.sink->bytesWritten();
+    Segment finished = this->_current;
+    this->_worker.start(new SegmentJob([this, finished]() {
+        this->closeSegment(finished);
+    }));
+
+    this->_current = this->_next;
+    this->_current.sink->setListener(this->listener());
+    if (this->_quality > 0)
+    {
+        this->_current.sink->setQuality(this->_quality);
+    }
+    this->_next = this->newSegment(this->_current.index + 1);
+    this->openAhead();
+
+    qDebug() << __FILE__ << __LINE__ << "segment:" << this->_current.fileName << "frame:" << this->_written;
+    return true;
+}
+
+//!
+//! \brief Method checks segment limits.
+//! \param frame Represents frame about to be written.
+//! \return Returns true if frame belongs to next segment.
+//!
+bool SegmentedSink::isFull(const RecordedFrame &frame) const
+{
+    if (this->_limits.frames > 0 && this->_current.frames >= quint64(this->_limits.frames))
+    {
+        return true;
+    }
+    if (this->_limits.seconds > 0.0 && frame.captureTimestamp - this->_current.firstCapture >= qint64(this->_limits.seconds * 1e9))
+    {
+        return true;
+    }
+    return this->_limits.bytes > 0 && this->_current.sink->bytesWritten() >= this->_limits.bytes;
+}
+
+//!
+//! \brief Method finishes segment file and adds it to manifest.
+//! \param segment Represents segment, its sink is deleted; file without frames is removed.
+//!
+void SegmentedSink::closeSegment(Segment segment)
+{
+    segment.sink->release();
+    delete segment.sink;
+
+    if (segment.frames == 0)
+    {
+        QFile::remove(segment.fileName);
+        QFile::remove(FrameIndexFile::fileNameForVideo(segment.fileName));
+        return;
+    }
+
+    if (this->_manifest.isOpen())
+    {
+        QString line = QString("%1,%2,%3,%4,%5,%6,%7,%8\n")
+                .arg(segment.index).arg(QFileInfo(segment.fileName).fileName())
+                .arg(segment.firstTrigger).arg(segment.lastTrigger)
+                .arg(segment.firstFrame).arg(segment.firstFrame + segment.frames - 1)
+                .arg(segment.frames).arg(QFileInfo(segment.fileName).size());
+        this->_manifest.write(line.toLatin1());
+    }
+}
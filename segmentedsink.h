@@ -0,0 +1,79 @@
+#ifndef SEGMENTEDSINK_H
+#define SEGMENTEDSINK_H
+
+#include <QFile>
+#include <QThreadPool>
+#include "framesink.h"
+
+//!
+//! \brief Frame sink splitting recording into files of bounded length.
+//!
+//! Segment is closed when it reaches frame, time or size limit, so a crash
+//! loses at most the open one. Next segment is opened ahead and finished
+//! segment is closed on background thread, rollover only swaps pointers.
+//! Every closed segment is appended to CSV manifest with its first and
+//! last trigger and frame numbers.
+//!
+class SegmentedSink : public FrameSink
+{
+public:
+    struct Limits {
+        int frames;         //!< 0 disables limit
+        double seconds;     //!< capture time span, 0 disables limit
+        qint64 bytes;       //!< 0 disables limit
+    };
+
+public:
+    SegmentedSink(const QString &fileName, int fourcc, double fps, cv::Size frameSize, bool compressedInput,
+                  const Limits &limits, int encoderThreads = 1, size_t writeBehindBuffer = 0);
+    ~SegmentedSink();
+    bool isOpened(void) const;
+    bool write(const cv::Mat &frame);
+    bool writeFrame(const RecordedFrame &frame);
+    void release(void);
+    QString description(void) const;
+    qint64 bytesWritten(void) const;
+    bool setQuality(int quality);
+    void flush(void);
+    void setListener(Listener *listener);
+    static QString fileNameForSegment(const QString &fileName, int index);
+    static QString manifestNameForVideo(const QString &fileName);
+
+private:
+    struct Segment {
+        FrameSink *sink;
+        QString fileName;
+        int index;
+        quint64 firstTrigger;
+        quint64 lastTrigger;
+        quint64 firstFrame;
+        quint64 frames;
+        qint64 firstCapture;
+    };
+
+private:
+    Segment newSegment(int index) const;
+    void openAhead(void);
+    bool rollover(void);
+    bool isFull(const RecordedFrame &frame) const;
+    void closeSegment(Segment segment);
+
+private:
+    QString _fileName;
+    int _fourcc;
+    double _fps;
+    cv::Size _frameSize;
+    bool _compressedInput;
+    int _encoderThreads;
+    size_t _writeBehindBuffer;
+    int _quality;               //!< 0 keeps quality segments are created with
+    Limits _limits;
+    Segment _current;
+    Segment _next;
+    QThreadPool _worker;
+    QFile _manifest;
+    quint64 _written;
+    qint64 _closedBytes;
+};
+
+#endif // SEGMENTEDSINK_H
@@ -0,0 +1,404 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef Q_OS_LINUX
+#include <linux/serial.h>
+#endif
+#include "serialthread.h"
+#include "monotonicclock.h"
+
+//!
+//! \brief Function maps baud rate to termios speed.
+//! \param baudRate Represents bits per second.
+//! \return Returns termios speed or B0 for unsupported rate.
+//!
+static speed_t termiosSpeed(qint32 baudRate)
+{
+    static const struct { qint32 baudRate; speed_t speed; } speeds[] = {
+        { 1200, B1200 }, { 2400, B2400 }, { 4800, B4800 }, { 9600, B9600 }, { 19200, B19200 },
+        { 38400, B38400 }, { 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 },
+#ifdef B460800
+        { 460800, B460800 },
+#endif
+#ifdef B921600
+        { 921600, B921600 },
+#endif
+    };
+
+    for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); ++i)
+    {
+        if (speeds[i].baudRate == baudRate)
+        {
+            return speeds[i].speed;
+        }
+    }
+    return B0;
+}
+
+//!
+//! \brief Object constructor.
+//! \param parent Represents parent of object.
+//!
+SerialThread::SerialThread(QObject *parent) :
+    QThread(parent),
+    _fd(-1),
+    _wakeRead(-1),
+    _wakeWrite(-1),
+    _lowLatency(false)
+{
+}
+
+//!
+//! \brief Object destructor. Stops reading and closes port.
+//!
+SerialThread::~SerialThread()
+{
+    this->close();
+}
+
+//!
+//! \brief Method opens and configures port. Has to be called before start.
+//! \param portName Represents device, "ttyUSB0" is looked up in /dev like QSerialPort does.
+//! \param baudRate Represents bits per second.
+//! \param dataBits Represents data bits of character.
+//! \param parity Represents parity.
+//! \param stopBits Represents stop bits.
+//! \param flowControl Represents flow control.
+//! \return Returns false if port cannot be opened or settings are not supported.
+//!
+bool SerialThread::open(const QString &portName, qint32 baudRate, QSerialPort::DataBits dataBits, QSerialPort::Parity parity,
+                        QSerialPort::StopBits stopBits, QSerialPort::FlowControl flowControl)
+{
+    this->close();
+
+    speed_t speed = termiosSpeed(baudRate);
+    if (speed == B0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Unsupported baud rate:" << baudRate;
+        return false;
+    }
+
+    this->_device = portName.startsWith("/") ? portName : "/dev/" + portName;
+    int fd = ::open(this->_device.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot open serial port" << this->_device << strerror(errno);
+        return false;
+    }
+
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Not a serial port:" << this->_device << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // Raw mode, VMIN 1 makes poll() wake up on the first byte instead of waiting for more.
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+
+    tio.c_cflag &= ~CSIZE;
+    switch (dataBits)
+    {
+        case QSerialPort::Data5:
+        {
+            tio.c_cflag |= CS5;
+        }
+        break;
+
+        case QSerialPort::Data6:
+        {
+            tio.c_cflag |= CS6;
+        }
+        break;
+
+        case QSerialPort::Data7:
+        {
+            tio.c_cflag |= CS7;
+        }
+        break;
+
+        default:
+        {
+            tio.c_cflag |= CS8;
+        }
+        break;
+    }
+
+    tio.c_cflag &= ~(PARENB | PARODD);
+#ifdef CMSPAR
+    tio.c_cflag &= ~CMSPAR;
+#endif
+    switch (parity)
+    {
+        case QSerialPort::EvenParity:
+        {
+            tio.c_cflag |= PARENB;
+        }
+        break;
+
+        case QSerialPort::OddParity:
+        {
+            tio.c_cflag |= PARENB | PARODD;
+        }
+        break;
+
+#ifdef CMSPAR
+        case QSerialPort::SpaceParity:
+        {
+            tio.c_cflag |= PARENB | CMSPAR;
+        }
+        break;
+
+        case QSerialPort::MarkParity:
+        {
+            tio.c_cflag |= PARENB | CMSPAR | PARODD;
+        }
+        break;
+#endif
+
+        default:
+        {
+        }
+        break;
+    }
+
+    if (stopBits == QSerialPort::TwoStop)
+    {
+        tio.c_cflag |= CSTOPB;
+    }
+    else
+    {
+        tio.c_cflag &= ~CSTOPB;
+    }
+
+    tio.c_cflag &= ~CRTSCTS;
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    if (flowControl == QSerialPort::HardwareControl)
+    {
+        tio.c_cflag |= CRTSCTS;
+    }
+    else if (flowControl == QSerialPort::SoftwareControl)
+    {
+        tio.c_iflag |= IXON | IXOFF;
+    }
+
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot configure serial port" << this->_device << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // UART drivers otherwise wait for their FIFO threshold or a timer tick; pseudo terminals do not support it.
+    this->_lowLatency = false;
+#if defined(Q_OS_LINUX) && defined(TIOCGSERIAL)
+    struct serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        this->_lowLatency = ioctl(fd, TIOCSSERIAL, &serial) == 0;
+    }
+#endif
+
+    int wake[2];
+    if (pipe(wake) != 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot create wake pipe" << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    fcntl(wake[0], F_SETFD, FD_CLOEXEC);
+    fcntl(wake[1], F_SETFD, FD_CLOEXEC);
+
+    this->_fd = fd;
+    this->_wakeRead = wake[0];
+    this->_wakeWrite = wake[1];
+    return true;
+}
+
+//!
+//! \brief Method stops reading and closes port.
+//!
+void SerialThread::close(void)
+{
+    this->stop();
+
+    if (this->_fd >= 0)
+    {
+        ::close(this->_fd);
+        ::close(this->_wakeRead);
+        ::close(this->_wakeWrite);
+    }
+    this->_fd = -1;
+    this->_wakeRead = -1;
+    this->_wakeWrite = -1;
+}
+
+//!
+//! \brief Method ends read loop and waits for thread end. Handler is not called afterwards.
+//!
+void SerialThread::stop(void)
+{
+    if (this->isRunning())
+    {
+        this->requestInterruption();
+        char wake = 0;
+        if (::write(this->_wakeWrite, &wake, 1) != 1)
+        {
+            qWarning() << __FILE__ << __LINE__ << "Cannot wake serial thread" << strerror(errno);
+        }
+        this->wait();
+    }
+}
+
+//!
+//! \brief Getter for state of port.
+//! \return Returns true if port is opened.
+//!
+bool SerialThread::isOpen(void) const
+{
+    return this->_fd >= 0;
+}
+
+//!
+//! \brief Setter for CPU affinity and scheduling policy. Has to be called before start.
+//! \param schedule Represents schedule applied when thread starts, empty keeps inherited one.
+//!
+void SerialThread::setSchedule(const ThreadSchedule &schedule)
+{
+    this->_schedule = schedule;
+}
+
+//!
+//! \brief Getter for driver low latency mode.
+//! \return Returns true if driver accepted low latency flag.
+//!
+bool SerialThread::isLowLatency(void) const
+{
+    return this->_lowLatency;
+}
+
+//!
+//! \brief Method sends data. May be called from any thread.
+//! \param data Represents bytes to send.
+//! \return Returns false if port is not opened or data were not accepted within 100 ms.
+//!
+bool SerialThread::write(const QByteArray &data)
+{
+    QMutexLocker locker(&this->_writeMutex);
+    if (this->_fd < 0)
+    {
+        return false;
+    }
+
+    const char *next = data.constData();
+    size_t left = size_t(data.size());
+    while (left > 0)
+    {
+        ssize_t written = ::write(this->_fd, next, left);
+        if (written > 0)
+        {
+            next += written;
+            left -= size_t(written);
+            continue;
+        }
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // Output buffer is full, replies are small so it drains quickly.
+        pollfd output = { this->_fd, POLLOUT, 0 };
+        if (written < 0 && errno == EAGAIN && poll(&output, 1, 100) > 0)
+        {
+            continue;
+        }
+
+        qWarning() << __FILE__ << __LINE__ << "Serial write failed:" << this->_device << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Method describes port for logs.
+//! \return Returns device and latency mode.
+//!
+QString SerialThread::description(void) const
+{
+    return QString("%1 (reader thread, %2)").arg(this->_device)
+            .arg(this->_lowLatency ? "driver low latency" : "driver default latency");
+}
+
+//!
+//! \brief Read loop. Waits for data or stop request.
+//!
+void SerialThread::run(void)
+{
+    if (this->_fd < 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Serial port not opened, reader not started";
+        return;
+    }
+    qDebug() << "serial thread:" << this->_schedule.apply();
+
+    char buffer[4096];
+    bool hangup = false;
+    while (!this->isInterruptionRequested())
+    {
+        pollfd fds[2] = { { this->_fd, POLLIN, 0 }, { this->_wakeRead, POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            qWarning() << __FILE__ << __LINE__ << "Serial poll failed:" << strerror(errno);
+            break;
+        }
+
+        if (fds[1].revents != 0)
+        {
+            break;
+        }
+
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            ssize_t count = ::read(this->_fd, buffer, sizeof(buffer));
+            qint64 receiveTimestamp = monotonicNs();
+            if (count > 0)
+            {
+                hangup = false;
+                emit dataReceived(QByteArray(buffer, int(count)), receiveTimestamp);
+                continue;
+            }
+            if (count < 0 && (errno == EAGAIN || errno == EINTR))
+            {
+                continue;
+            }
+        }
+
+        // Unplugged adapter or closed pseudo terminal keeps reporting hangup, so loop does not spin.
+        if ((fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 || (fds[0].revents & POLLIN) != 0)
+        {
+            if (!hangup)
+            {
+                qWarning() << __FILE__ << __LINE__ << "Serial port hung up:" << this->_device;
+                hangup = true;
+            }
+            QThread::msleep(10);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef SERIALTHREAD_H
+#define SERIALTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QByteArray>
+#include <QSerialPort>
+#include "threadschedule.h"
+
+//!
+//! \brief Serial port read on its own thread, without Qt event loop.
+//!
+//! Port is switched to raw mode with VMIN 1 and VTIME 0 and, where driver
+//! supports it, to low latency mode, so kernel hands over every byte at
+//! once. Thread blocks in poll() and stamps data with monotonic clock
+//! right after read(), then passes it on by dataReceived(). Connected
+//! with Qt::DirectConnection the handler runs on this thread too, so GUI
+//! work does not delay triggers.
+//!
+class SerialThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit SerialThread(QObject *parent = 0);
+    ~SerialThread();
+    bool open(const QString &portName, qint32 baudRate, QSerialPort::DataBits dataBits, QSerialPort::Parity parity,
+              QSerialPort::StopBits stopBits, QSerialPort::FlowControl flowControl);
+    void close(void);
+    void stop(void);
+    bool isOpen(void) const;
+    bool isLowLatency(void) const;
+    void setSchedule(const ThreadSchedule &schedule);
+    bool write(const QByteArray &data);
+    QString description(void) const;
+
+signals:
+    void dataReceived(const QByteArray &data, qint64 receiveTimestamp);
+
+protected:
+    void run(void);
+
+private:
+    QString _device;
+    QMutex _writeMutex;
+    int _fd;
+    int _wakeRead;
+    int _wakeWrite;
+    bool _lowLatency;
+    ThreadSchedule _schedule;
+};
+
+#endif // SERIALTHREAD_H
@@ -0,0 +1,219 @@
+#include <QDebug>
+#include <string.h>
+#include <new>
+#ifndef Q_OS_WIN
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "monotonicclock.h"
+#include "sharedframepublisher.h"
+
+//!
+//! \brief Object constructor. Creates and maps ring, replacing object left by crashed recorder.
+//! \param name Represents ring name readers open.
+//! \param frameSize Represents size of captured frames, stored in ring header for readers.
+//! \param type Represents OpenCV type of captured frames.
+//! \param payloadSize Represents largest frame in bytes, bigger frames are not published.
+//! \param slotCount Represents number of frames kept, readers lagging more lose frames.
+//! \param compressed Represents true value if frames are JPEG rows of compressed source.
+//!
+SharedFramePublisher::SharedFramePublisher(const QString &name, cv::Size frameSize, int type, size_t payloadSize, int slotCount, bool compressed) :
+    _name(SharedFrameRing::objectName(name)),
+    _memory(nullptr),
+    _size(0),
+    _compressed(compressed),
+    _oversized(0)
+{
+#ifdef Q_OS_WIN
+    Q_UNUSED(frameSize);
+    Q_UNUSED(type);
+    Q_UNUSED(payloadSize);
+    Q_UNUSED(slotCount);
+    qWarning() << __FILE__ << __LINE__ << "Shared frame ring is not supported on this system:" << this->_name;
+#else
+    slotCount = qMax(slotCount, 2);
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t slotSize = (SharedFrameRing::SlotHeaderSize + payloadSize + page - 1) / page * page;
+    size_t size = SharedFrameRing::HeaderSize + slotSize * size_t(slotCount);
+
+    QByteArray object = this->_name.toLocal8Bit();
+    shm_unlink(object.constData());
+    int fd = shm_open(object.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot create shared frame ring" << object << strerror(errno);
+        return;
+    }
+
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0)
+    {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot map shared frame ring" << object << strerror(errno);
+        shm_unlink(object.constData());
+        return;
+    }
+
+    // New object is zero filled, so every slot sequence starts even and empty.
+    SharedFrameRing::RingHeader *ring = new (memory) SharedFrameRing::RingHeader;
+    ring->version = SharedFrameRing::Version;
+    ring->slotCount = quint32(slotCount);
+    ring->slotSize = slotSize;
+    ring->payloadSize = slotSize - SharedFrameRing::SlotHeaderSize;
+    ring->width = frameSize.width;
+    ring->height = frameSize.height;
+    ring->type = compressed ? CV_8UC1 : type;
+    ring->flags = compressed ? quint32(SharedFrameRing::CompressedFlag) : 0;
+    ring->writerPid = qint64(getpid());
+    ring->published.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < slotCount; ++i)
+    {
+        new (SharedFrameRing::slot(memory, quint64(i))) SharedFrameRing::SlotHeader;
+    }
+
+    // Readers accept ring only with magic, so it is stored after everything else.
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(ring->magic, SharedFrameRing::Magic, sizeof(SharedFrameRing::Magic));
+
+    this->_memory = memory;
+    this->_size = size;
+#endif
+}
+
+//!
+//! \brief Object destructor. Unmaps and removes ring.
+//!
+SharedFramePublisher::~SharedFramePublisher()
+{
+#ifndef Q_OS_WIN
+    if (this->_memory != nullptr)
+    {
+        munmap(this->_memory, this->_size);
+        shm_unlink(this->_name.toLocal8Bit().constData());
+    }
+#endif
+}
+
+//!
+//! \brief Getter for state of ring.
+//! \return Returns true if ring was created.
+//!
+bool SharedFramePublisher::isOpened(void) const
+{
+    return this->_memory != nullptr;
+}
+
+//!
+//! \brief Method copies frame into next slot. Called only from capture thread.
+//! \param frame Represents captured frame, or one row of JPEG bytes for compressed source.
+//! \param captureTimestamp Represents monotonic capture time in ns.
+//! \param sequence Represents capture sequence number.
+//! \return Returns false if ring is not opened or frame does not fit slot.
+//!
+bool SharedFramePublisher::publish(const cv::Mat &frame, qint64 captureTimestamp, quint64 sequence)
+{
+    if (this->_memory == nullptr || frame.empty())
+    {
+        return false;
+    }
+
+    SharedFrameRing::RingHeader *ring = SharedFrameRing::header(this->_memory);
+    size_t rowBytes = size_t(frame.cols) * frame.elemSize();
+    size_t bytes = rowBytes * size_t(frame.rows);
+    if (bytes > ring->payloadSize)
+    {
+        if (this->_oversized.fetch_add(1, std::memory_order_relaxed) == 0)
+        {
+            qWarning() << __FILE__ << __LINE__ << "Frame does not fit shared frame ring:" << bytes << ring->payloadSize;
+        }
+        return false;
+    }
+
+    quint64 index = ring->published.load(std::memory_order_relaxed);
+    SharedFrameRing::SlotHeader *slot = SharedFrameRing::slot(this->_memory, index);
+    quint32 lock = slot->sequence.load(std::memory_order_relaxed);
+
+    // Odd sequence tells readers slot is being rewritten; fence keeps it before the data.
+    slot->sequence.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->flags = this->_compressed ? quint32(SharedFrameRing::CompressedFlag) : 0;
+    slot->index = index;
+    slot->frame = sequence;
+    slot->captureTimestamp = captureTimestamp;
+    slot->width = frame.cols;
+    slot->height = frame.rows;
+    slot->type = frame.type();
+    slot->step = quint32(rowBytes);
+    slot->size = bytes;
+
+    uchar *payload = SharedFrameRing::payload(slot);
+    if (frame.isContinuous())
+    {
+        memcpy(payload, frame.data, bytes);
+    }
+    else
+    {
+        for (int y = 0; y < frame.rows; ++y)
+        {
+            memcpy(payload + y * rowBytes, frame.ptr(y), rowBytes);
+        }
+    }
+    slot->publishTimestamp = monotonicNs();
+
+    slot->sequence.store(lock + 2, std::memory_order_release);
+    ring->published.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+//!
+//! \brief Getter for number of published frames.
+//! \return Returns number of frames copied into ring.
+//!
+quint64 SharedFramePublisher::published(void) const
+{
+    return this->_memory != nullptr ? SharedFrameRing::header(this->_memory)->published.load(std::memory_order_relaxed) : 0;
+}
+
+//!
+//! \brief Getter for number of frames which did not fit slot.
+//! \return Returns number of not published frames.
+//!
+quint64 SharedFramePublisher::oversized(void) const
+{
+    return this->_oversized.load(std::memory_order_relaxed);
+}
+
+//!
+//! \brief Method describes ring for logs.
+//! \return Returns object name and slot layout.
+//!
+QString SharedFramePublisher::description(void) const
+{
+    if (this->_memory == nullptr)
+    {
+        return QString("%1 (not opened)").arg(this->_name);
+    }
+
+    const SharedFrameRing::RingHeader *ring = SharedFrameRing::header(this->_memory);
+    return QString("%1, %2 slots of %3 kB").arg(this->_name).arg(ring->slotCount).arg(ring->payloadSize / 1024);
+}
+
+//!
+//! \brief Method builds ring name of one camera.
+//! \param name Represents ring name given by user.
+//! \param index Represents camera index.
+//! \param count Represents number of cameras.
+//! \return Returns name itself for single camera, "<name>_cam<index>" otherwise.
+//!
+QString SharedFramePublisher::nameForChannel(const QString &name, int index, int count)
+{
+    return count > 1 ? QString("%1_cam%2").arg(name).arg(index) : name;
+}
@@ -0,0 +1,42 @@
+#ifndef SHAREDFRAMEPUBLISHER_H
+#define SHAREDFRAMEPUBLISHER_H
+
+#include <QString>
+#include <atomic>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+#include "sharedframering.h"
+
+//!
+//! \brief Writer of shared frame ring, see SharedFrameRing for layout.
+//!
+//! Capture thread publishes every frame it reads; publish() is one copy
+//! into next slot and never waits for readers, so local consumers can not
+//! slow recording down. Ring object is removed when publisher is deleted,
+//! mapped readers keep their mapping until they close it.
+//!
+class SharedFramePublisher
+{
+public:
+    SharedFramePublisher(const QString &name, cv::Size frameSize, int type, size_t payloadSize, int slotCount = 8, bool compressed = false);
+    ~SharedFramePublisher();
+    bool isOpened(void) const;
+    bool publish(const cv::Mat &frame, qint64 captureTimestamp, quint64 sequence);
+    quint64 published(void) const;
+    quint64 oversized(void) const;
+    QString description(void) const;
+
+    static QString nameForChannel(const QString &name, int index, int count);
+
+private:
+    SharedFramePublisher(const SharedFramePublisher &);
+    SharedFramePublisher &operator=(const SharedFramePublisher &);
+
+private:
+    QString _name;
+    void *_memory;
+    size_t _size;
+    bool _compressed;
+    std::atomic<quint64> _oversized;
+};
+
+#endif // SHAREDFRAMEPUBLISHER_H
@@ -0,0 +1,251 @@
+#include <QDebug>
+#include <string.h>
+#ifndef Q_OS_WIN
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "sharedframering.h"
+
+static_assert(sizeof(SharedFrameRing::RingHeader) <= SharedFrameRing::HeaderSize, "Ring header does not fit its page");
+static_assert(sizeof(SharedFrameRing::SlotHeader) <= SharedFrameRing::SlotHeaderSize, "Slot header too big");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Shared memory needs lock-free atomics");
+
+const char SharedFrameRing::Magic[8] = { 'C', 'A', 'M', 'S', 'H', 'M', '\0', '\0' };
+
+//!
+//! \brief Function builds POSIX shared memory object name.
+//! \param name Represents name given by user, with or without leading slash.
+//! \return Returns name starting with single slash.
+//!
+QString SharedFrameRing::objectName(const QString &name)
+{
+    QString object = name.startsWith("/") ? name.mid(1) : name;
+    object.replace('/', '_');
+    return "/" + object;
+}
+
+//!
+//! \brief Function gives ring header of mapped object.
+//! \param memory Represents start of mapping.
+//! \return Returns header at start of mapping.
+//!
+SharedFrameRing::RingHeader *SharedFrameRing::header(void *memory)
+{
+    return static_cast<RingHeader *>(memory);
+}
+
+//!
+//! \brief Function gives slot of frame.
+//! \param memory Represents start of mapping.
+//! \param index Represents publish number of frame.
+//! \return Returns header of slot which holds or will hold the frame.
+//!
+SharedFrameRing::SlotHeader *SharedFrameRing::slot(void *memory, quint64 index)
+{
+    RingHeader *ring = header(memory);
+    uchar *base = static_cast<uchar *>(memory) + HeaderSize;
+    return reinterpret_cast<SlotHeader *>(base + (index % ring->slotCount) * ring->slotSize);
+}
+
+//!
+//! \brief Function gives payload of slot.
+//! \param slot Represents slot header.
+//! \return Returns first payload byte, aligned to 64 bytes.
+//!
+uchar *SharedFrameRing::payload(SlotHeader *slot)
+{
+    return reinterpret_cast<uchar *>(slot) + SlotHeaderSize;
+}
+
+//!
+//! \brief Object constructor.
+//!
+SharedFrameReader::SharedFrameReader() :
+    _memory(nullptr),
+    _size(0)
+{
+}
+
+//!
+//! \brief Object destructor. Unmaps ring.
+//!
+SharedFrameReader::~SharedFrameReader()
+{
+    this->close();
+}
+
+//!
+//! \brief Method maps ring published by recorder.
+//! \param name Represents ring name given to recorder.
+//! \return Returns false if ring does not exist or has unknown layout.
+//!
+bool SharedFrameReader::open(const QString &name)
+{
+    this->close();
+#ifdef Q_OS_WIN
+    qWarning() << __FILE__ << __LINE__ << "Shared frame ring is not supported on this system:" << name;
+    return false;
+#else
+    QByteArray object = SharedFrameRing::objectName(name).toLocal8Bit();
+    int fd = shm_open(object.constData(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot open shared frame ring" << object << strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && size_t(info.st_size) >= size_t(SharedFrameRing::HeaderSize))
+    {
+        memory = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot map shared frame ring" << object;
+        return false;
+    }
+
+    // Writer stores magic last, ring without it is not ready yet.
+    const SharedFrameRing::RingHeader *ring = SharedFrameRing::header(memory);
+    if (memcmp(ring->magic, SharedFrameRing::Magic, sizeof(SharedFrameRing::Magic)) != 0
+            || ring->version != SharedFrameRing::Version || ring->slotCount == 0
+            || SharedFrameRing::HeaderSize + ring->slotCount * ring->slotSize > quint64(info.st_size))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Not a frame ring:" << object;
+        munmap(memory, size_t(info.st_size));
+        return false;
+    }
+
+    this->_memory = memory;
+    this->_size = size_t(info.st_size);
+    return true;
+#endif
+}
+
+//!
+//! \brief Method unmaps ring.
+//!
+void SharedFrameReader::close(void)
+{
+#ifndef Q_OS_WIN
+    if (this->_memory != nullptr)
+    {
+        munmap(this->_memory, this->_size);
+    }
+#endif
+    this->_memory = nullptr;
+    this->_size = 0;
+}
+
+//!
+//! \brief Getter for state of reader.
+//! \return Returns true if ring is mapped.
+//!
+bool SharedFrameReader::isOpen(void) const
+{
+    return this->_memory != nullptr;
+}
+
+//!
+//! \brief Getter for number of frames published so far.
+//! \return Returns publish number of the next frame, consumer compares it with its own position.
+//!
+quint64 SharedFrameReader::published(void) const
+{
+    return this->_memory != nullptr ? SharedFrameRing::header(this->_memory)->published.load(std::memory_order_acquire) : 0;
+}
+
+//!
+//! \brief Getter for ring length.
+//! \return Returns number of slots, frames older than that many publishes are overwritten.
+//!
+int SharedFrameReader::slotCount(void) const
+{
+    return this->_memory != nullptr ? int(SharedFrameRing::header(this->_memory)->slotCount) : 0;
+}
+
+//!
+//! \brief Method gives the newest complete frame.
+//! \param frame Represents output value.
+//! \return Returns false if nothing was published yet or writer is just replacing the frame.
+//!
+bool SharedFrameReader::latest(Frame &frame) const
+{
+    quint64 published = this->published();
+    return published > 0 && this->frame(published - 1, frame);
+}
+
+//!
+//! \brief Method gives frame by publish number.
+//! \param index Represents publish number.
+//! \param frame Represents output value.
+//! \return Returns false if frame is not published yet or was already overwritten.
+//!
+bool SharedFrameReader::frame(quint64 index, Frame &frame) const
+{
+    if (this->_memory == nullptr)
+    {
+        return false;
+    }
+
+    const SharedFrameRing::RingHeader *ring = SharedFrameRing::header(this->_memory);
+    quint64 published = ring->published.load(std::memory_order_acquire);
+    if (index >= published || published - index > ring->slotCount)
+    {
+        return false;
+    }
+
+    SharedFrameRing::SlotHeader *slot = SharedFrameRing::slot(this->_memory, index);
+    quint32 sequence = slot->sequence.load(std::memory_order_acquire);
+    if ((sequence & 1) != 0 || slot->index != index || slot->size > ring->payloadSize)
+    {
+        return false;
+    }
+
+    frame.data = SharedFrameRing::payload(slot);
+    frame.size = cv::Size(slot->width, slot->height);
+    frame.type = slot->type;
+    frame.step = slot->step;
+    frame.bytes = size_t(slot->size);
+    frame.compressed = (slot->flags & SharedFrameRing::CompressedFlag) != 0;
+    frame.index = slot->index;
+    frame.sequence = slot->frame;
+    frame.captureTimestamp = slot->captureTimestamp;
+    frame.publishTimestamp = slot->publishTimestamp;
+    frame.slotSequence = sequence;
+    frame.slot = slot;
+
+    // Metadata read above is consistent only if slot was not rewritten meanwhile.
+    return this->isValid(frame);
+}
+
+//!
+//! \brief Method checks that frame was not overwritten since it was returned.
+//! \param frame Represents frame returned by latest() or frame().
+//! \return Returns true if everything read from frame so far is consistent.
+//!
+bool SharedFrameReader::isValid(const Frame &frame) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frame.slot->sequence.load(std::memory_order_relaxed) == frame.slotSequence;
+}
+
+//!
+//! \brief Method wraps frame payload into matrix header without copy.
+//! \param frame Represents frame returned by latest() or frame().
+//! \return Returns image, or single row of JPEG bytes for compressed frame; it must not be modified.
+//!
+cv::Mat SharedFrameReader::image(const Frame &frame) const
+{
+    uchar *data = const_cast<uchar *>(frame.data);
+    if (frame.compressed)
+    {
+        return cv::Mat(1, int(frame.bytes), CV_8UC1, data);
+    }
+    return cv::Mat(frame.size, frame.type, data, frame.step);
+}
@@ -0,0 +1,110 @@
+#ifndef SHAREDFRAMERING_H
+#define SHAREDFRAMERING_H
+
+#include <QString>
+#include <atomic>
+#include <opencv2/core/core.hpp>        // Basic OpenCV structures (cv::Mat)
+
+//!
+//! \brief Layout of frame ring in POSIX shared memory written by SharedFramePublisher.
+//!
+//! Object starts with RingHeader on its own page followed by slots, every
+//! slot is SlotHeader and payload rounded up to whole pages. Frame number n
+//! is in slot n % slotCount. Slot is guarded by sequence lock: writer makes
+//! sequence odd, fills slot and makes it even again, so reader knows data
+//! it used was not overwritten when sequence did not change meanwhile.
+//! Writer never waits for readers, lagging reader only loses frames.
+//! Values are stored in host byte order, readers run on the same box.
+//!
+namespace SharedFrameRing
+{
+    enum {
+        Version = 1,
+        HeaderSize = 4096,
+        SlotHeaderSize = 64,
+        CompressedFlag = 0x1
+    };
+
+    struct RingHeader {
+        char magic[8];                      //!< "CAMSHM\0\0"
+        quint32 version;
+        quint32 slotCount;
+        quint64 slotSize;                   //!< distance of slots, header included
+        quint64 payloadSize;                //!< largest frame in bytes
+        qint32 width;
+        qint32 height;
+        qint32 type;                        //!< OpenCV type of payload
+        quint32 flags;
+        qint64 writerPid;
+        std::atomic<quint64> published;     //!< number of frames published, the newest is published - 1
+    };
+
+    struct SlotHeader {
+        std::atomic<quint32> sequence;      //!< odd while slot is written
+        quint32 flags;
+        quint64 index;                      //!< publish number of frame in slot
+        quint64 frame;                      //!< capture sequence number of camera
+        qint64 captureTimestamp;            //!< monotonic clock, ns
+        qint64 publishTimestamp;            //!< monotonic clock, ns
+        qint32 width;
+        qint32 height;
+        qint32 type;
+        quint32 step;                       //!< bytes per payload row
+        quint64 size;                       //!< payload bytes
+    };
+
+    extern const char Magic[8];
+    QString objectName(const QString &name);
+    RingHeader *header(void *memory);
+    SlotHeader *slot(void *memory, quint64 index);
+    uchar *payload(SlotHeader *slot);
+}
+
+//!
+//! \brief Consumer side of shared frame ring.
+//!
+//! Frames are returned as pointers into read-only mapping, nothing is
+//! copied. Consumer checks isValid() after it used the frame; false value
+//! means writer reused slot meanwhile and result has to be thrown away.
+//!
+class SharedFrameReader
+{
+public:
+    struct Frame {
+        const uchar *data;
+        cv::Size size;
+        int type;
+        size_t step;
+        size_t bytes;
+        bool compressed;
+        quint64 index;
+        quint64 sequence;
+        qint64 captureTimestamp;
+        qint64 publishTimestamp;
+        quint32 slotSequence;
+        const SharedFrameRing::SlotHeader *slot;
+    };
+
+public:
+    SharedFrameReader();
+    ~SharedFrameReader();
+    bool open(const QString &name);
+    void close(void);
+    bool isOpen(void) const;
+    quint64 published(void) const;
+    int slotCount(void) const;
+    bool latest(Frame &frame) const;
+    bool frame(quint64 index, Frame &frame) const;
+    bool isValid(const Frame &frame) const;
+    cv::Mat image(const Frame &frame) const;
+
+private:
+    SharedFrameReader(const SharedFrameReader &);
+    SharedFrameReader &operator=(const SharedFrameReader &);
+
+private:
+    void *_memory;
+    size_t _size;
+};
+
+#endif // SHAREDFRAMERING_H
@@ -0,0 +1,384 @@
+#include <QDebug>
+#include <QStringList>
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#include "threadschedule.h"
+
+static const int MaxCpus = 64;
+
+//!
+//! \brief Object constructor. Empty schedule leaves thread as it was created.
+//!
+ThreadSchedule::ThreadSchedule() :
+    _affinity(0),
+    _policy(InheritPolicy),
+    _priority(0)
+{
+}
+
+//!
+//! \brief Getter for empty schedule.
+//! \return Returns true if neither affinity nor policy is set.
+//!
+bool ThreadSchedule::isEmpty(void) const
+{
+    return this->_affinity == 0 && this->_policy == InheritPolicy;
+}
+
+//!
+//! \brief Setter for CPU affinity.
+//! \param mask Represents bit per CPU, 0 keeps inherited affinity.
+//!
+void ThreadSchedule::setAffinity(quint64 mask)
+{
+    this->_affinity = mask;
+}
+
+//!
+//! \brief Setter for scheduling policy.
+//! \param policy Represents kernel scheduler class.
+//!
+void ThreadSchedule::setPolicy(Policy policy)
+{
+    this->_policy = policy;
+}
+
+//!
+//! \brief Setter for priority. Priority without policy is nice value of other policy.
+//! \param priority Represents real-time priority, or nice value for other policy.
+//!
+void ThreadSchedule::setPriority(int priority)
+{
+    this->_priority = priority;
+    if (this->_policy == InheritPolicy)
+    {
+        this->_policy = OtherPolicy;
+    }
+}
+
+//!
+//! \brief Method describes requested schedule.
+//! \return Returns e.g. "fifo 80 on cpus 2-3".
+//!
+QString ThreadSchedule::description(void) const
+{
+    QString text;
+    switch (this->_policy)
+    {
+        case OtherPolicy:
+        {
+            text = QString("other nice %1").arg(this->_priority);
+        }
+        break;
+
+        case FifoPolicy:
+        {
+            text = QString("fifo %1").arg(this->_priority);
+        }
+        break;
+
+        case RoundRobinPolicy:
+        {
+            text = QString("rr %1").arg(this->_priority);
+        }
+        break;
+
+        default:
+        {
+            text = "inherited policy";
+        }
+        break;
+    }
+    return text + (this->_affinity != 0 ? " on cpus " + affinityToString(this->_affinity) : QString(" on inherited cpus"));
+}
+
+//!
+//! \brief Method applies schedule to calling thread and reads back what kernel granted.
+//! \return Returns requested and granted schedule for startup report.
+//!
+QString ThreadSchedule::apply(void) const
+{
+    if (this->isEmpty())
+    {
+        return "default, " + current();
+    }
+
+#ifdef Q_OS_LINUX
+    QStringList errors;
+    if (this->_affinity != 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < MaxCpus; ++cpu)
+        {
+            if (this->_affinity & (Q_UINT64_C(1) << cpu))
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            errors << QString("affinity: %1").arg(strerror(errno));
+        }
+    }
+
+    if (this->_policy == OtherPolicy)
+    {
+        sched_param param;
+        param.sched_priority = 0;
+        int result = pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        // Nice value of single thread is set through its kernel thread id.
+        if (result == 0 && setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), this->_priority) != 0)
+        {
+            result = errno;
+        }
+        if (result != 0)
+        {
+            errors << QString("policy: %1").arg(strerror(result));
+        }
+    }
+    else if (this->_policy == FifoPolicy || this->_policy == RoundRobinPolicy)
+    {
+        int policy = this->_policy == FifoPolicy ? SCHED_FIFO : SCHED_RR;
+        sched_param param;
+        param.sched_priority = qBound(sched_get_priority_min(policy), this->_priority, sched_get_priority_max(policy));
+        int result = pthread_setschedparam(pthread_self(), policy, &param);
+        if (result != 0)
+        {
+            errors << QString("policy: %1").arg(strerror(result));
+        }
+    }
+
+    if (!errors.isEmpty())
+    {
+        qWarning() << __FILE__ << __LINE__ << "Thread schedule not granted:" << this->description() << errors.join(", ");
+        return QString("requested %1, granted %2 (%3)").arg(this->description(), current(), errors.join(", "));
+    }
+    return QString("requested %1, granted %2").arg(this->description(), current());
+#else
+    return QString("requested %1, ignored on this system").arg(this->description());
+#endif
+}
+
+//!
+//! \brief Method reads schedule of calling thread from kernel.
+//! \return Returns e.g. "fifo 80 on cpus 2-3".
+//!
+QString ThreadSchedule::current(void)
+{
+#ifdef Q_OS_LINUX
+    int policy = SCHED_OTHER;
+    sched_param param;
+    param.sched_priority = 0;
+    pthread_getschedparam(pthread_self(), &policy, &param);
+
+    QString text;
+    switch (policy)
+    {
+        case SCHED_OTHER:
+        {
+            errno = 0;
+            int nice = getpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)));
+            text = errno == 0 ? QString("other nice %1").arg(nice) : QString("other");
+        }
+        break;
+
+        case SCHED_FIFO:
+        {
+            text = QString("fifo %1").arg(param.sched_priority);
+        }
+        break;
+
+        case SCHED_RR:
+        {
+            text = QString("rr %1").arg(param.sched_priority);
+        }
+        break;
+
+        default:
+        {
+            text = QString("policy %1").arg(policy);
+        }
+        break;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        quint64 mask = 0;
+        for (int cpu = 0; cpu < MaxCpus; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                mask |= Q_UINT64_C(1) << cpu;
+            }
+        }
+        text += " on cpus " + affinityToString(mask);
+    }
+    return text;
+#else
+    return "unknown schedule";
+#endif
+}
+
+//!
+//! \brief Method locks current and future memory of process, so frame buffers never page out.
+//! \return Returns result for startup report.
+//!
+QString ThreadSchedule::lockMemory(void)
+{
+#ifdef Q_OS_LINUX
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+    {
+        return "memory locked";
+    }
+
+    int error = errno;
+    QString limit = "unknown";
+    struct rlimit memlock;
+    if (getrlimit(RLIMIT_MEMLOCK, &memlock) == 0)
+    {
+        limit = memlock.rlim_cur == RLIM_INFINITY ? QString("unlimited") : QString("%1 kB").arg(quint64(memlock.rlim_cur) >> 10);
+    }
+    qWarning() << __FILE__ << __LINE__ << "Memory not locked:" << strerror(error) << "RLIMIT_MEMLOCK" << limit;
+    return QString("memory not locked (%1, RLIMIT_MEMLOCK %2)").arg(strerror(error), limit);
+#else
+    return "memory locking ignored on this system";
+#endif
+}
+
+//!
+//! \brief Function names thread role as in configuration.
+//! \param role Represents recorder thread.
+//! \return Returns "serial", "capture", "encode" or "preview".
+//!
+const char *ThreadSchedule::roleName(Role role)
+{
+    static const char *names[RoleCount] = { "serial", "capture", "encode", "preview" };
+    return role >= 0 && role < RoleCount ? names[role] : "unknown";
+}
+
+//!
+//! \brief Function reads thread role.
+//! \param text Represents role name, see roleName().
+//! \param role Represents output role.
+//! \return Returns false for unknown name.
+//!
+bool ThreadSchedule::roleFromString(const QString &text, Role &role)
+{
+    for (int i = 0; i < RoleCount; ++i)
+    {
+        if (text.trimmed().compare(roleName(Role(i)), Qt::CaseInsensitive) == 0)
+        {
+            role = Role(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+//!
+//! \brief Function reads scheduling policy.
+//! \param text Represents "fifo", "rr", "other" or "inherit", optionally with "SCHED_" prefix.
+//! \param policy Represents output policy.
+//! \return Returns false for unknown name.
+//!
+bool ThreadSchedule::policyFromString(const QString &text, Policy &policy)
+{
+    QString name = text.trimmed().toLower();
+    if (name.startsWith("sched_"))
+    {
+        name = name.mid(6);
+    }
+
+    if (name == "fifo")
+    {
+        policy = FifoPolicy;
+    }
+    else if (name == "rr")
+    {
+        policy = RoundRobinPolicy;
+    }
+    else if (name == "other" || name == "normal")
+    {
+        policy = OtherPolicy;
+    }
+    else if (name == "inherit" || name.isEmpty())
+    {
+        policy = InheritPolicy;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Function reads CPU affinity.
+//! \param text Represents hexadecimal mask, e.g. "0xc", or CPU list, e.g. "2,3" or "0-3".
+//! \param mask Represents output bit per CPU.
+//! \return Returns false if text is not valid or selects no CPU.
+//!
+bool ThreadSchedule::affinityFromString(const QString &text, quint64 &mask)
+{
+    bool ok = false;
+    QString value = text.trimmed();
+    if (value.startsWith("0x", Qt::CaseInsensitive))
+    {
+        mask = value.mid(2).toULongLong(&ok, 16);
+        return ok && mask != 0;
+    }
+
+    mask = 0;
+    foreach (const QString &item, value.split(',', QString::SkipEmptyParts))
+    {
+        QStringList bounds = item.trimmed().split('-');
+        bool lastOk = false;
+        int first = bounds.at(0).trimmed().toInt(&ok);
+        int last = bounds.size() == 2 ? bounds.at(1).trimmed().toInt(&lastOk) : first;
+        if (!ok || (bounds.size() == 2 && !lastOk) || bounds.size() > 2 || first < 0 || last < first || last >= MaxCpus)
+        {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            mask |= Q_UINT64_C(1) << cpu;
+        }
+    }
+    return mask != 0;
+}
+
+//!
+//! \brief Function writes CPU affinity as list.
+//! \param mask Represents bit per CPU.
+//! \return Returns e.g. "0-3,6".
+//!
+QString ThreadSchedule::affinityToString(quint64 mask)
+{
+    QStringList ranges;
+    for (int cpu = 0; cpu < MaxCpus; ++cpu)
+    {
+        if ((mask & (Q_UINT64_C(1) << cpu)) == 0)
+        {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < MaxCpus && (mask & (Q_UINT64_C(1) << (last + 1))) != 0)
+        {
+            ++last;
+        }
+        ranges << (last == cpu ? QString::number(cpu) : QString("%1-%2").arg(cpu).arg(last));
+        cpu = last;
+    }
+    return ranges.isEmpty() ? QString("none") : ranges.join(",");
+}
@@ -0,0 +1,56 @@
+#ifndef THREADSCHEDULE_H
+#define THREADSCHEDULE_H
+
+#include <QString>
+
+//!
+//! \brief CPU affinity and scheduling policy of one recorder thread.
+//!
+//! Settings come from threads section of comConfig.xml. Thread applies
+//! them to itself when it starts, because only the running thread knows
+//! its kernel handle; threads it creates later (encoder workers) inherit
+//! them. Granted values are read back from kernel, so real-time policy
+//! refused for missing CAP_SYS_NICE or RLIMIT_RTPRIO shows in report.
+//! Supported on Linux only, other systems report settings as ignored.
+//!
+class ThreadSchedule
+{
+public:
+    enum Role {
+        SerialRole,
+        CaptureRole,
+        EncodeRole,
+        PreviewRole,
+        RoleCount
+    };
+
+    enum Policy {
+        InheritPolicy,          //!< policy and priority are not changed
+        OtherPolicy,            //!< SCHED_OTHER, priority is nice value
+        FifoPolicy,             //!< SCHED_FIFO, priority 1-99
+        RoundRobinPolicy        //!< SCHED_RR, priority 1-99
+    };
+
+public:
+    ThreadSchedule();
+    bool isEmpty(void) const;
+    void setAffinity(quint64 mask);
+    void setPolicy(Policy policy);
+    void setPriority(int priority);
+    QString description(void) const;
+    QString apply(void) const;
+    static QString current(void);
+    static QString lockMemory(void);
+    static const char *roleName(Role role);
+    static bool roleFromString(const QString &text, Role &role);
+    static bool policyFromString(const QString &text, Policy &policy);
+    static bool affinityFromString(const QString &text, quint64 &mask);
+    static QString affinityToString(quint64 mask);
+
+private:
+    quint64 _affinity;
+    Policy _policy;
+    int _priority;
+};
+
+#endif // THREADSCHEDULE_H
@@ -0,0 +1,105 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <cstdio>
+#include "timestamplog.h"
+
+//!
+//! \brief Object constructor.
+//! \param bufferSize Represents number of bytes collected before write to file.
+//!
+TimestampLog::TimestampLog(int bufferSize) :
+    _bufferSize(qMax(bufferSize, 4096))
+{
+    this->_buffer.reserve(this->_bufferSize + 256);
+}
+
+//!
+//! \brief Object destructor. Writes rest of buffer.
+//!
+TimestampLog::~TimestampLog()
+{
+    this->close();
+}
+
+//!
+//! \brief Method creates file and writes header line.
+//! \param fileName Represents path of csv file.
+//! \return Returns true if file was opened.
+//!
+bool TimestampLog::open(const QString &fileName)
+{
+    this->_file.setFileName(fileName);
+    if (!this->_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Could not open timestamp file:" << fileName << this->_file.errorString();
+        return false;
+    }
+
+    this->_buffer.resize(0); // keeps capacity
+    this->_buffer.append("frame,trigger,receive_ns,capture_ns,enqueue_ns,encode_ns\n");
+    return true;
+}
+
+//!
+//! \brief Method adds line for written frame.
+//! \param frameIndex Represents index of frame in video file.
+//! \param frame Represents written frame.
+//!
+void TimestampLog::append(quint64 frameIndex, const RecordedFrame &frame)
+{
+    if (!this->_file.isOpen())
+    {
+        return;
+    }
+
+    char line[160];
+    int length = snprintf(line, sizeof(line), "%llu,%llu,%lld,%lld,%lld,%lld\n",
+                          (unsigned long long) frameIndex, (unsigned long long) frame.trigger,
+                          (long long) frame.receiveTimestamp, (long long) frame.captureTimestamp,
+                          (long long) frame.enqueueTimestamp, (long long) frame.encodeTimestamp);
+    this->_buffer.append(line, length);
+
+    if (this->_buffer.size() >= this->_bufferSize)
+    {
+        this->flush();
+    }
+}
+
+//!
+//! \brief Method writes collected lines to file.
+//!
+void TimestampLog::flush(void)
+{
+    if (this->_file.isOpen() && !this->_buffer.isEmpty())
+    {
+        if (this->_file.write(this->_buffer) != this->_buffer.size())
+        {
+            qWarning() << __FILE__ << __LINE__ << "Timestamp file write failed:" << this->_file.errorString();
+        }
+        this->_buffer.resize(0); // keeps capacity
+    }
+}
+
+//!
+//! \brief Method writes rest of buffer and closes file.
+//!
+void TimestampLog::close(void)
+{
+    if (this->_file.isOpen())
+    {
+        this->flush();
+        this->_file.close();
+    }
+}
+
+//!
+//! \brief Method builds sidecar name for video.
+//! \param videoName Represents video file name.
+//! \return Returns "<name>_timestamps.csv" in video directory.
+//!
+QString TimestampLog::fileNameForVideo(const QString &videoName)
+{
+    QFileInfo info(videoName);
+    return QDir(info.path()).filePath(info.completeBaseName() + "_timestamps.csv");
+}
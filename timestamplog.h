@@ -0,0 +1,30 @@
+#ifndef TIMESTAMPLOG_H
+#define TIMESTAMPLOG_H
+
+#include <QFile>
+#include <QByteArray>
+#include "recordedframe.h"
+
+//!
+//! \brief CSV sidecar with timestamps of every written frame.
+//! Lines are collected in memory and written in large blocks, so single
+//! frame does not cost any system call.
+//!
+class TimestampLog
+{
+public:
+    explicit TimestampLog(int bufferSize = 64 * 1024);
+    ~TimestampLog();
+    bool open(const QString &fileName);
+    void append(quint64 frameIndex, const RecordedFrame &frame);
+    void flush(void);
+    void close(void);
+    static QString fileNameForVideo(const QString &videoName);
+
+private:
+    QFile _file;
+    QByteArray _buffer;
+    int _bufferSize;
+};
+
+#endif // TIMESTAMPLOG_H
@@ -0,0 +1,330 @@
+#include <QDebug>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+#include "v4l2framesource.h"
+#include "framekernels.h"
+
+//!
+//! \brief Object constructor. Opens device and starts streaming.
+//! \param device Represents device node, e.g. /dev/video0.
+//! \param passthrough Represents true value to request MJPEG and deliver it without decoding.
+//! \param bufferCount Represents number of driver buffers to map.
+//!
+V4l2FrameSource::V4l2FrameSource(const QString &device, bool passthrough, int bufferCount) :
+    _device(device),
+    _fd(-1),
+    _bytesPerLine(0),
+    _imageSize(0),
+    _passthrough(passthrough),
+    _fps(0.0),
+    _streaming(false),
+    _errorFrames(0),
+    _truncatedFrames(0)
+{
+    if (!this->open(bufferCount))
+    {
+        this->release();
+    }
+}
+
+//!
+//! \brief Object destructor.
+//!
+V4l2FrameSource::~V4l2FrameSource()
+{
+    this->release();
+}
+
+//!
+//! \brief Method configures YUYV or MJPEG format and maps driver buffers.
+//! \param bufferCount Represents number of requested buffers.
+//! \return Returns true if streaming started.
+//!
+bool V4l2FrameSource::open(int bufferCount)
+{
+    this->_fd = ::open(this->_device.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK);
+    if (this->_fd < 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Cannot open" << this->_device << strerror(errno);
+        return false;
+    }
+
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (!this->xioctl(VIDIOC_QUERYCAP, &cap, "VIDIOC_QUERYCAP"))
+    {
+        return false;
+    }
+    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING))
+    {
+        qWarning() << __FILE__ << __LINE__ << this->_device << "does not support streaming capture";
+        return false;
+    }
+
+    // Keep size selected in driver, only request pixel format.
+    quint32 pixelFormat = this->_passthrough ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV;
+    struct v4l2_format format;
+    memset(&format, 0, sizeof(format));
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (!this->xioctl(VIDIOC_G_FMT, &format, "VIDIOC_G_FMT"))
+    {
+        return false;
+    }
+    format.fmt.pix.pixelformat = pixelFormat;
+    format.fmt.pix.field = V4L2_FIELD_ANY;
+    if (!this->xioctl(VIDIOC_S_FMT, &format, "VIDIOC_S_FMT"))
+    {
+        return false;
+    }
+    if (format.fmt.pix.pixelformat != pixelFormat
+            && !(this->_passthrough && format.fmt.pix.pixelformat == V4L2_PIX_FMT_JPEG))
+    {
+        qWarning() << __FILE__ << __LINE__ << this->_device << "does not deliver" << (this->_passthrough ? "MJPEG" : "YUYV");
+        return false;
+    }
+    this->_size = cv::Size(int(format.fmt.pix.width), int(format.fmt.pix.height));
+    this->_bytesPerLine = int(format.fmt.pix.bytesperline);
+    this->_imageSize = int(format.fmt.pix.sizeimage);
+
+    struct v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(this->_fd, VIDIOC_G_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator != 0)
+    {
+        this->_fps = double(parm.parm.capture.timeperframe.denominator) / double(parm.parm.capture.timeperframe.numerator);
+    }
+
+    struct v4l2_requestbuffers request;
+    memset(&request, 0, sizeof(request));
+    request.count = quint32(qMax(bufferCount, 2));
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (!this->xioctl(VIDIOC_REQBUFS, &request, "VIDIOC_REQBUFS"))
+    {
+        return false;
+    }
+
+    for (quint32 i = 0; i < request.count; ++i)
+    {
+        struct v4l2_buffer buffer;
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = i;
+        if (!this->xioctl(VIDIOC_QUERYBUF, &buffer, "VIDIOC_QUERYBUF"))
+        {
+            return false;
+        }
+
+        Buffer mapped;
+        mapped.length = buffer.length;
+        mapped.start = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, this->_fd, buffer.m.offset);
+        if (mapped.start == MAP_FAILED)
+        {
+            qWarning() << __FILE__ << __LINE__ << "mmap failed" << strerror(errno);
+            return false;
+        }
+        this->_buffers.append(mapped);
+
+        if (!this->xioctl(VIDIOC_QBUF, &buffer, "VIDIOC_QBUF"))
+        {
+            return false;
+        }
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (!this->xioctl(VIDIOC_STREAMON, &type, "VIDIOC_STREAMON"))
+    {
+        return false;
+    }
+    this->_streaming = true;
+
+    qDebug() << __FILE__ << this->_device << this->_size.width << this->_size.height << this->_fps << "fps,"
+             << this->_buffers.size() << "buffers" << (this->_passthrough ? "MJPEG passthrough" : "YUYV");
+    return true;
+}
+
+//!
+//! \brief Method calls ioctl, retried when interrupted by signal.
+//! \param request Represents ioctl request.
+//! \param arg Represents request argument.
+//! \param name Represents request name for log.
+//! \return Returns true on success.
+//!
+bool V4l2FrameSource::xioctl(unsigned long request, void *arg, const char *name)
+{
+    int result = -1;
+    do
+    {
+        result = ioctl(this->_fd, request, arg);
+    }
+    while (result == -1 && errno == EINTR);
+
+    if (result == -1)
+    {
+        qWarning() << __FILE__ << __LINE__ << name << "failed on" << this->_device << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool V4l2FrameSource::isOpened(void) const
+{
+    return this->_streaming;
+}
+
+//!
+//! \brief Overloaded method. Waits for filled driver buffer and converts it in place of caller frame.
+//! In passthrough mode JPEG bytes are copied into row view of buffer sized for the largest image,
+//! so frame memory is reused although every image has different length.
+//!
+bool V4l2FrameSource::read(cv::Mat &frame)
+{
+    if (!this->_streaming)
+    {
+        return false;
+    }
+
+    struct v4l2_buffer buffer;
+    for (;;)
+    {
+        struct pollfd descriptor;
+        descriptor.fd = this->_fd;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        int ready = poll(&descriptor, 1, 1000);
+        if (ready <= 0)
+        {
+            if (ready == 0)
+            {
+                qWarning() << __FILE__ << __LINE__ << "Capture timeout on" << this->_device;
+            }
+            return false;
+        }
+
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        if (ioctl(this->_fd, VIDIOC_DQBUF, &buffer) == -1)
+        {
+            if (errno != EAGAIN)
+            {
+                qWarning() << __FILE__ << __LINE__ << "VIDIOC_DQBUF failed" << strerror(errno);
+            }
+            return false;
+        }
+
+        // Corrupt, empty or oversized frame is given back to driver and the next one is taken at once.
+        if ((buffer.flags & V4L2_BUF_FLAG_ERROR) != 0 || buffer.bytesused == 0)
+        {
+            ++this->_errorFrames;
+        }
+        else if (this->_passthrough && buffer.bytesused > quint32(this->_imageSize))
+        {
+            ++this->_truncatedFrames;
+        }
+        else
+        {
+            break;
+        }
+        if (!this->xioctl(VIDIOC_QBUF, &buffer, "VIDIOC_QBUF"))
+        {
+            return false;
+        }
+    }
+
+    if (this->_passthrough)
+    {
+        int length = int(buffer.bytesused);
+        if (frame.type() != CV_8UC1 || frame.rows != 1 || frame.datastart == nullptr
+                || frame.datalimit - frame.datastart < this->_imageSize)
+        {
+            frame.create(1, this->_imageSize, CV_8UC1);
+        }
+        frame.adjustROI(0, 0, 0, length - frame.cols); // grow or shrink within allocated row
+        memcpy(frame.data, this->_buffers[int(buffer.index)].start, size_t(length));
+    }
+    else
+    {
+        // Driver memory is converted directly into destination.
+        frame.create(this->_size, CV_8UC3);
+        FrameKernels::yuyvToBgr(static_cast<const uchar *>(this->_buffers[int(buffer.index)].start), size_t(this->_bytesPerLine),
+                                frame.data, frame.step, this->_size.width, this->_size.height);
+    }
+
+    return this->xioctl(VIDIOC_QBUF, &buffer, "VIDIOC_QBUF");
+}
+
+//!
+//! \brief Overloaded method.
+//!
+cv::Size V4l2FrameSource::frameSize(void) const
+{
+    return this->_size;
+}
+
+//!
+//! \brief Overloaded method.
+//!
+double V4l2FrameSource::fps(void) const
+{
+    return this->_fps;
+}
+
+//!
+//! \brief Overloaded method. Stops streaming and unmaps buffers.
+//!
+void V4l2FrameSource::release(void)
+{
+    if (this->_errorFrames > 0 || this->_truncatedFrames > 0)
+    {
+        qDebug() << __FILE__ << this->_device << "frames marked corrupt or empty by driver:" << this->_errorFrames
+                 << "larger than buffer:" << this->_truncatedFrames;
+        this->_errorFrames = 0;
+        this->_truncatedFrames = 0;
+    }
+
+    if (this->_streaming)
+    {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        ioctl(this->_fd, VIDIOC_STREAMOFF, &type);
+        this->_streaming = false;
+    }
+
+    for (int i = 0; i < this->_buffers.size(); ++i)
+    {
+        munmap(this->_buffers[i].start, this->_buffers[i].length);
+    }
+    this->_buffers.clear();
+
+    if (this->_fd >= 0)
+    {
+        ::close(this->_fd);
+        this->_fd = -1;
+    }
+}
+
+//!
+//! \brief Overloaded method.
+//!
+QString V4l2FrameSource::description(void) const
+{
+    return QString(this->_passthrough ? "v4l2 mjpeg %1" : "v4l2 %1").arg(this->_device);
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool V4l2FrameSource::isCompressed(void) const
+{
+    return this->_passthrough;
+}
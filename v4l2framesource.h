@@ -0,0 +1,52 @@
+#ifndef V4L2FRAMESOURCE_H
+#define V4L2FRAMESOURCE_H
+
+#include <QVector>
+#include "framesource.h"
+
+//!
+//! \brief Frame source using V4L2 memory mapped streaming (Linux only).
+//! Driver buffers are mapped once and dequeued without copy; the only pass
+//! over pixels is conversion from driver format straight into caller frame.
+//! In passthrough mode camera MJPEG is delivered as is, without decoding.
+//! Buffers marked corrupt or empty by driver, and JPEG larger than image
+//! size reported by driver, are skipped and counted.
+//!
+class V4l2FrameSource : public FrameSource
+{
+public:
+    explicit V4l2FrameSource(const QString &device, bool passthrough = false, int bufferCount = 4);
+    ~V4l2FrameSource();
+    bool isOpened(void) const;
+    bool read(cv::Mat &frame);
+    cv::Size frameSize(void) const;
+    double fps(void) const;
+    void release(void);
+    QString description(void) const;
+    bool isCompressed(void) const;
+
+private:
+    struct Buffer {
+        void *start;
+        size_t length;
+    };
+
+private:
+    bool open(int bufferCount);
+    bool xioctl(unsigned long request, void *arg, const char *name);
+
+private:
+    QString _device;
+    int _fd;
+    QVector<Buffer> _buffers;
+    cv::Size _size;
+    int _bytesPerLine;
+    int _imageSize;
+    bool _passthrough;
+    double _fps;
+    bool _streaming;
+    quint64 _errorFrames;       //!< skipped, driver marked them corrupt or empty
+    quint64 _truncatedFrames;   //!< skipped, JPEG larger than buffer size reported by driver
+};
+
+#endif // V4L2FRAMESOURCE_H
@@ -0,0 +1,648 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+#include <string.h>
+#include <limits>
+#ifndef Q_OS_WIN
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef RECORDER_URING
+#include <liburing.h>
+#endif
+#include "writebehindfile.h"
+
+// Alignment of buffers, offsets and lengths required by O_DIRECT.
+static const size_t BlockAlignment = 4096;
+
+// User data of io_uring operations which are not buffer writes.
+static const quint64 FallocateTag = ~quint64(0);
+
+//!
+//! \brief Writer thread of WriteBehindFile.
+//!
+class WriteBehindThread : public QThread
+{
+public:
+    explicit WriteBehindThread(WriteBehindFile *file) :
+        _file(file)
+    {
+    }
+
+protected:
+    void run(void)
+    {
+        this->_file->writeLoop();
+    }
+
+private:
+    WriteBehindFile *_file;
+};
+
+//!
+//! \brief Object constructor. Allocates buffers, file is created by open(), which fails if they are missing.
+//! \param fileName Represents output file name.
+//! \param bufferSize Represents size of one block written at once, rounded up to 4 kB.
+//! \param bufferCount Represents number of blocks, caller waits when all of them are being written.
+//! \param parent Represents parent of object.
+//!
+WriteBehindFile::WriteBehindFile(const QString &fileName, size_t bufferSize, int bufferCount, QObject *parent) :
+    QIODevice(parent),
+    _fileName(fileName),
+    _bufferSize((qMax(bufferSize, BlockAlignment) + BlockAlignment - 1) / BlockAlignment * BlockAlignment),
+    _writer(nullptr),
+    _ring(nullptr),
+    _fd(-1),
+    _current(-1),
+    _inFlight(0),
+    _end(0),
+    _allocated(0),
+    _stalls(0),
+    _direct(false),
+    _stopping(false),
+    _failed(false)
+{
+    this->_buffers.resize(qMax(bufferCount, 2));
+    for (int i = 0; i < this->_buffers.size(); ++i)
+    {
+        this->_buffers[i].data = static_cast<uchar *>(qMallocAligned(this->_bufferSize, BlockAlignment));
+        this->_buffers[i].offset = 0;
+        this->_buffers[i].length = 0;
+    }
+}
+
+//!
+//! \brief Object destructor. Finishes file and frees buffers.
+//!
+WriteBehindFile::~WriteBehindFile()
+{
+    this->close();
+    for (int i = 0; i < this->_buffers.size(); ++i)
+    {
+        qFreeAligned(this->_buffers[i].data);
+    }
+}
+
+//!
+//! \brief Overloaded method. Creates file, truncating existing one, and starts writer.
+//! \param mode Represents open mode, only write modes are supported.
+//! \return Returns false if file could not be created or buffers were not allocated.
+//!
+bool WriteBehindFile::open(OpenMode mode)
+{
+    if (this->isOpen() || (mode & ReadOnly) != 0)
+    {
+        return false;
+    }
+
+    // Every segment opened ahead takes its own buffers, memory may run out.
+    for (int i = 0; i < this->_buffers.size(); ++i)
+    {
+        if (this->_buffers[i].data == nullptr)
+        {
+            this->setErrorString(QString("Could not allocate %1 write-behind buffers of %2 bytes")
+                                 .arg(this->_buffers.size()).arg(this->_bufferSize));
+            return false;
+        }
+    }
+
+#ifdef Q_OS_WIN
+    qWarning() << __FILE__ << __LINE__ << "Write-behind output is not supported on this system:" << this->_fileName;
+    return false;
+#else
+    QByteArray name = this->_fileName.toLocal8Bit();
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    this->_direct = false;
+#ifdef O_DIRECT
+    // Filesystems without direct I/O (tmpfs) refuse the flag, page cache is used there.
+    this->_fd = ::open(name.constData(), flags | O_DIRECT, 0644);
+    this->_direct = this->_fd >= 0;
+#endif
+    if (this->_fd < 0)
+    {
+        this->_fd = ::open(name.constData(), flags, 0644);
+    }
+    if (this->_fd < 0)
+    {
+        this->setErrorString(QString::fromLatin1(strerror(errno)));
+        return false;
+    }
+
+    this->_free.clear();
+    for (int i = 0; i < this->_buffers.size(); ++i)
+    {
+        this->_free.append(i);
+    }
+    this->_pending.clear();
+    this->_patches.clear();
+    this->_current = -1;
+    this->_inFlight = 0;
+    this->_end = 0;
+    this->_allocated = 0;
+    this->_stalls = 0;
+    this->_stopping = false;
+    this->_failed = false;
+
+#ifdef RECORDER_URING
+    // Kernel without io_uring, or with it disabled, gets writer thread.
+    struct io_uring *ring = new struct io_uring;
+    if (io_uring_queue_init(unsigned(2 * this->_buffers.size() + 2), ring, 0) == 0)
+    {
+        this->_ring = ring;
+    }
+    else
+    {
+        delete ring;
+    }
+#endif
+
+    if (this->_ring == nullptr)
+    {
+        this->_writer = new WriteBehindThread(this);
+        this->_writer->start(QThread::HighPriority);
+    }
+
+    return QIODevice::open(mode | Unbuffered);
+#endif
+}
+
+//!
+//! \brief Overloaded method. Writes rest of data and overwritten parts, trims preallocated space and syncs.
+//!
+void WriteBehindFile::close(void)
+{
+    if (!this->isOpen())
+    {
+        return;
+    }
+
+#ifndef Q_OS_WIN
+    this->drain();
+
+    // Tail and patches are neither aligned nor whole blocks.
+#ifdef O_DIRECT
+    if (this->_direct)
+    {
+        fcntl(this->_fd, F_SETFL, fcntl(this->_fd, F_GETFL) & ~O_DIRECT);
+    }
+#endif
+    bool ok = true;
+    if (this->_current >= 0)
+    {
+        const Buffer &buffer = this->_buffers[this->_current];
+        ok = this->writeAll(reinterpret_cast<const char *>(buffer.data), buffer.length, buffer.offset);
+        this->_free.append(this->_current);
+        this->_current = -1;
+    }
+    for (int i = 0; i < this->_patches.size(); ++i)
+    {
+        const QByteArray &patch = this->_patches.at(i).second;
+        ok = this->writeAll(patch.constData(), size_t(patch.size()), this->_patches.at(i).first) && ok;
+    }
+    this->_patches.clear();
+
+    ok = ftruncate(this->_fd, off_t(this->_end)) == 0 && ok;
+    ok = fdatasync(this->_fd) == 0 && ok;
+    if (!ok || this->_failed)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Write-behind file not finished:" << this->_fileName << strerror(errno);
+    }
+    ::close(this->_fd);
+    this->_fd = -1;
+
+    if (this->_writer != nullptr)
+    {
+        {
+            QMutexLocker locker(&this->_mutex);
+            this->_stopping = true;
+            this->_changed.wakeAll();
+        }
+        this->_writer->wait();
+        delete this->_writer;
+        this->_writer = nullptr;
+    }
+#ifdef RECORDER_URING
+    if (this->_ring != nullptr)
+    {
+        struct io_uring *ring = static_cast<struct io_uring *>(this->_ring);
+        io_uring_queue_exit(ring);
+        delete ring;
+        this->_ring = nullptr;
+    }
+#endif
+#endif
+
+    QIODevice::close();
+}
+
+//!
+//! \brief Overloaded method.
+//!
+bool WriteBehindFile::isSequential(void) const
+{
+    return false;
+}
+
+//!
+//! \brief Overloaded method. Position may be moved back to overwrite written data, not past the end.
+//!
+bool WriteBehindFile::seek(qint64 pos)
+{
+    if (pos < 0 || pos > this->_end)
+    {
+        return false;
+    }
+    return QIODevice::seek(pos);
+}
+
+//!
+//! \brief Overloaded method.
+//! \return Returns number of bytes written, including those not on storage yet.
+//!
+qint64 WriteBehindFile::size(void) const
+{
+    return this->_end;
+}
+
+//!
+//! \brief Getter for file name.
+//! \return Returns name given in constructor.
+//!
+QString WriteBehindFile::fileName(void) const
+{
+    return this->_fileName;
+}
+
+//!
+//! \brief Method describes file for logs.
+//! \return Returns block layout and backend.
+//!
+QString WriteBehindFile::description(void) const
+{
+    return QString("write-behind %1 x %2 kB%3, %4").arg(this->_buffers.size()).arg(this->_bufferSize / 1024)
+            .arg(this->_direct ? ", O_DIRECT" : "").arg(this->_ring != nullptr ? "io_uring" : "writer thread");
+}
+
+//!
+//! \brief Getter for number of waits for storage.
+//! \return Returns how many times caller found all buffers being written.
+//!
+quint64 WriteBehindFile::stalls(void) const
+{
+    return this->_stalls;
+}
+
+//!
+//! \brief Overloaded method. File is write only.
+//!
+qint64 WriteBehindFile::readData(char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+//!
+//! \brief Overloaded method. Appends data to current buffer, full buffer is handed to writer.
+//!
+qint64 WriteBehindFile::writeData(const char *data, qint64 maxSize)
+{
+    if (this->_failed)
+    {
+        this->setErrorString("Write-behind block failed, see log");
+        return -1;
+    }
+
+    qint64 position = this->pos();
+    qint64 done = 0;
+    if (position < this->_end)
+    {
+        // Part already handed to writer is kept for close(), the rest is still in memory.
+        qint64 length = qMin(maxSize, this->_end - position);
+        qint64 bufferStart = this->_current >= 0 ? this->_buffers[this->_current].offset : this->_end;
+        if (position < bufferStart)
+        {
+            qint64 patch = qMin(length, bufferStart - position);
+            this->_patches.append(qMakePair(position, QByteArray(data, int(patch))));
+            done = patch;
+        }
+        if (done < length)
+        {
+            memcpy(this->_buffers[this->_current].data + (position + done - bufferStart), data + done, size_t(length - done));
+            done = length;
+        }
+    }
+
+    while (done < maxSize)
+    {
+        if (this->_current < 0)
+        {
+            this->_current = this->takeFree();
+            if (this->_current < 0)
+            {
+                this->setErrorString("Write-behind block failed, see log");
+                return done > 0 ? done : -1;
+            }
+            this->_buffers[this->_current].offset = this->_end;
+            this->_buffers[this->_current].length = 0;
+        }
+
+        Buffer &buffer = this->_buffers[this->_current];
+        size_t length = qMin(size_t(maxSize - done), this->_bufferSize - buffer.length);
+        memcpy(buffer.data + buffer.length, data + done, length);
+        buffer.length += length;
+        this->_end += qint64(length);
+        done += qint64(length);
+
+        if (buffer.length == this->_bufferSize)
+        {
+            this->submit(this->_current);
+            this->_current = -1;
+        }
+    }
+    return done;
+}
+
+//!
+//! \brief Method gives buffer to fill, waits for writer when there is none.
+//! \return Returns buffer index or -1 after write error.
+//!
+int WriteBehindFile::takeFree(void)
+{
+    if (this->_ring != nullptr)
+    {
+        this->reap(false);
+        while (this->_free.isEmpty() && !this->_failed)
+        {
+            ++this->_stalls;
+            this->reap(true);
+        }
+        return this->_failed ? -1 : this->_free.takeFirst();
+    }
+
+    QMutexLocker locker(&this->_mutex);
+    if (this->_free.isEmpty() && !this->_failed)
+    {
+        ++this->_stalls;
+    }
+    while (this->_free.isEmpty() && !this->_failed)
+    {
+        this->_changed.wait(&this->_mutex);
+    }
+    return this->_failed ? -1 : this->_free.takeFirst();
+}
+
+//!
+//! \brief Method hands full buffer over to storage.
+//! \param index Represents buffer index.
+//!
+void WriteBehindFile::submit(int index)
+{
+#ifdef RECORDER_URING
+    if (this->_ring != nullptr)
+    {
+        struct io_uring *ring = static_cast<struct io_uring *>(this->_ring);
+        const Buffer &buffer = this->_buffers[index];
+        qint64 end = buffer.offset + qint64(buffer.length);
+
+        // Preallocation runs beside writes, it only has to be ahead of them.
+        if (end > this->_allocated)
+        {
+            qint64 step = qMax(qint64(64) << 20, 4 * qint64(this->_bufferSize));
+            struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+            if (sqe != nullptr)
+            {
+                io_uring_prep_fallocate(sqe, this->_fd, FALLOC_FL_KEEP_SIZE, off_t(this->_allocated), off_t(step));
+                io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(FallocateTag));
+                ++this->_inFlight;
+            }
+            this->_allocated += step;
+        }
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+        if (sqe == nullptr)
+        {
+            this->fail("io_uring submission queue full");
+            this->_free.append(index);
+            return;
+        }
+        io_uring_prep_write(sqe, this->_fd, buffer.data, unsigned(buffer.length), off_t(buffer.offset));
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(quintptr(index)));
+        ++this->_inFlight;
+        io_uring_submit(ring);
+        return;
+    }
+#endif
+
+    QMutexLocker locker(&this->_mutex);
+    this->_pending.append(index);
+    ++this->_inFlight;
+    this->_changed.wakeAll();
+}
+
+//!
+//! \brief Method waits until every submitted buffer is written.
+//!
+void WriteBehindFile::drain(void)
+{
+    if (this->_ring != nullptr)
+    {
+        while (this->_inFlight > 0)
+        {
+            this->reap(true);
+        }
+        return;
+    }
+
+    QMutexLocker locker(&this->_mutex);
+    while (this->_inFlight > 0)
+    {
+        this->_changed.wait(&this->_mutex);
+    }
+}
+
+//!
+//! \brief Writer thread loop. Writes pending buffers in order.
+//!
+void WriteBehindFile::writeLoop(void)
+{
+    QMutexLocker locker(&this->_mutex);
+    while (true)
+    {
+        while (this->_pending.isEmpty() && !this->_stopping)
+        {
+            this->_changed.wait(&this->_mutex);
+        }
+        if (this->_pending.isEmpty())
+        {
+            break;
+        }
+
+        int index = this->_pending.takeFirst();
+        locker.unlock();
+        bool ok = this->writeBuffer(this->_buffers[index]);
+        locker.relock();
+
+        if (!ok)
+        {
+            this->_failed = true;
+        }
+        this->_free.append(index);
+        --this->_inFlight;
+        this->_changed.wakeAll();
+    }
+}
+
+//!
+//! \brief Method writes one block and syncs it. Called only from writer thread.
+//! \param buffer Represents full buffer.
+//! \return Returns false on write error.
+//!
+bool WriteBehindFile::writeBuffer(const Buffer &buffer)
+{
+    this->preallocate(buffer.offset + qint64(buffer.length));
+    if (!this->writeAll(reinterpret_cast<const char *>(buffer.data), buffer.length, buffer.offset))
+    {
+        qWarning() << __FILE__ << __LINE__ << "Write-behind block failed:" << this->_fileName << strerror(errno);
+        return false;
+    }
+
+#ifndef Q_OS_WIN
+    // Block is on storage before the next one is queued, page cache never collects a burst.
+    if (fdatasync(this->_fd) != 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Write-behind sync failed:" << this->_fileName << strerror(errno);
+        return false;
+    }
+#endif
+    return true;
+}
+
+//!
+//! \brief Method writes whole range at given offset.
+//! \param data Represents bytes.
+//! \param length Represents number of bytes.
+//! \param offset Represents file offset.
+//! \return Returns false on write error.
+//!
+bool WriteBehindFile::writeAll(const char *data, size_t length, qint64 offset)
+{
+#ifdef Q_OS_WIN
+    Q_UNUSED(data);
+    Q_UNUSED(length);
+    Q_UNUSED(offset);
+    return false;
+#else
+    while (length > 0)
+    {
+        ssize_t written = pwrite(this->_fd, data, length, off_t(offset));
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return false;
+        }
+        data += written;
+        length -= size_t(written);
+        offset += written;
+    }
+    return true;
+#endif
+}
+
+//!
+//! \brief Method reserves file space ahead of writes, so filesystem does not allocate blocks on every write.
+//! Called only from writer thread.
+//! \param end Represents end of the next write.
+//! \return Returns false if space could not be reserved; writes continue without it.
+//!
+bool WriteBehindFile::preallocate(qint64 end)
+{
+#if defined(Q_OS_LINUX) && defined(FALLOC_FL_KEEP_SIZE)
+    if (end <= this->_allocated)
+    {
+        return true;
+    }
+
+    // Space past the end is trimmed by close().
+    qint64 step = qMax(qint64(64) << 20, 4 * qint64(this->_bufferSize));
+    if (fallocate(this->_fd, FALLOC_FL_KEEP_SIZE, off_t(this->_allocated), off_t(step)) != 0)
+    {
+        qWarning() << __FILE__ << __LINE__ << "File preallocation not supported:" << this->_fileName << strerror(errno);
+        this->_allocated = std::numeric_limits<qint64>::max();
+        return false;
+    }
+    this->_allocated += step;
+    return true;
+#else
+    Q_UNUSED(end);
+    return false;
+#endif
+}
+
+//!
+//! \brief Method collects finished io_uring operations. Called only from writing thread.
+//! \param wait Represents true value to wait for at least one operation.
+//!
+void WriteBehindFile::reap(bool wait)
+{
+#ifdef RECORDER_URING
+    struct io_uring *ring = static_cast<struct io_uring *>(this->_ring);
+    struct io_uring_cqe *cqe = nullptr;
+    int result = 0;
+    do
+    {
+        result = wait ? io_uring_wait_cqe(ring, &cqe) : io_uring_peek_cqe(ring, &cqe);
+    }
+    while (result == -EINTR);
+    while (result == 0 && cqe != nullptr)
+    {
+        quint64 tag = quint64(quintptr(io_uring_cqe_get_data(cqe)));
+        if (tag == FallocateTag)
+        {
+            if (cqe->res < 0 && this->_allocated != std::numeric_limits<qint64>::max())
+            {
+                qWarning() << __FILE__ << __LINE__ << "File preallocation not supported:" << this->_fileName << strerror(-cqe->res);
+                this->_allocated = std::numeric_limits<qint64>::max();
+            }
+        }
+        else
+        {
+            int index = int(tag);
+            if (cqe->res != int(this->_buffers[index].length))
+            {
+                // Short direct write is not resumed, the block would lose its alignment.
+                this->fail(cqe->res < 0 ? QString::fromLatin1(strerror(-cqe->res)) : QString("short write"));
+            }
+            this->_free.append(index);
+        }
+        --this->_inFlight;
+        io_uring_cqe_seen(ring, cqe);
+        cqe = nullptr;
+        result = io_uring_peek_cqe(ring, &cqe);
+    }
+    if (wait && result < 0 && result != -EAGAIN && this->_inFlight > 0)
+    {
+        this->fail(QString::fromLatin1(strerror(-result)));
+        this->_inFlight = 0;
+    }
+#else
+    Q_UNUSED(wait);
+#endif
+}
+
+//!
+//! \brief Method marks file as failed, further writes return error.
+//! \param error Represents reason.
+//!
+void WriteBehindFile::fail(const QString &error)
+{
+    if (!this->_failed)
+    {
+        qWarning() << __FILE__ << __LINE__ << "Write-behind block failed:" << this->_fileName << error;
+    }
+    this->_failed = true;
+}
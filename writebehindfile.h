@@ -0,0 +1,86 @@
+#ifndef WRITEBEHINDFILE_H
+#define WRITEBEHINDFILE_H
+
+#include <QIODevice>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QPair>
+#include <QByteArray>
+#include <atomic>
+
+class QThread;
+
+//!
+//! \brief Output file written behind caller in large aligned blocks.
+//!
+//! Data are collected in few page aligned buffers; every full buffer is
+//! written at once by writer thread, or submitted to io_uring when built
+//! with RECORDER_URING and kernel supports it, so caller only copies bytes
+//! and waits only when all buffers are still on their way to storage.
+//! File is opened with O_DIRECT where filesystem allows it, preallocated
+//! by fallocate ahead of writes and synced after every block, which keeps
+//! page cache from collecting data and flushing it in long bursts.
+//! Data before the buffer being filled can be overwritten (header fields),
+//! such writes are applied by close(). POSIX only, open() fails on Windows.
+//!
+class WriteBehindFile : public QIODevice
+{
+    Q_OBJECT
+public:
+    WriteBehindFile(const QString &fileName, size_t bufferSize = 8 << 20, int bufferCount = 4, QObject *parent = 0);
+    ~WriteBehindFile();
+    bool open(OpenMode mode);
+    void close(void);
+    bool isSequential(void) const;
+    bool seek(qint64 pos);
+    qint64 size(void) const;
+    QString fileName(void) const;
+    QString description(void) const;
+    quint64 stalls(void) const;
+    void writeLoop(void);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+private:
+    struct Buffer {
+        uchar *data;
+        qint64 offset;
+        size_t length;
+    };
+
+private:
+    int takeFree(void);
+    void submit(int index);
+    void drain(void);
+    bool writeBuffer(const Buffer &buffer);
+    bool writeAll(const char *data, size_t length, qint64 offset);
+    bool preallocate(qint64 end);
+    void reap(bool wait);
+    void fail(const QString &error);
+
+private:
+    QString _fileName;
+    size_t _bufferSize;
+    QVector<Buffer> _buffers;
+    QVector<int> _free;
+    QVector<int> _pending;
+    QVector<QPair<qint64, QByteArray> > _patches;
+    QMutex _mutex;
+    QWaitCondition _changed;
+    QThread *_writer;
+    void *_ring;
+    int _fd;
+    int _current;
+    int _inFlight;
+    qint64 _end;
+    qint64 _allocated;
+    quint64 _stalls;
+    bool _direct;
+    bool _stopping;
+    std::atomic<bool> _failed;
+};
+
+#endif // WRITEBEHINDFILE_H